@@ -0,0 +1,81 @@
+#version 330 core
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 2) in vec2 tex;
+layout(location = 3) in ivec4 boneIds;
+layout(location = 4) in vec4 weights;
+// per instance, see Mesh::AnimatedInstance
+layout(location = 5) in mat4 instanceModel;
+layout(location = 9) in int instanceClip;
+layout(location = 10) in float instanceTimeOffset;
+
+uniform mat4 projection;
+uniform mat4 view;
+// seconds
+uniform float time;
+
+// see BakedAnimation: one row per frame, three texels (matrix rows) per bone, frames past
+// bakedFrameRows continue in the next band of columns
+uniform sampler2D bakedBones;
+uniform int bakedBoneCount;
+uniform int bakedFrameRows;
+const int MAX_BAKED_CLIPS = 16;
+uniform int bakedClipFirstFrame[MAX_BAKED_CLIPS];
+uniform int bakedClipFrameCount[MAX_BAKED_CLIPS];
+uniform float bakedClipDuration[MAX_BAKED_CLIPS];
+
+const int MAX_BONE_INFLUENCE = 4;
+
+out vec2 TextureCoords;
+out vec3 Normal;
+
+void main()
+{
+    int clip = clamp(instanceClip, 0, MAX_BAKED_CLIPS - 1);
+    int frameCount = bakedClipFrameCount[clip];
+    float frame = fract((time + instanceTimeOffset) / bakedClipDuration[clip]) * float(frameCount);
+    int frame0 = min(int(frame), frameCount - 1);
+    int frame1 = (frame0 + 1) % frameCount;
+    float blend = frame - float(frame0);
+    int bakedFrame0 = bakedClipFirstFrame[clip] + frame0;
+    int bakedFrame1 = bakedClipFirstFrame[clip] + frame1;
+    ivec2 origin0 = ivec2(bakedFrame0 / bakedFrameRows * bakedBoneCount * 3, bakedFrame0 % bakedFrameRows);
+    ivec2 origin1 = ivec2(bakedFrame1 / bakedFrameRows * bakedBoneCount * 3, bakedFrame1 % bakedFrameRows);
+
+    // rows of the weighted sum of the bone matrices, blended between the two frames
+    vec4 skin[3] = vec4[3](vec4(0.0f), vec4(0.0f), vec4(0.0f));
+    bool skinned = false;
+    bool outOfRange = false;
+    for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+    {
+        if (boneIds[i] == -1)
+            continue;
+        if (boneIds[i] >= bakedBoneCount)
+        {
+            outOfRange = true;
+            break;
+        }
+        for (int row = 0; row < 3; row++)
+        {
+            ivec2 texel = ivec2(boneIds[i] * 3 + row, 0);
+            vec4 bone = mix(texelFetch(bakedBones, origin0 + texel, 0),
+                            texelFetch(bakedBones, origin1 + texel, 0), blend);
+            skin[row] += bone * weights[i];
+        }
+        skinned = true;
+    }
+
+    vec3 skinnedPosition = pos;
+    vec3 skinnedNormal = norm;
+    if (skinned && !outOfRange)
+    {
+        vec4 position = vec4(pos, 1.0f);
+        skinnedPosition = vec3(dot(skin[0], position), dot(skin[1], position), dot(skin[2], position));
+        skinnedNormal = vec3(dot(skin[0].xyz, norm), dot(skin[1].xyz, norm), dot(skin[2].xyz, norm));
+    }
+
+    gl_Position = projection * view * instanceModel * vec4(skinnedPosition, 1.0f);
+    Normal = mat3(instanceModel) * skinnedNormal;
+    TextureCoords = tex;
+}
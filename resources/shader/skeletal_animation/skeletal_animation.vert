@@ -1,4 +1,4 @@
-#version 430 core
+#version 330 core
 
 layout(location = 0) in vec3 pos;
 layout(location = 1) in vec3 norm;
@@ -10,27 +10,35 @@ uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
 
-const int MAX_BONES = 100;
 const int MAX_BONE_INFLUENCE = 4;
-uniform mat4 finalBonesMatrices[MAX_BONES];
+// see BonePalette, four texels (matrix columns) per bone, sized to the rig
+uniform samplerBuffer finalBonesMatrices;
 
 out vec2 TextureCoords;
 
+mat4 boneMatrix(int bone)
+{
+    return mat4(texelFetch(finalBonesMatrices, bone * 4), texelFetch(finalBonesMatrices, bone * 4 + 1),
+                texelFetch(finalBonesMatrices, bone * 4 + 2), texelFetch(finalBonesMatrices, bone * 4 + 3));
+}
+
 void main()
 {
+    int boneCount = textureSize(finalBonesMatrices) / 4;
     vec4 totalPosition = vec4(0.0f);
     for(int i = 0 ; i < MAX_BONE_INFLUENCE ; i++)
     {
         if(boneIds[i] == -1)
             continue;
-        if(boneIds[i] >= MAX_BONES)
+        if(boneIds[i] >= boneCount)
         {
             totalPosition = vec4(pos,1.0f);
             break;
         }
-        vec4 localPosition = finalBonesMatrices[boneIds[i]] * vec4(pos,1.0f);
+        mat4 bone = boneMatrix(boneIds[i]);
+        vec4 localPosition = bone * vec4(pos,1.0f);
         totalPosition += localPosition * weights[i];
-        vec3 localNormal = mat3(finalBonesMatrices[boneIds[i]]) * norm;
+        vec3 localNormal = mat3(bone) * norm;
     }
 
     mat4 viewModel = view * model;
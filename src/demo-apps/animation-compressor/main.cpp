@@ -0,0 +1,50 @@
+// Builds a CompressedClip from the first animation of a model file, so the runtime can load it
+// without going through assimp:
+//
+//   animation-compressor resources/models/vampire/dancing_vampire.dae dancing_vampire.clip [tolerance]
+//
+// `tolerance` is the error allowed when dropping keys, in model units for translations and
+// scales and radians for rotations, 0.001 by default.
+
+#include <cstdlib>
+#include <string>
+
+#include <fmt/core.h>
+
+#include <graphics/Animation.hpp>
+#include <graphics/CompressedClip.hpp>
+#include <graphics/Model.hpp>
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fmt::println("usage: {} <animated model> <output clip> [tolerance]", APP_NAME);
+        return 1;
+    }
+    const std::string modelPath = argv[1];
+    const std::string clipPath = argv[2];
+    const float tolerance = argc > 3 ? std::strtof(argv[3], nullptr) : 1e-3f;
+
+    Model model{modelPath.c_str(), Model::LoadOptions{false}};
+    Animation animation{modelPath, model};
+
+    std::size_t keyCount = 0;
+    std::size_t keyBytes = 0;
+    for (int bone = 0; bone < animation.getBoneChannelCount(); bone++) {
+        const auto& positions = animation.getBone(bone).getPositionKeys();
+        const auto& rotations = animation.getBone(bone).getRotationKeys();
+        const auto& scales = animation.getBone(bone).getScaleKeys();
+        keyCount += positions.size() + rotations.size() + scales.size();
+        keyBytes += positions.size() * sizeof(KeyPosition) + rotations.size() * sizeof(KeyRotation) +
+                    scales.size() * sizeof(KeyScale);
+    }
+
+    const auto clip = CompressedClip::compress(animation, CompressedClip::Settings{tolerance, tolerance, tolerance});
+    if (!clip.save(clipPath)) {
+        fmt::println("failed to write {}", clipPath);
+        return 1;
+    }
+
+    fmt::println("{} channels, {} keys, {} bytes -> {} bytes ({:.1f}x)", clip.getChannelCount(), keyCount, keyBytes,
+                 clip.getKeyMemoryUsage(), static_cast<double>(keyBytes) / clip.getKeyMemoryUsage());
+    return 0;
+}
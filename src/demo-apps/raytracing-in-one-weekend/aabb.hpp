@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+
+#include "vec3.hpp"
+#include "ray.hpp"
+#include "utils.hpp"
+
+// Axis-aligned bounding box, stored as its minimum and maximum corner.
+class aabb {
+public:
+    aabb() : minimum(infinity, infinity, infinity), maximum(-infinity, -infinity, -infinity) {}
+    aabb(const point3& a, const point3& b) : minimum(a), maximum(b) {}
+
+    point3 min() const { return minimum; }
+    point3 max() const { return maximum; }
+
+    // Slab test - https://raytracing.github.io/books/RayTracingTheNextWeek.html#boundingvolumehierarchies
+    bool hit(const ray& r, real t_min, real t_max) const {
+        for (int a = 0; a < 3; a++) {
+            auto inv_d = 1 / r.direction()[a];
+            auto t0 = (minimum[a] - r.origin()[a]) * inv_d;
+            auto t1 = (maximum[a] - r.origin()[a]) * inv_d;
+            if (inv_d < 0)
+                std::swap(t0, t1);
+            t_min = t0 > t_min ? t0 : t_min;
+            t_max = t1 < t_max ? t1 : t_max;
+            if (t_max <= t_min)
+                return false;
+        }
+        return true;
+    }
+
+    point3 centroid() const { return 0.5 * (minimum + maximum); }
+
+    // Used by the SAH, the probability of a random ray hitting a box is proportional to its area.
+    real surface_area() const {
+        auto d = maximum - minimum;
+        if (d.x() < 0) return 0; // empty box
+        return 2 * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
+    }
+
+    int longest_axis() const {
+        auto d = maximum - minimum;
+        if (d.x() > d.y() && d.x() > d.z()) return 0;
+        return d.y() > d.z() ? 1 : 2;
+    }
+
+public:
+    point3 minimum;
+    point3 maximum;
+};
+
+inline aabb surrounding_box(const aabb& box0, const aabb& box1) {
+    point3 small(std::min(box0.min().x(), box1.min().x()),
+                 std::min(box0.min().y(), box1.min().y()),
+                 std::min(box0.min().z(), box1.min().z()));
+    point3 big(std::max(box0.max().x(), box1.max().x()),
+               std::max(box0.max().y(), box1.max().y()),
+               std::max(box0.max().z(), box1.max().z()));
+    return aabb(small, big);
+}
+
+inline aabb surrounding_box(const aabb& box, const point3& p) {
+    return surrounding_box(box, aabb(p, p));
+}
\ No newline at end of file
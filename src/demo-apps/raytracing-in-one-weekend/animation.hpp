@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "scene.hpp"
+#include "sphere.hpp"
+#include "sampler.hpp"
+
+struct animation_settings {
+    int frames = 0;
+    real fps = 24;
+    real orbit_degrees = 30;  // camera rotation around its look-at point over the whole sequence
+    real bounce_height = 0.5; // of the small spheres, 0 keeps them in place
+};
+
+/*!
+ * Procedural motion for sequence renders. The camera orbits its look-at point around the
+ * `vup` axis and every small sphere (radius below 0.5, e.g. the scattered spheres of the
+ * random scene) bounces once per second, each with its own phase. Large spheres and meshes
+ * stay in place.
+ *
+ * Objects are moved in place, acceleration structures built over them have to be refit
+ * afterwards.
+ */
+class scene_animation {
+public:
+    scene_animation(const scene& world, const animation_settings& settings) : view(world.view), settings(settings) {
+        for (const auto& object : world.objects.objects) {
+            auto s = std::dynamic_pointer_cast<sphere>(object);
+            if (!s || s->radius >= 0.5)
+                continue;
+            // deterministic phase in [0,1) per sphere
+            const real phase = (mix_seed(spheres.size()) >> 11) * 0x1p-53;
+            spheres.push_back({s, s->center, phase});
+        }
+    }
+
+    size_t moving_objects() const { return spheres.size(); }
+
+    // Moves the spheres to their position in `frame`.
+    void move_objects(int frame) {
+        const real time = frame / settings.fps;
+        for (auto& s : spheres) {
+            const real height = settings.bounce_height * std::fabs(std::sin(pi * (time + s.phase)));
+            s.object->center = s.rest + vec3(0, height, 0);
+        }
+    }
+
+    camera frame_camera(int frame) const {
+        const real progress = settings.frames > 1 ? real(frame) / (settings.frames - 1) : 0;
+        const real angle = degrees_to_radians(settings.orbit_degrees * progress);
+
+        // Rodrigues' rotation of the look-at -> camera offset around the up axis
+        const vec3 axis = unit_vector(view.vup);
+        const vec3 offset = view.lookfrom - view.lookat;
+        const vec3 rotated = offset * std::cos(angle) + cross(axis, offset) * std::sin(angle) +
+                             axis * dot(axis, offset) * (1 - std::cos(angle));
+
+        camera_settings frame_view = view;
+        frame_view.lookfrom = view.lookat + rotated;
+        return frame_view.make_camera();
+    }
+
+private:
+    struct bouncing_sphere {
+        std::shared_ptr<sphere> object;
+        point3 rest;
+        real phase;
+    };
+
+    camera_settings view;
+    animation_settings settings;
+    std::vector<bouncing_sphere> spheres;
+};
+
+// "out/image.ppm" -> "out/image_0007.ppm"
+inline std::string frame_path(const std::string& path, int frame) {
+    char number[16];
+    std::snprintf(number, sizeof(number), "_%04d", frame);
+    const auto slash = path.find_last_of("/\\");
+    const auto dot = path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return path + number;
+    return path.substr(0, dot) + number + path.substr(dot);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "image_writer.hpp"
+#include "renderer.hpp"
+
+/*!
+ * Streams the framebuffer to disk on its own thread while it is being rendered. Render
+ * workers only report finished tiles (`tile_done` is a counter update under a mutex), the
+ * writer thread picks up every scanline as soon as all of its pixels are done, in the order
+ * the image format stores them. Disk I/O never blocks a render thread.
+ *
+ * A writer can be started again once `finish` returned, the frames of an animation reuse the
+ * thread, the backend and the row counters.
+ */
+class async_image_writer {
+public:
+    async_image_writer(std::unique_ptr<image_writer> backend, const framebuffer& fb)
+        : writer(std::move(backend)), fb(fb),
+          pixels_missing(static_cast<size_t>(fb.height), fb.width) {}
+
+    ~async_image_writer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        row_ready.notify_one();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    bool start(const std::string& path) {
+        if (!writer->begin(path, fb.width, fb.height))
+            return false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::fill(pixels_missing.begin(), pixels_missing.end(), fb.width);
+            writing = true;
+        }
+        if (worker.joinable())
+            row_ready.notify_one();
+        else
+            worker = std::thread([this] { run(); });
+        return true;
+    }
+
+    void tile_done(const tile& t) {
+        bool completed_row = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int j = t.y0; j < t.y1; ++j) {
+                pixels_missing[j] -= t.x1 - t.x0;
+                completed_row |= pixels_missing[j] == 0;
+            }
+        }
+        if (completed_row)
+            row_ready.notify_one();
+    }
+
+    // Blocks until every row was written, all tiles must have been reported before.
+    bool finish() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            image_written.wait(lock, [&] { return !writing; });
+        }
+        return writer->finish();
+    }
+
+private:
+    // Writes one image per `start` until the writer is destroyed.
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            row_ready.wait(lock, [&] { return writing || stopping; });
+            if (stopping)
+                return;
+            lock.unlock();
+            write_rows();
+            lock.lock();
+            writing = false;
+            image_written.notify_all();
+        }
+    }
+
+    void write_rows() {
+        for (int n = 0; n < fb.height; ++n) {
+            const int j = writer->bottom_up() ? n : fb.height - 1 - n;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                row_ready.wait(lock, [&] { return pixels_missing[j] == 0 || stopping; });
+                if (stopping)
+                    return; // destroyed before all tiles were reported
+            }
+            writer->write_row(&fb.at(0, j), &fb.samples[fb.index(0, j)]);
+        }
+    }
+
+    std::unique_ptr<image_writer> writer;
+    const framebuffer& fb;
+
+    std::mutex mutex;
+    std::condition_variable row_ready;     // a row completed, an image started or stopping
+    std::condition_variable image_written;
+    std::vector<int> pixels_missing; // per row
+    bool writing = false;            // between `start` and the last row of the image
+    bool stopping = false;
+    std::thread worker;
+};
+
+// Writes a whole framebuffer synchronously, e.g. a progressive snapshot.
+bool write_image(const framebuffer& fb, image_format format, const std::string& path) {
+    auto writer = make_image_writer(format);
+    if (!writer->begin(path, fb.width, fb.height))
+        return false;
+    for (int n = 0; n < fb.height; ++n) {
+        const int j = writer->bottom_up() ? n : fb.height - 1 - n;
+        writer->write_row(&fb.at(0, j), &fb.samples[fb.index(0, j)]);
+    }
+    return writer->finish();
+}
@@ -0,0 +1,343 @@
+// Renders fixed seed scenes of growing size and reports throughput in a machine readable
+// format, so runs of two commits can be diffed:
+//
+//   raytracing-benchmark --format csv --output before.csv
+//   raytracing-benchmark --format json --threads 1,8 --repeat 5
+//
+// Every case is rendered `repeat` times per thread count, the fastest run is reported. On Unix
+// every case runs in a forked child process, so its peak resident set is its own and not the
+// high water mark of all cases before it.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define RT_BENCHMARK_FORK_CASES
+#endif
+
+#include "utils.hpp"
+#include "bvh.hpp"
+#include "scene.hpp"
+#include "random_scene.hpp"
+#include "triangle_mesh.hpp"
+#include "renderer.hpp"
+
+struct benchmark_case {
+    std::string name;
+    int width;
+    int height;
+    int spheres_grid;       // random_scene(grid), 0 for no small spheres
+    int mesh_resolution;    // height field with 2 * n^2 triangles, 0 for none
+};
+
+struct benchmark_result {
+    std::string name;
+    int width = 0;
+    int height = 0;
+    size_t primitives = 0;
+    unsigned threads = 0;
+    double build_seconds = 0.0;
+    double render_seconds = 0.0;
+    std::uint64_t samples = 0;
+    std::uint64_t rays = 0;
+    long peak_rss_kb = 0; // of the case, or of the process so far without RT_BENCHMARK_FORK_CASES
+};
+
+// High water mark of the resident set of the whole process.
+long peak_rss_kb() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+// Wavy ground made of 2 * n^2 triangles, replaces the ground sphere of the random scene.
+std::shared_ptr<triangle_mesh> height_field(int n, int mat_id) {
+    std::vector<float> positions;
+    std::vector<std::uint32_t> indices;
+    const float extent = 40.0f;
+    for (int j = 0; j <= n; ++j) {
+        for (int i = 0; i <= n; ++i) {
+            const float x = -extent / 2 + extent * i / n;
+            const float z = -extent / 2 + extent * j / n;
+            positions.insert(positions.end(), {x, 0.05f * std::sin(3 * x) * std::cos(3 * z) - 0.05f, z});
+        }
+    }
+    for (int j = 0; j < n; ++j) {
+        for (int i = 0; i < n; ++i) {
+            const auto a = static_cast<std::uint32_t>(j * (n + 1) + i);
+            const auto c = a + static_cast<std::uint32_t>(n + 1);
+            indices.insert(indices.end(), {a, c, a + 1, a + 1, c, c + 1});
+        }
+    }
+    return std::make_shared<triangle_mesh>(std::move(positions), std::move(indices), mat_id);
+}
+
+scene make_scene(const benchmark_case& c, size_t& primitives) {
+    seed_random(0);
+    scene world = random_scene(c.spheres_grid);
+    primitives = world.objects.objects.size();
+    if (c.mesh_resolution > 0) {
+        world.objects.objects.erase(world.objects.objects.begin()); // ground sphere
+        auto mesh = height_field(c.mesh_resolution, world.add_material(lambertian(color(0.5, 0.5, 0.5))));
+        primitives += mesh->triangle_count() - 1;
+        world.objects.add(mesh);
+    }
+    return world;
+}
+
+std::vector<int> parse_list(const std::string& value) {
+    std::vector<int> result;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        result.push_back(std::max(1, std::atoi(item.c_str())));
+    return result;
+}
+
+void write_csv(std::ostream& out, const std::vector<benchmark_result>& results) {
+    out << "name,width,height,primitives,threads,build_s,render_s,samples,rays,mrays_per_s,ns_per_sample,speedup,peak_rss_kb\n";
+    for (const auto& r : results) {
+        const auto& first = *std::find_if(results.begin(), results.end(), [&](const benchmark_result& o) { return o.name == r.name; });
+        out << r.name << ',' << r.width << ',' << r.height << ',' << r.primitives << ',' << r.threads << ','
+            << r.build_seconds << ',' << r.render_seconds << ',' << r.samples << ',' << r.rays << ','
+            << r.rays / r.render_seconds / 1e6 << ',' << r.render_seconds * 1e9 / r.samples << ','
+            << first.render_seconds / r.render_seconds << ',' << r.peak_rss_kb << '\n';
+    }
+}
+
+void write_json(std::ostream& out, const std::vector<benchmark_result>& results, int spp, int max_depth) {
+    out << "{\n"
+        << "  \"precision\": \"" << (sizeof(real) == sizeof(float) ? "float" : "double") << "\",\n"
+        << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+        << "  \"samples_per_pixel\": " << spp << ",\n"
+        << "  \"max_depth\": " << max_depth << ",\n"
+        << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        const auto& first = *std::find_if(results.begin(), results.end(), [&](const benchmark_result& o) { return o.name == r.name; });
+        out << "    {\"name\": \"" << r.name << "\", \"width\": " << r.width << ", \"height\": " << r.height
+            << ", \"primitives\": " << r.primitives << ", \"threads\": " << r.threads
+            << ", \"build_s\": " << r.build_seconds << ", \"render_s\": " << r.render_seconds
+            << ", \"samples\": " << r.samples << ", \"rays\": " << r.rays
+            << ", \"mrays_per_s\": " << r.rays / r.render_seconds / 1e6
+            << ", \"ns_per_sample\": " << r.render_seconds * 1e9 / r.samples
+            << ", \"speedup\": " << first.render_seconds / r.render_seconds
+            << ", \"peak_rss_kb\": " << r.peak_rss_kb << '}' << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+    out << "  ]\n}\n";
+}
+
+// Builds the scene of `c` once and renders it with every thread count.
+std::vector<benchmark_result> run_case(const benchmark_case& c, const std::vector<int>& thread_counts,
+                                       int spp, int max_depth, int repeat) {
+    // includes the BVH of the triangle mesh, which is built with the mesh
+    const auto build_start = std::chrono::steady_clock::now();
+    size_t primitives = 0;
+    const auto world_scene = make_scene(c, primitives);
+    const bvh_node world(world_scene.objects);
+    const std::chrono::duration<double> build_time = std::chrono::steady_clock::now() - build_start;
+
+    const camera cam = world_scene.view.make_camera();
+    render_settings settings{c.width, c.height, spp, max_depth};
+
+    std::vector<benchmark_result> results;
+    for (const int threads : thread_counts) {
+        thread_pool pool(static_cast<unsigned>(threads));
+        benchmark_result best;
+        for (int run = 0; run < repeat; ++run) {
+            framebuffer fb(c.width, c.height);
+            const auto start = std::chrono::steady_clock::now();
+            const auto stats = render(world, world_scene.materials, cam, settings, pool, fb);
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (run == 0 || elapsed.count() < best.render_seconds) {
+                best.render_seconds = elapsed.count();
+                best.samples = stats.samples;
+                best.rays = stats.rays;
+            }
+        }
+        best.name = c.name;
+        best.width = c.width;
+        best.height = c.height;
+        best.primitives = primitives;
+        best.threads = pool.size();
+        best.build_seconds = build_time.count();
+        best.peak_rss_kb = peak_rss_kb();
+        std::cerr << c.name << " threads " << best.threads << ": " << best.rays / best.render_seconds / 1e6 << " Mrays/s\n";
+        results.push_back(best);
+    }
+    return results;
+}
+
+#ifdef RT_BENCHMARK_FORK_CASES
+// Runs `run_case` in a forked child that sends the measurements back through a pipe, a fresh
+// process starts with an empty resident set. Returns no results if the child failed.
+std::vector<benchmark_result> run_case_in_child(const benchmark_case& c, const std::vector<int>& thread_counts,
+                                                int spp, int max_depth, int repeat) {
+    struct measurement {
+        std::uint64_t primitives;
+        unsigned threads;
+        double build_seconds;
+        double render_seconds;
+        std::uint64_t samples;
+        std::uint64_t rays;
+        long peak_rss_kb;
+    };
+
+    int fds[2];
+    if (pipe(fds) != 0)
+        return {};
+    std::cout.flush();
+    std::cerr.flush();
+    const pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return {};
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        bool sent = true;
+        for (const auto& r : run_case(c, thread_counts, spp, max_depth, repeat)) {
+            const measurement m{r.primitives, r.threads, r.build_seconds, r.render_seconds, r.samples, r.rays, r.peak_rss_kb};
+            sent = sent && write(fds[1], &m, sizeof(m)) == static_cast<ssize_t>(sizeof(m));
+        }
+        _exit(sent ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+    std::vector<benchmark_result> results;
+    measurement m{};
+    // a measurement is far below PIPE_BUF, it is never split
+    while (read(fds[0], &m, sizeof(m)) == static_cast<ssize_t>(sizeof(m))) {
+        benchmark_result r;
+        r.name = c.name;
+        r.width = c.width;
+        r.height = c.height;
+        r.primitives = m.primitives;
+        r.threads = m.threads;
+        r.build_seconds = m.build_seconds;
+        r.render_seconds = m.render_seconds;
+        r.samples = m.samples;
+        r.rays = m.rays;
+        r.peak_rss_kb = m.peak_rss_kb;
+        results.push_back(r);
+    }
+    close(fds[0]);
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS ||
+        results.size() != thread_counts.size())
+        return {};
+    return results;
+}
+#endif
+
+int main(int argc, char* argv[]) {
+    std::string format = "json";
+    std::string output;
+    int spp = 8;
+    int max_depth = 50;
+    int repeat = 3;
+    bool quick = false;
+    std::vector<int> thread_counts;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--format" && has_value) {
+            format = argv[++i];
+        } else if (arg == "--output" && has_value) {
+            output = argv[++i];
+        } else if (arg == "--spp" && has_value) {
+            spp = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--max-depth" && has_value) {
+            max_depth = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--repeat" && has_value) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--threads" && has_value) {
+            thread_counts = parse_list(argv[++i]);
+        } else if (arg == "--quick") {
+            quick = true;
+        } else {
+            std::cout << "usage: " << argv[0] << " [options]\n"
+                      << "  --format <type>   json | csv (default: json)\n"
+                      << "  --output <path>   result file (default: stdout)\n"
+                      << "  --spp <n>         samples per pixel (default: 8)\n"
+                      << "  --max-depth <n>   maximum ray bounces (default: 50)\n"
+                      << "  --repeat <n>      runs per case, the fastest is reported (default: 3)\n"
+                      << "  --threads <list>  comma separated thread counts (default: 1,2,4,..,all cores)\n"
+                      << "  --quick           smallest image size only, for CI smoke runs\n";
+            return arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (format != "json" && format != "csv") {
+        std::cerr << "unknown format " << format << '\n';
+        return EXIT_FAILURE;
+    }
+    if (thread_counts.empty()) {
+        const auto cores = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned t = 1; t < cores; t *= 2)
+            thread_counts.push_back(static_cast<int>(t));
+        thread_counts.push_back(static_cast<int>(cores));
+    }
+
+    std::vector<benchmark_case> cases = {
+        {"spheres-500-160x107", 160, 107, 11, 0},
+        {"spheres-3.6k-160x107", 160, 107, 30, 0},
+        {"spheres-40k-160x107", 160, 107, 100, 0},
+        {"triangles-200k-160x107", 160, 107, 11, 320},
+        {"spheres-500-480x320", 480, 320, 11, 0},
+        {"triangles-200k-480x320", 480, 320, 11, 320},
+    };
+    if (quick) {
+        cases.erase(std::remove_if(cases.begin(), cases.end(), [](const benchmark_case& c) { return c.width > 160; }),
+                    cases.end());
+    }
+
+    std::vector<benchmark_result> results;
+    for (const auto& c : cases) {
+#ifdef RT_BENCHMARK_FORK_CASES
+        const auto case_results = run_case_in_child(c, thread_counts, spp, max_depth, repeat);
+        if (case_results.empty()) {
+            std::cerr << c.name << " failed\n";
+            return EXIT_FAILURE;
+        }
+#else
+        const auto case_results = run_case(c, thread_counts, spp, max_depth, repeat);
+#endif
+        results.insert(results.end(), case_results.begin(), case_results.end());
+    }
+
+    std::ofstream file;
+    if (!output.empty()) {
+        file.open(output, std::ios_base::trunc);
+        if (!file) {
+            std::cerr << "cannot open " << output << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    std::ostream& out = output.empty() ? std::cout : file;
+    if (format == "csv")
+        write_csv(out, results);
+    else
+        write_json(out, results, spp, max_depth);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "hittable.hpp"
+#include "hittable_list.hpp"
+#include "aabb.hpp"
+
+/*!
+ * Bounding volume hierarchy, each node splits its objects in two where the surface area
+ * heuristic (SAH) predicts the lowest traversal cost:
+ *
+ *   cost = area(left)/area(node) * count(left) + area(right)/area(node) * count(right)
+ *
+ * Candidate split planes are taken from `bin_count` equally sized bins over the centroid
+ * bounds of every axis (binned SAH), which keeps the build O(n log n) for large scenes.
+ */
+class bvh_node : public hittable {
+public:
+    bvh_node() {}
+    explicit bvh_node(const hittable_list& list);
+
+    virtual bool hit(
+            const ray& r, real t_min, real t_max, hit_record& rec) const override;
+
+    virtual bool bounding_box(aabb& output_box) const override;
+
+    // Recomputes the node boxes bottom up for the objects' current bounds, keeping the tree
+    // topology. O(n) instead of a full build, but the tree degrades when objects move far.
+    virtual void refit() override;
+
+private:
+    struct build_entry {
+        std::shared_ptr<hittable> object;
+        aabb box;
+        point3 centroid;
+    };
+
+    static constexpr int bin_count = 16;
+
+    bvh_node(std::vector<build_entry>& entries, size_t start, size_t end);
+
+    std::shared_ptr<hittable> left;
+    std::shared_ptr<hittable> right;
+    aabb box;
+    int axis = 0; // split axis, left holds the objects with smaller centroids
+};
+
+bvh_node::bvh_node(const hittable_list& list) {
+    std::vector<build_entry> entries;
+    entries.reserve(list.objects.size());
+    for (const auto& object : list.objects) {
+        aabb object_box;
+        if (!object->bounding_box(object_box))
+            std::cerr << "No bounding box in bvh_node constructor.\n";
+        entries.push_back({object, object_box, object_box.centroid()});
+    }
+
+    if (entries.empty())
+        return;
+    *this = bvh_node(entries, 0, entries.size());
+}
+
+bvh_node::bvh_node(std::vector<build_entry>& entries, size_t start, size_t end) {
+    const size_t object_span = end - start;
+
+    aabb centroid_bounds;
+    for (size_t i = start; i < end; ++i) {
+        box = surrounding_box(box, entries[i].box);
+        centroid_bounds = surrounding_box(centroid_bounds, entries[i].centroid);
+    }
+
+    if (object_span == 1) {
+        left = right = entries[start].object;
+        return;
+    }
+    if (object_span == 2) {
+        axis = centroid_bounds.longest_axis();
+        const bool ordered = entries[start].centroid[axis] <= entries[start + 1].centroid[axis];
+        left = entries[ordered ? start : start + 1].object;
+        right = entries[ordered ? start + 1 : start].object;
+        return;
+    }
+
+    // Evaluate the SAH at every bin boundary of every axis.
+    auto best_cost = infinity;
+    int best_axis = -1;
+    int best_split = 0;
+
+    for (int a = 0; a < 3; ++a) {
+        const auto extent = centroid_bounds.max()[a] - centroid_bounds.min()[a];
+        if (extent <= 0.0)
+            continue;
+
+        aabb bin_boxes[bin_count];
+        size_t bin_counts[bin_count] = {};
+        const auto bin_of = [&](const build_entry& e) {
+            const int bin = static_cast<int>(bin_count * (e.centroid[a] - centroid_bounds.min()[a]) / extent);
+            return std::min(bin, bin_count - 1);
+        };
+        for (size_t i = start; i < end; ++i) {
+            const int bin = bin_of(entries[i]);
+            bin_boxes[bin] = surrounding_box(bin_boxes[bin], entries[i].box);
+            bin_counts[bin]++;
+        }
+
+        // sweep from the right to get the area/count of everything right of each boundary
+        real right_area[bin_count];
+        size_t right_count[bin_count];
+        aabb accumulated;
+        size_t count = 0;
+        for (int b = bin_count - 1; b > 0; --b) {
+            accumulated = surrounding_box(accumulated, bin_boxes[b]);
+            count += bin_counts[b];
+            right_area[b] = accumulated.surface_area();
+            right_count[b] = count;
+        }
+
+        accumulated = aabb();
+        count = 0;
+        for (int b = 0; b < bin_count - 1; ++b) {
+            accumulated = surrounding_box(accumulated, bin_boxes[b]);
+            count += bin_counts[b];
+            if (count == 0 || right_count[b + 1] == 0)
+                continue;
+            const auto cost = accumulated.surface_area() * count + right_area[b + 1] * right_count[b + 1];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = a;
+                best_split = b + 1;
+            }
+        }
+    }
+
+    size_t mid = start + object_span / 2;
+    if (best_axis >= 0) {
+        axis = best_axis;
+        const auto extent = centroid_bounds.max()[axis] - centroid_bounds.min()[axis];
+        const auto split_position = centroid_bounds.min()[axis] + extent * best_split / bin_count;
+        auto it = std::partition(entries.begin() + start, entries.begin() + end, [&](const build_entry& e) {
+            return e.centroid[axis] < split_position;
+        });
+        mid = static_cast<size_t>(it - entries.begin());
+    }
+    if (best_axis < 0 || mid == start || mid == end) {
+        // all centroids (nearly) coincide, SAH can't separate them - fall back to a median split
+        axis = centroid_bounds.longest_axis();
+        mid = start + object_span / 2;
+        std::nth_element(entries.begin() + start, entries.begin() + mid, entries.begin() + end,
+                         [this](const build_entry& a, const build_entry& b) {
+                             return a.centroid[axis] < b.centroid[axis];
+                         });
+    }
+
+    left = std::shared_ptr<bvh_node>(new bvh_node(entries, start, mid));
+    right = std::shared_ptr<bvh_node>(new bvh_node(entries, mid, end));
+}
+
+bool bvh_node::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+    if (!box.hit(r, t_min, t_max))
+        return false;
+
+    // visit the child closer to the ray origin first so the far one is culled by a shorter t_max
+    const bool left_first = r.direction()[axis] >= 0;
+    const auto& first = left_first ? left : right;
+    const auto& second = left_first ? right : left;
+
+    bool hit_first = first->hit(r, t_min, t_max, rec);
+    if (first == second)
+        return hit_first;
+    bool hit_second = second->hit(r, t_min, hit_first ? rec.t : t_max, rec);
+
+    return hit_first || hit_second;
+}
+
+bool bvh_node::bounding_box(aabb& output_box) const {
+    output_box = box;
+    return true;
+}
+
+void bvh_node::refit() {
+    if (!left)
+        return; // empty tree
+    left->refit();
+    if (right != left)
+        right->refit();
+
+    aabb left_box, right_box;
+    left->bounding_box(left_box);
+    right->bounding_box(right_box);
+    box = surrounding_box(left_box, right_box);
+}
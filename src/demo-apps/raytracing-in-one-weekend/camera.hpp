@@ -4,16 +4,20 @@
 #include "ray.hpp"
 #include "utils.hpp"
 
-class camera {
+template<typename T>
+class camera_t {
 public:
-    camera(
+    using point3 = vec3_t<T>;
+    using vec3 = vec3_t<T>;
+
+    camera_t(
         point3 lookfrom, // camera position
         point3 lookat, // camera target
         vec3   vup, // global up
-        double vfov, // vertical field-of-view in degrees
-        double aspect_ratio,
-        double aperture,
-        double focus_dist
+        T vfov, // vertical field-of-view in degrees
+        T aspect_ratio,
+        T aperture,
+        T focus_dist
     ) {
         auto theta = degrees_to_radians(vfov);
         auto h = std::tan(theta/2);
@@ -32,11 +36,11 @@ public:
         lens_radius = aperture / 2;
     }
 
-    ray get_ray(double u, double v) const {
-        vec3 rd = lens_radius * random_in_unit_disk();
+    ray_t<T> get_ray(T u, T v) const {
+        vec3 rd = lens_radius * random_in_unit_disk<T>();
         vec3 offset = cam_right * rd.x() + cam_up * rd.y();
 
-        return ray(origin + offset, lower_left_corner + u*horizontal + v*vertical - origin - offset);
+        return ray_t<T>(origin + offset, lower_left_corner + u*horizontal + v*vertical - origin - offset);
     }
 
 private:
@@ -47,5 +51,7 @@ private:
     vec3 cam_direction;
     vec3 cam_right;
     vec3 cam_up;
-    double lens_radius;
-};
\ No newline at end of file
+    T lens_radius;
+};
+
+using camera = camera_t<real>;
\ No newline at end of file
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "renderer.hpp"
+
+/*
+ * Render checkpoints: the accumulation buffers of a framebuffer, so a killed or preempted
+ * render can be resumed and keep adding samples, possibly with a higher --spp than before.
+ *
+ *   checkpoint_header
+ *   float pixels[3 * width * height]    sum of all samples
+ *   uint32 samples[width * height]
+ *   float luminance_squared[width * height]
+ *   float albedo[3 * width * height], float normal[3 * width * height]   only with features
+ *
+ * Rows are stored in framebuffer order (bottom row first), all values are little endian.
+ * Sums are rounded to float once per checkpoint, the relative error of 6e-8 is far below
+ * what any output format resolves. The header records the settings that decide which
+ * samples a pixel gets, resuming with different ones would mix two renders.
+ */
+
+constexpr char checkpoint_magic[8] = {'R', 'T', 'C', 'K', 'P', 'T', '0', '1'};
+
+struct checkpoint_header {
+    char magic[8];
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t has_features;
+    std::uint32_t sampler;      // sampler_type
+    std::uint32_t max_depth;
+    std::uint32_t roulette_depth;
+    std::uint64_t samples;      // total samples taken, for reporting only
+};
+
+static_assert(sizeof(checkpoint_header) == 40, "checkpoint_header must not contain padding");
+
+inline bool checkpoint_error(const std::string& path, const std::string& what) {
+    std::cerr << path << ": " << what << '\n';
+    return false;
+}
+
+/*!
+ * Writes the framebuffer to `path`. The file is written next to it first and renamed over it
+ * when complete, a crash while writing leaves the previous checkpoint intact.
+ */
+inline bool save_checkpoint(const framebuffer& fb, const render_settings& settings, const std::string& path) {
+    checkpoint_header header{};
+    std::memcpy(header.magic, checkpoint_magic, sizeof(header.magic));
+    header.width = static_cast<std::uint32_t>(fb.width);
+    header.height = static_cast<std::uint32_t>(fb.height);
+    header.has_features = fb.has_features() ? 1 : 0;
+    header.sampler = static_cast<std::uint32_t>(settings.sampler);
+    header.max_depth = static_cast<std::uint32_t>(settings.max_depth);
+    header.roulette_depth = static_cast<std::uint32_t>(settings.roulette_depth);
+    for (const auto count : fb.samples)
+        header.samples += count;
+
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios_base::binary | std::ios_base::trunc);
+        if (!file)
+            return checkpoint_error(temporary, "cannot open for writing");
+        const auto write = [&file](const void* bytes, size_t count) {
+            file.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(count));
+        };
+        // converted a row at a time, no second copy of the whole image
+        std::vector<float> row(static_cast<size_t>(fb.width) * 3);
+        const auto write_vectors = [&](const std::vector<vec3>& values) {
+            for (size_t start = 0; start < values.size(); start += static_cast<size_t>(fb.width)) {
+                for (int i = 0; i < fb.width; ++i) {
+                    for (int c = 0; c < 3; ++c)
+                        row[static_cast<size_t>(i) * 3 + c] = static_cast<float>(values[start + i][c]);
+                }
+                write(row.data(), row.size() * sizeof(float));
+            }
+        };
+        const auto write_scalars = [&](const std::vector<double>& values) {
+            for (size_t start = 0; start < values.size(); start += static_cast<size_t>(fb.width)) {
+                for (int i = 0; i < fb.width; ++i)
+                    row[static_cast<size_t>(i)] = static_cast<float>(values[start + i]);
+                write(row.data(), static_cast<size_t>(fb.width) * sizeof(float));
+            }
+        };
+
+        write(&header, sizeof(header));
+        write_vectors(fb.pixels);
+        write(fb.samples.data(), fb.samples.size() * sizeof(std::uint32_t));
+        write_scalars(fb.luminance_squared);
+        if (fb.has_features()) {
+            write_vectors(fb.albedo);
+            write_vectors(fb.normal);
+        }
+        if (!file.flush())
+            return checkpoint_error(temporary, "write failed");
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+        return checkpoint_error(path, "cannot replace with " + temporary);
+    return true;
+}
+
+/*!
+ * Restores the accumulation buffers of `fb`, which must have the checkpoint's size and been
+ * rendered with the same sampler and depth settings. Features are restored when both the
+ * checkpoint and `fb` have them, otherwise `fb`'s feature sums no longer match its samples
+ * and are disabled.
+ */
+inline bool load_checkpoint(const std::string& path, const render_settings& settings, framebuffer& fb) {
+    std::ifstream file(path, std::ios_base::binary);
+    if (!file)
+        return checkpoint_error(path, "cannot open");
+
+    checkpoint_header header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, checkpoint_magic, sizeof(checkpoint_magic)) != 0)
+        return checkpoint_error(path, "not a render checkpoint");
+    if (header.width != static_cast<std::uint32_t>(fb.width) || header.height != static_cast<std::uint32_t>(fb.height)) {
+        return checkpoint_error(path, "checkpoint is " + std::to_string(header.width) + 'x' + std::to_string(header.height) +
+                                          ", the image " + std::to_string(fb.width) + 'x' + std::to_string(fb.height));
+    }
+    if (header.sampler != static_cast<std::uint32_t>(settings.sampler) ||
+        header.max_depth != static_cast<std::uint32_t>(settings.max_depth) ||
+        header.roulette_depth != static_cast<std::uint32_t>(settings.roulette_depth)) {
+        return checkpoint_error(path, "rendered with a different sampler, max depth or roulette depth");
+    }
+
+    const auto read = [&file](void* bytes, size_t count) {
+        file.read(static_cast<char*>(bytes), static_cast<std::streamsize>(count));
+    };
+    std::vector<float> row(static_cast<size_t>(fb.width) * 3);
+    const auto read_vectors = [&](std::vector<vec3>& values) {
+        for (size_t start = 0; start < values.size(); start += static_cast<size_t>(fb.width)) {
+            read(row.data(), row.size() * sizeof(float));
+            for (size_t i = 0; i < static_cast<size_t>(fb.width); ++i)
+                values[start + i] = vec3(row[i * 3], row[i * 3 + 1], row[i * 3 + 2]);
+        }
+    };
+
+    read_vectors(fb.pixels);
+    read(fb.samples.data(), fb.samples.size() * sizeof(std::uint32_t));
+    for (size_t start = 0; start < fb.luminance_squared.size(); start += static_cast<size_t>(fb.width)) {
+        read(row.data(), static_cast<size_t>(fb.width) * sizeof(float));
+        for (int i = 0; i < fb.width; ++i)
+            fb.luminance_squared[start + i] = row[static_cast<size_t>(i)];
+    }
+    if (header.has_features && fb.has_features()) {
+        read_vectors(fb.albedo);
+        read_vectors(fb.normal);
+    } else if (fb.has_features()) {
+        std::cerr << path << ": checkpoint has no albedo/normal features, denoising without them\n";
+        fb.albedo.clear();
+        fb.normal.clear();
+    }
+    if (!file)
+        return checkpoint_error(path, "truncated");
+    return true;
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "renderer.hpp"
+#include "thread_pool.hpp"
+
+struct denoise_settings {
+    int iterations = 3;         // the filter radius doubles every iteration
+    float sigma_color = 4.0f;   // color difference in units of the pixels' standard error
+    float sigma_normal = 0.5f;
+    float sigma_albedo = 0.2f;
+};
+
+// exp(x) for x <= 0 within 3e-4 relative error, clamped to exp(-87). Branch free and without
+// library calls, so loops over it vectorize (std::exp stays a scalar call without -ffast-math).
+inline float fast_exp(float x) {
+    // the clamp works on the bits of |x|, float min/max block vectorization just like the call
+    constexpr std::int32_t max_magnitude = 0x42ae0000; // 87.0f
+    float magnitude = std::fabs(x);
+    std::int32_t bits;
+    std::memcpy(&bits, &magnitude, sizeof(bits));
+    bits = bits < max_magnitude ? bits : max_magnitude;
+    std::memcpy(&magnitude, &bits, sizeof(bits));
+
+    const float t = magnitude * -1.44269504f;        // exp(x) = 2^t = 2^whole * 2^fraction
+    const auto whole = static_cast<std::int32_t>(t); // rounds towards 0, fraction in (-1, 0]
+    const float fraction = t - static_cast<float>(whole);
+    const float p = 1.0f + fraction * (0.693147182f + fraction * (0.240226507f + fraction * (0.0555041087f +
+                    fraction * (0.00961812911f + fraction * 0.00133335581f))));
+    std::memcpy(&bits, &p, sizeof(bits));
+    bits += whole * (1 << 23); // add to the exponent field
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+/*!
+ * Edge-avoiding à-trous wavelet filter - Dammertz et al., "Edge-Avoiding À-Trous Wavelet
+ * Transform for fast Global Illumination Filtering", HPG 2010.
+ *
+ * Every iteration is a 5x5 B3-spline blur whose taps are spread `2^iteration` pixels apart.
+ * A tap's weight drops with the difference of its first hit normal and albedo to the center
+ * pixel, so the blur stays within surfaces and texture edges. Color differences are measured
+ * against the noise of the two pixels, as in SVGF (Schied et al., HPG 2017): the sample
+ * variance the adaptive sampler tracks anyway is the starting estimate and filtered along with
+ * the color, so noisy images are smoothed harder and later iterations keep more detail.
+ *
+ * Buffers are planar float arrays and each row is filtered tap by tap over contiguous x
+ * ranges, which the compiler can vectorize. Rows are split between the pool's threads.
+ */
+class denoiser {
+public:
+    explicit denoiser(const framebuffer& fb) : width(fb.width), height(fb.height) {
+        const size_t count = fb.pixels.size();
+        for (int k = 0; k < 3; ++k) {
+            color_planes[k].resize(count);
+            albedo_planes[k].resize(count);
+            normal_planes[k].resize(count);
+        }
+        variance_plane.resize(count);
+
+        for (size_t i = 0; i < count; ++i) {
+            const double n = std::max<std::uint32_t>(fb.samples[i], 1);
+            for (int k = 0; k < 3; ++k) {
+                color_planes[k][i] = static_cast<float>(fb.pixels[i][k] / n);
+                albedo_planes[k][i] = fb.has_features() ? static_cast<float>(fb.albedo[i][k] / n) : 0.0f;
+                normal_planes[k][i] = fb.has_features() ? static_cast<float>(fb.normal[i][k] / n) : 0.0f;
+            }
+            // variance of the pixel mean, in display (gamma 2) space like the color distances below
+            const auto mean = luminance(fb.pixels[i]) / n;
+            const auto sample_variance = n > 1 ? std::max(0.0, (fb.luminance_squared[i] / n - mean * mean) * n / (n - 1)) : 1.0;
+            variance_plane[i] = static_cast<float>(sample_variance / n / (4.0 * std::max(mean, 1e-4)));
+        }
+    }
+
+    // Filters the image, the result holds the denoised mean color of every pixel with a sample count of 1.
+    framebuffer run(const denoise_settings& settings, thread_pool& pool) {
+        std::vector<float> filtered[3];
+        std::vector<float> display[3];
+        std::vector<float> filtered_variance(variance_plane.size());
+        for (int k = 0; k < 3; ++k) {
+            filtered[k].resize(color_planes[k].size());
+            display[k].resize(color_planes[k].size());
+        }
+
+        constexpr int band_height = 8;
+        const int band_count = (height + band_height - 1) / band_height;
+        const pass_parameters params{1,
+                                     1.0f / (settings.sigma_color * settings.sigma_color),
+                                     1.0f / (settings.sigma_normal * settings.sigma_normal),
+                                     1.0f / (settings.sigma_albedo * settings.sigma_albedo)};
+
+        for (int iteration = 0; iteration < settings.iterations; ++iteration) {
+            // edge stopping compares gamma encoded colors, like the eye (and the output) does
+            for (int k = 0; k < 3; ++k) {
+                std::transform(color_planes[k].begin(), color_planes[k].end(), display[k].begin(),
+                               [](float c) { return std::sqrt(std::max(c, 0.0f)); });
+            }
+
+            pass_parameters pass = params;
+            pass.step = 1 << iteration;
+            pool.parallel_for(band_count, [&](int band) {
+                const int y_end = std::min(height, (band + 1) * band_height);
+                row_buffers buffers(width);
+                for (int y = band * band_height; y < y_end; ++y)
+                    filter_row(y, pass, display, filtered, filtered_variance, buffers);
+            });
+
+            for (int k = 0; k < 3; ++k)
+                std::swap(color_planes[k], filtered[k]);
+            std::swap(variance_plane, filtered_variance);
+        }
+
+        framebuffer result(width, height);
+        for (size_t i = 0; i < result.pixels.size(); ++i) {
+            result.pixels[i] = color(color_planes[0][i], color_planes[1][i], color_planes[2][i]);
+            result.samples[i] = 1;
+        }
+        return result;
+    }
+
+private:
+    struct pass_parameters {
+        int step;
+        float inv_sigma_color;
+        float inv_sigma_normal;
+        float inv_sigma_albedo;
+    };
+
+    // Per row accumulators, one entry per x.
+    struct row_buffers {
+        explicit row_buffers(int width)
+            : weights(static_cast<size_t>(width)), weight_sum(static_cast<size_t>(width)), variance_sum(static_cast<size_t>(width)) {
+            for (auto& sum : sums)
+                sum.resize(static_cast<size_t>(width));
+        }
+
+        std::vector<float> weights; // of the current tap
+        std::vector<float> weight_sum;
+        std::vector<float> variance_sum;
+        std::vector<float> sums[3];
+    };
+
+    void filter_row(int y, const pass_parameters& params, const std::vector<float> (&display)[3],
+                    std::vector<float> (&out)[3], std::vector<float>& out_variance, row_buffers& buffers) const {
+        static constexpr float kernel[5] = {1.0f / 16, 1.0f / 4, 3.0f / 8, 1.0f / 4, 1.0f / 16};
+        constexpr int block_size = 64;
+
+        std::fill(buffers.weight_sum.begin(), buffers.weight_sum.end(), 0.0f);
+        std::fill(buffers.variance_sum.begin(), buffers.variance_sum.end(), 0.0f);
+        for (auto& sum : buffers.sums)
+            std::fill(sum.begin(), sum.end(), 0.0f);
+
+        const size_t row = static_cast<size_t>(y) * width;
+        for (int ty = -2; ty <= 2; ++ty) {
+            const int yy = y + ty * params.step;
+            if (yy < 0 || yy >= height)
+                continue;
+            for (int tx = -2; tx <= 2; ++tx) {
+                const int offset = tx * params.step;
+                // x range for which the tap lies inside the image
+                const int x_begin = std::max(0, -offset);
+                const int x_end = std::min(width, width - offset);
+                const float tap_weight = kernel[ty + 2] * kernel[tx + 2];
+                const size_t tap_row = static_cast<size_t>(yy) * width;
+
+                const float* tap_display[3] = {display[0].data() + tap_row, display[1].data() + tap_row, display[2].data() + tap_row};
+                const float* center_display[3] = {display[0].data() + row, display[1].data() + row, display[2].data() + row};
+                const float* tap_normal[3] = {normal_planes[0].data() + tap_row, normal_planes[1].data() + tap_row, normal_planes[2].data() + tap_row};
+                const float* center_normal[3] = {normal_planes[0].data() + row, normal_planes[1].data() + row, normal_planes[2].data() + row};
+                const float* tap_albedo[3] = {albedo_planes[0].data() + tap_row, albedo_planes[1].data() + tap_row, albedo_planes[2].data() + tap_row};
+                const float* center_albedo[3] = {albedo_planes[0].data() + row, albedo_planes[1].data() + row, albedo_planes[2].data() + row};
+                const float* tap_variance = variance_plane.data() + tap_row;
+                const float* center_variance = variance_plane.data() + row;
+                float* weights = buffers.weights.data();
+
+                // edge stopping weights, computed in blocks on the stack so the compiler sees no aliasing
+                for (int block = x_begin; block < x_end; block += block_size) {
+                    const int n = std::min(block_size, x_end - block);
+                    float exponent[block_size];
+                    for (int i = 0; i < n; ++i) {
+                        const int x = block + i;
+                        float color_distance = 0.0f, normal_distance = 0.0f, albedo_distance = 0.0f;
+                        for (int k = 0; k < 3; ++k) {
+                            const float dc = tap_display[k][x + offset] - center_display[k][x];
+                            const float dn = tap_normal[k][x + offset] - center_normal[k][x];
+                            const float da = tap_albedo[k][x + offset] - center_albedo[k][x];
+                            color_distance += dc * dc;
+                            normal_distance += dn * dn;
+                            albedo_distance += da * da;
+                        }
+                        const float noise = center_variance[x] + tap_variance[x + offset] + 1e-6f;
+                        exponent[i] = -(color_distance * params.inv_sigma_color / noise +
+                                        normal_distance * params.inv_sigma_normal + albedo_distance * params.inv_sigma_albedo);
+                    }
+                    for (int i = 0; i < n; ++i)
+                        weights[block + i] = tap_weight * fast_exp(exponent[i]);
+                }
+
+                const float* tap_color[3] = {color_planes[0].data() + tap_row, color_planes[1].data() + tap_row, color_planes[2].data() + tap_row};
+                float* weight_sum = buffers.weight_sum.data();
+                float* variance_sum = buffers.variance_sum.data();
+                for (int x = x_begin; x < x_end; ++x) {
+                    weight_sum[x] += weights[x];
+                    variance_sum[x] += weights[x] * weights[x] * tap_variance[x + offset];
+                }
+                for (int k = 0; k < 3; ++k) {
+                    float* sum = buffers.sums[k].data();
+                    for (int x = x_begin; x < x_end; ++x)
+                        sum[x] += weights[x] * tap_color[k][x + offset];
+                }
+            }
+        }
+
+        // the center tap always contributes, weight_sum is never 0
+        for (int x = 0; x < width; ++x) {
+            const float inv_weight = 1.0f / buffers.weight_sum[x];
+            for (int k = 0; k < 3; ++k)
+                out[k][row + x] = buffers.sums[k][x] * inv_weight;
+            out_variance[row + x] = buffers.variance_sum[x] * inv_weight * inv_weight;
+        }
+    }
+
+    int width;
+    int height;
+    std::vector<float> color_planes[3]; // mean linear color
+    std::vector<float> albedo_planes[3];
+    std::vector<float> normal_planes[3];
+    std::vector<float> variance_plane;  // variance of the display space luminance of the mean
+};
+
+inline framebuffer denoise(const framebuffer& fb, const denoise_settings& settings, thread_pool& pool) {
+    return denoiser(fb).run(settings, pool);
+}
@@ -1,27 +1,35 @@
 #pragma once
 
 #include "ray.hpp"
+#include "aabb.hpp"
 
-class material;
-
-struct hit_record {
-    point3 p; // intersection point
-    vec3 normal;
-    std::shared_ptr<material> mat_ptr;
-    double t; // distance of intersection point from camera ray
+template<typename T>
+struct hit_record_t {
+    vec3_t<T> p; // intersection point
+    vec3_t<T> normal;
+    int mat_id; // index into the scene materials
+    T t; // distance of intersection point from camera ray
     bool front_face;
 
     /*!
      * Always make member attribute normal pointing against the ray. This approach
      * we can determine the side of surface at the time of coloring.
      */
-    void set_face_normal(const ray& r, const vec3& outward_normal) {
+    void set_face_normal(const ray_t<T>& r, const vec3_t<T>& outward_normal) {
         front_face = dot(r.direction(), outward_normal) < 0;
         normal = front_face ? outward_normal :-outward_normal;
     }
 };
 
+using hit_record = hit_record_t<real>;
+
 class hittable {
 public:
-    virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const = 0;
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const = 0;
+
+    // Returns false for objects without a finite bound, those can't be placed in a BVH.
+    virtual bool bounding_box(aabb& output_box) const = 0;
+
+    // Updates cached bounds and copies after objects moved, e.g. between animation frames.
+    virtual void refit() {}
 };
\ No newline at end of file
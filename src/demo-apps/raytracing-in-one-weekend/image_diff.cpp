@@ -0,0 +1,153 @@
+// Compares a test render against a reference render, e.g. the float preview build against the
+// double build of the same scene:
+//
+//   raytracing-on-one-weekend --output reference.ppm
+//   raytracing-on-one-weekend-float --output preview.ppm
+//   raytracing-image-diff reference.ppm preview.ppm --diff-image diff.ppm
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct image {
+    int width = 0;
+    int height = 0;
+    std::vector<double> rgb; // 3 values per pixel in [0,1], top row first
+};
+
+// PFM is linear radiance stored bottom row first, mapped with the gamma 2 / clamp of the 8-bit outputs.
+bool read_pfm(std::ifstream& in, const std::string& path, image& img) {
+    double scale = 0.0;
+    in >> img.width >> img.height >> scale;
+    if (img.width <= 0 || img.height <= 0 || scale >= 0.0) {
+        std::cerr << path << " is not a little endian RGB PFM image\n";
+        return false;
+    }
+    in.get();
+
+    std::vector<float> row(static_cast<size_t>(img.width) * 3);
+    img.rgb.resize(static_cast<size_t>(img.width) * img.height * 3);
+    for (int j = img.height - 1; j >= 0; --j) {
+        in.read(reinterpret_cast<char*>(row.data()), static_cast<std::streamsize>(row.size() * sizeof(float)));
+        if (!in) {
+            std::cerr << path << " is truncated\n";
+            return false;
+        }
+        for (size_t i = 0; i < row.size(); ++i)
+            img.rgb[static_cast<size_t>(j) * row.size() + i] = std::clamp(std::sqrt(std::max(0.0, static_cast<double>(row[i]))), 0.0, 1.0);
+    }
+    return true;
+}
+
+bool read_image(const std::string& path, image& img) {
+    std::ifstream in(path, std::ios_base::binary);
+    if (!in) {
+        std::cerr << "cannot open " << path << '\n';
+        return false;
+    }
+
+    std::string magic;
+    in >> magic;
+    if (magic == "PF")
+        return read_pfm(in, path, img);
+
+    int max_value = 0;
+    in >> img.width >> img.height >> max_value;
+    if ((magic != "P3" && magic != "P6") || img.width <= 0 || img.height <= 0 || max_value <= 0 || max_value > 255) {
+        std::cerr << path << " is not an 8-bit P3/P6 PPM or PFM image\n";
+        return false;
+    }
+    in.get(); // single whitespace after the header
+
+    img.rgb.resize(static_cast<size_t>(img.width) * img.height * 3);
+    for (auto& value : img.rgb) {
+        int v = 0;
+        if (magic == "P3") {
+            in >> v;
+        } else {
+            v = in.get();
+        }
+        if (!in) {
+            std::cerr << path << " is truncated\n";
+            return false;
+        }
+        value = static_cast<double>(v) / max_value;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cout << "usage: " << argv[0] << " <reference> <test> [--threshold <0-255>] [--diff-image <path>]\n";
+        return EXIT_FAILURE;
+    }
+
+    double threshold = 4.0 / 255.0;
+    std::string diff_path;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        const std::string arg = argv[i];
+        if (arg == "--threshold")
+            threshold = std::atof(argv[i + 1]) / 255.0;
+        else if (arg == "--diff-image")
+            diff_path = argv[i + 1];
+    }
+
+    image reference, test;
+    if (!read_image(argv[1], reference) || !read_image(argv[2], test))
+        return EXIT_FAILURE;
+    if (reference.width != test.width || reference.height != test.height) {
+        std::cerr << "image sizes differ: " << reference.width << 'x' << reference.height
+                  << " vs " << test.width << 'x' << test.height << '\n';
+        return EXIT_FAILURE;
+    }
+
+    const size_t pixel_count = static_cast<size_t>(reference.width) * reference.height;
+    double abs_sum = 0.0;
+    double squared_sum = 0.0;
+    double max_error = 0.0;
+    size_t pixels_over_threshold = 0;
+    std::vector<double> pixel_error(pixel_count);
+
+    for (size_t p = 0; p < pixel_count; ++p) {
+        double worst_channel = 0.0;
+        for (int c = 0; c < 3; ++c) {
+            const auto error = std::fabs(reference.rgb[p * 3 + c] - test.rgb[p * 3 + c]);
+            abs_sum += error;
+            squared_sum += error * error;
+            worst_channel = std::max(worst_channel, error);
+        }
+        pixel_error[p] = worst_channel;
+        max_error = std::max(max_error, worst_channel);
+        if (worst_channel > threshold)
+            ++pixels_over_threshold;
+    }
+
+    const auto sample_count = static_cast<double>(pixel_count * 3);
+    const auto mse = squared_sum / sample_count;
+    const auto psnr = mse > 0.0 ? 10.0 * std::log10(1.0 / mse) : INFINITY;
+
+    std::cout << "pixels:          " << pixel_count << '\n'
+              << "mean abs error:  " << abs_sum / sample_count * 255.0 << " / 255\n"
+              << "rmse:            " << std::sqrt(mse) * 255.0 << " / 255\n"
+              << "max error:       " << max_error * 255.0 << " / 255\n"
+              << "psnr:            " << psnr << " dB\n"
+              << "over threshold:  " << pixels_over_threshold << " ("
+              << 100.0 * pixels_over_threshold / pixel_count << "% of pixels differ by more than "
+              << threshold * 255.0 << "/255)\n";
+
+    if (!diff_path.empty()) {
+        // grayscale heat map, scaled so the largest error is white
+        std::ofstream out(diff_path, std::ios_base::binary | std::ios_base::trunc);
+        out << "P6\n" << reference.width << ' ' << reference.height << "\n255\n";
+        for (const auto error : pixel_error) {
+            const auto v = static_cast<char>(static_cast<unsigned char>(max_error > 0.0 ? 255.0 * error / max_error : 0.0));
+            out.put(v).put(v).put(v);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
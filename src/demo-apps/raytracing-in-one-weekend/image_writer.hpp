@@ -0,0 +1,386 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vec3.hpp"
+#include "color.hpp"
+
+enum class image_format {
+    ppm_ascii, // P3, the original output of the book
+    ppm,       // P6 binary
+    png,
+    pfm,       // linear float radiance, no gamma/clamping
+};
+
+// Picks the format from the file extension, binary PPM if unknown.
+inline image_format format_from_path(const std::string& path) {
+    const auto dot = path.find_last_of('.');
+    const auto extension = dot == std::string::npos ? std::string{} : path.substr(dot + 1);
+    if (extension == "png") return image_format::png;
+    if (extension == "pfm") return image_format::pfm;
+    return image_format::ppm;
+}
+
+// Gamma 2 and [0,255] quantization, same mapping as `write_color`.
+inline void to_rgb8(const color& pixel_color, std::uint32_t samples, std::uint8_t* out) {
+    auto scale = 1.0 / std::max(1u, samples);
+    for (int c = 0; c < 3; ++c) {
+        auto v = std::sqrt(scale * pixel_color[c]);
+        out[c] = static_cast<std::uint8_t>(256 * std::clamp(v, 0.0, 0.999));
+    }
+}
+
+/*!
+ * Writes an image one scanline at a time. Rows are passed in the order the format stores
+ * them, top row first unless `bottom_up()` says otherwise.
+ */
+class image_writer {
+public:
+    virtual ~image_writer() = default;
+
+    virtual bool bottom_up() const { return false; }
+
+    virtual bool begin(const std::string& path, int width, int height) {
+        image_width = width;
+        image_height = height;
+        out.open(path, std::ios_base::binary | std::ios_base::trunc);
+        if (!out) {
+            std::cerr << "cannot open " << path << " for writing\n";
+            return false;
+        }
+        return true;
+    }
+
+    // `pixels` holds `width` sums of samples, left to right, `samples` the sample count of each.
+    virtual void write_row(const color* pixels, const std::uint32_t* samples) = 0;
+
+    virtual bool finish() {
+        out.close();
+        return !out.fail();
+    }
+
+protected:
+    std::ofstream out;
+    int image_width = 0;
+    int image_height = 0;
+};
+
+class ppm_ascii_writer : public image_writer {
+public:
+    bool begin(const std::string& path, int width, int height) override {
+        if (!image_writer::begin(path, width, height))
+            return false;
+        out << "P3\n" << width << ' ' << height << "\n255\n";
+        return true;
+    }
+
+    void write_row(const color* pixels, const std::uint32_t* samples) override {
+        for (int i = 0; i < image_width; ++i)
+            write_color(out, pixels[i], static_cast<int>(std::max(1u, samples[i])));
+    }
+};
+
+class ppm_writer : public image_writer {
+public:
+    bool begin(const std::string& path, int width, int height) override {
+        if (!image_writer::begin(path, width, height))
+            return false;
+        out << "P6\n" << width << ' ' << height << "\n255\n";
+        row.resize(static_cast<size_t>(width) * 3);
+        return true;
+    }
+
+    void write_row(const color* pixels, const std::uint32_t* samples) override {
+        for (int i = 0; i < image_width; ++i)
+            to_rgb8(pixels[i], samples[i], &row[static_cast<size_t>(i) * 3]);
+        out.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+
+private:
+    std::vector<std::uint8_t> row;
+};
+
+// Portable float map, little endian RGB float32 rows stored bottom row first.
+class pfm_writer : public image_writer {
+public:
+    bool bottom_up() const override { return true; }
+
+    bool begin(const std::string& path, int width, int height) override {
+        if (!image_writer::begin(path, width, height))
+            return false;
+        out << "PF\n" << width << ' ' << height << "\n-1.0\n";
+        row.resize(static_cast<size_t>(width) * 3);
+        return true;
+    }
+
+    void write_row(const color* pixels, const std::uint32_t* samples) override {
+        for (int i = 0; i < image_width; ++i) {
+            const auto scale = 1.0 / std::max(1u, samples[i]);
+            for (int c = 0; c < 3; ++c)
+                row[static_cast<size_t>(i) * 3 + c] = static_cast<float>(scale * pixels[i][c]);
+        }
+        // the PFM scale of -1.0 above declares little endian, which every supported target is
+        out.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size() * sizeof(float)));
+    }
+
+private:
+    std::vector<float> row;
+};
+
+/*!
+ * PNG encoder without external dependencies. Rows are Paeth filtered and compressed with a
+ * greedy LZ77 (one hash probe per position) into fixed Huffman deflate blocks. Every
+ * `write_row` call emits its compressed data as an IDAT chunk right away, matches may
+ * reference up to 32KB of previously written rows.
+ */
+class png_writer : public image_writer {
+public:
+    bool begin(const std::string& path, int width, int height) override {
+        if (!image_writer::begin(path, width, height))
+            return false;
+
+        // a writer can encode several images one after the other
+        rows_written = 0;
+        data.clear();
+        data_offset = 0;
+        compressed.clear();
+        bit_buffer = 0;
+        bit_count = 0;
+        adler_a = 1;
+        adler_b = 0;
+
+        static const std::uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        out.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+        std::vector<std::uint8_t> header;
+        put_u32(header, static_cast<std::uint32_t>(width));
+        put_u32(header, static_cast<std::uint32_t>(height));
+        header.push_back(8); // bit depth
+        header.push_back(2); // color type RGB
+        header.push_back(0); // deflate
+        header.push_back(0); // adaptive filtering
+        header.push_back(0); // no interlace
+        write_chunk("IHDR", header);
+
+        row_stride = static_cast<size_t>(width) * 3;
+        previous_row.assign(row_stride, 0);
+        current_row.resize(row_stride);
+        head.assign(hash_size, -1);
+
+        // zlib header: deflate, 32K window, no preset dictionary
+        compressed.push_back(0x78);
+        compressed.push_back(0x01);
+        return true;
+    }
+
+    void write_row(const color* pixels, const std::uint32_t* samples) override {
+        for (int i = 0; i < image_width; ++i)
+            to_rgb8(pixels[i], samples[i], &current_row[static_cast<size_t>(i) * 3]);
+
+        const size_t start = data.size();
+        data.push_back(4); // Paeth
+        for (size_t x = 0; x < row_stride; ++x) {
+            const int a = x >= 3 ? current_row[x - 3] : 0;
+            const int b = previous_row[x];
+            const int c = x >= 3 ? previous_row[x - 3] : 0;
+            data.push_back(static_cast<std::uint8_t>(current_row[x] - paeth(a, b, c)));
+        }
+        std::swap(previous_row, current_row);
+
+        ++rows_written;
+        compress(start, rows_written == image_height);
+        write_chunk("IDAT", compressed);
+        compressed.clear();
+        trim_window();
+    }
+
+    bool finish() override {
+        write_chunk("IEND", {});
+        return image_writer::finish();
+    }
+
+private:
+    static constexpr int hash_bits = 15;
+    static constexpr int hash_size = 1 << hash_bits;
+    static constexpr size_t window_size = 32768;
+    static constexpr int min_match = 3;
+    static constexpr int max_match = 258;
+
+    static int paeth(int a, int b, int c) {
+        const int p = a + b - c;
+        const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc) return a;
+        return pb <= pc ? b : c;
+    }
+
+    static void put_u32(std::vector<std::uint8_t>& v, std::uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            v.push_back(static_cast<std::uint8_t>(value >> shift));
+    }
+
+    static std::uint32_t crc32(std::uint32_t crc, const std::uint8_t* bytes, size_t count) {
+        static const auto table = [] {
+            std::array<std::uint32_t, 256> t{};
+            for (std::uint32_t n = 0; n < 256; ++n) {
+                std::uint32_t c = n;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                t[n] = c;
+            }
+            return t;
+        }();
+        crc = ~crc;
+        for (size_t i = 0; i < count; ++i)
+            crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    void write_chunk(const char* type, const std::vector<std::uint8_t>& payload) {
+        std::vector<std::uint8_t> chunk;
+        put_u32(chunk, static_cast<std::uint32_t>(payload.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), payload.begin(), payload.end());
+        put_u32(chunk, crc32(0, chunk.data() + 4, chunk.size() - 4));
+        out.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+    }
+
+    // Deflate bits are packed starting at the least significant bit.
+    void put_bits(std::uint32_t value, int count) {
+        bit_buffer |= value << bit_count;
+        bit_count += count;
+        while (bit_count >= 8) {
+            compressed.push_back(static_cast<std::uint8_t>(bit_buffer));
+            bit_buffer >>= 8;
+            bit_count -= 8;
+        }
+    }
+
+    // Huffman codes are defined most significant bit first.
+    void put_code(std::uint32_t code, int length) {
+        std::uint32_t reversed = 0;
+        for (int i = 0; i < length; ++i)
+            reversed |= ((code >> i) & 1u) << (length - 1 - i);
+        put_bits(reversed, length);
+    }
+
+    void put_symbol(int symbol) {
+        if (symbol < 144) put_code(0x30 + symbol, 8);
+        else if (symbol < 256) put_code(0x190 + symbol - 144, 9);
+        else if (symbol < 280) put_code(symbol - 256, 7);
+        else put_code(0xc0 + symbol - 280, 8);
+    }
+
+    void put_match(int length, int distance) {
+        static const int length_base[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+        static const int length_extra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+        static const int distance_base[30] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577};
+        static const int distance_extra[30] = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+
+        int l = 28;
+        while (length_base[l] > length) --l;
+        put_symbol(257 + l);
+        put_bits(static_cast<std::uint32_t>(length - length_base[l]), length_extra[l]);
+
+        int d = 29;
+        while (distance_base[d] > distance) --d;
+        put_code(static_cast<std::uint32_t>(d), 5);
+        put_bits(static_cast<std::uint32_t>(distance - distance_base[d]), distance_extra[d]);
+    }
+
+    std::uint32_t hash_at(size_t pos) const {
+        const std::uint32_t v = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16);
+        return (v * 2654435761u) >> (32 - hash_bits);
+    }
+
+    // Compresses data[start..] into one fixed Huffman block.
+    void compress(size_t start, bool final_block) {
+        put_bits(final_block ? 1 : 0, 1);
+        put_bits(1, 2); // fixed Huffman codes
+
+        size_t pos = start;
+        while (pos < data.size()) {
+            int best_length = 0;
+            size_t best_distance = 0;
+            if (pos + min_match <= data.size()) {
+                const auto h = hash_at(pos);
+                const long candidate = head[h];
+                head[h] = static_cast<long>(pos + data_offset);
+                if (candidate >= 0 && pos + data_offset - candidate <= window_size) {
+                    const size_t match = static_cast<size_t>(candidate) - data_offset;
+                    const size_t limit = std::min<size_t>(max_match, data.size() - pos);
+                    size_t length = 0;
+                    while (length < limit && data[match + length] == data[pos + length])
+                        ++length;
+                    if (length >= min_match) {
+                        best_length = static_cast<int>(length);
+                        best_distance = pos - match;
+                    }
+                }
+            }
+
+            if (best_length > 0) {
+                put_match(best_length, static_cast<int>(best_distance));
+                // keep the hash table warm inside the match, cheap and improves the ratio
+                for (size_t p = pos + 1; p < pos + best_length && p + min_match <= data.size(); ++p)
+                    head[hash_at(p)] = static_cast<long>(p + data_offset);
+                pos += best_length;
+            } else {
+                put_symbol(data[pos]);
+                ++pos;
+            }
+        }
+
+        // adler32 runs over the uncompressed data of this block
+        for (size_t i = start; i < data.size(); ++i) {
+            adler_a = (adler_a + data[i]) % 65521;
+            adler_b = (adler_b + adler_a) % 65521;
+        }
+
+        put_symbol(256); // end of block
+        if (final_block) {
+            if (bit_count > 0)
+                put_bits(0, 8 - bit_count);
+            put_u32(compressed, (adler_b << 16) | adler_a);
+        }
+    }
+
+    // Drops uncompressed bytes that can no longer be referenced by a match.
+    void trim_window() {
+        if (data.size() <= 2 * window_size)
+            return;
+        const size_t drop = data.size() - window_size;
+        data.erase(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(drop));
+        data_offset += drop;
+    }
+
+    size_t row_stride = 0;
+    int rows_written = 0;
+    std::vector<std::uint8_t> previous_row;
+    std::vector<std::uint8_t> current_row;
+
+    std::vector<std::uint8_t> data; // filtered scanlines, data[0] is stream position `data_offset`
+    size_t data_offset = 0;
+    std::vector<long> head;         // last stream position of each 3 byte hash
+    std::vector<std::uint8_t> compressed;
+    std::uint32_t bit_buffer = 0;
+    int bit_count = 0;
+    std::uint32_t adler_a = 1;
+    std::uint32_t adler_b = 0;
+};
+
+inline std::unique_ptr<image_writer> make_image_writer(image_format format) {
+    switch (format) {
+        case image_format::ppm_ascii: return std::make_unique<ppm_ascii_writer>();
+        case image_format::png: return std::make_unique<png_writer>();
+        case image_format::pfm: return std::make_unique<pfm_writer>();
+        default: return std::make_unique<ppm_writer>();
+    }
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*!
+ * Minimal JSON reader, just enough for scene files. Numbers are always doubles, objects keep
+ * their members in file order and lookups are linear, scene objects only have a few keys.
+ */
+struct json_value {
+    enum class kind { null, boolean, number, string, array, object };
+
+    kind type = kind::null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<json_value> items;                            // array
+    std::vector<std::pair<std::string, json_value>> members;  // object
+
+    bool is_number() const { return type == kind::number; }
+    bool is_string() const { return type == kind::string; }
+    bool is_array() const { return type == kind::array; }
+    bool is_object() const { return type == kind::object; }
+
+    // Member `key` of an object, nullptr if missing or if this isn't an object.
+    const json_value* find(const char* key) const {
+        for (const auto& member : members) {
+            if (member.first == key)
+                return &member.second;
+        }
+        return nullptr;
+    }
+};
+
+class json_parser {
+public:
+    json_parser(const char* begin, const char* end) : p(begin), end(end), begin(begin) {}
+
+    // Parses a whole document, on failure `error()` describes the problem and its offset.
+    bool parse(json_value& out) {
+        if (!parse_value(out, 0))
+            return false;
+        skip_whitespace();
+        if (p != end)
+            return fail("trailing characters after the document");
+        return true;
+    }
+
+    const std::string& error() const { return message; }
+
+private:
+    static constexpr int max_nesting = 64;
+
+    bool fail(const char* what) {
+        message = std::string(what) + " at offset " + std::to_string(p - begin);
+        return false;
+    }
+
+    void skip_whitespace() {
+        while (p != end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            ++p;
+    }
+
+    bool consume(char c) {
+        skip_whitespace();
+        if (p == end || *p != c)
+            return false;
+        ++p;
+        return true;
+    }
+
+    bool literal(const char* word) {
+        const size_t length = std::strlen(word);
+        if (static_cast<size_t>(end - p) < length || std::strncmp(p, word, length) != 0)
+            return false;
+        p += length;
+        return true;
+    }
+
+    bool parse_value(json_value& out, int depth) {
+        if (depth > max_nesting)
+            return fail("nesting too deep");
+        skip_whitespace();
+        if (p == end)
+            return fail("unexpected end of input");
+
+        switch (*p) {
+            case '{': return parse_object(out, depth);
+            case '[': return parse_array(out, depth);
+            case '"': out.type = json_value::kind::string; return parse_string(out.string);
+            case 't':
+            case 'f':
+                out.type = json_value::kind::boolean;
+                out.boolean = *p == 't';
+                return literal(out.boolean ? "true" : "false") || fail("invalid literal");
+            case 'n':
+                out.type = json_value::kind::null;
+                return literal("null") || fail("invalid literal");
+            default:
+                return parse_number(out);
+        }
+    }
+
+    bool parse_number(json_value& out) {
+        // strtod needs a terminated buffer, numbers are short so copy into one
+        char buffer[64];
+        size_t length = 0;
+        while (p + length != end && length + 1 < sizeof(buffer) && std::strchr("+-0123456789.eE", p[length]))
+            ++length;
+        if (length == 0)
+            return fail("unexpected character");
+        std::memcpy(buffer, p, length);
+        buffer[length] = '\0';
+
+        char* number_end = nullptr;
+        out.type = json_value::kind::number;
+        out.number = std::strtod(buffer, &number_end);
+        if (number_end != buffer + length)
+            return fail("invalid number");
+        p += length;
+        return true;
+    }
+
+    bool parse_string(std::string& out) {
+        ++p; // opening quote
+        out.clear();
+        while (p != end && *p != '"') {
+            if (*p != '\\') {
+                out += *p++;
+                continue;
+            }
+            if (++p == end)
+                break;
+            switch (*p++) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    // names and comments only, anything outside of ASCII becomes '?'
+                    if (end - p < 4)
+                        return fail("truncated \\u escape");
+                    const auto code = std::strtoul(std::string(p, 4).c_str(), nullptr, 16);
+                    out += code < 0x80 ? static_cast<char>(code) : '?';
+                    p += 4;
+                    break;
+                }
+                default: return fail("invalid escape sequence");
+            }
+        }
+        if (p == end)
+            return fail("unterminated string");
+        ++p; // closing quote
+        return true;
+    }
+
+    bool parse_array(json_value& out, int depth) {
+        ++p;
+        out.type = json_value::kind::array;
+        if (consume(']'))
+            return true;
+        do {
+            out.items.emplace_back();
+            if (!parse_value(out.items.back(), depth + 1))
+                return false;
+        } while (consume(','));
+        return consume(']') || fail("expected ',' or ']'");
+    }
+
+    bool parse_object(json_value& out, int depth) {
+        ++p;
+        out.type = json_value::kind::object;
+        if (consume('}'))
+            return true;
+        do {
+            skip_whitespace();
+            if (p == end || *p != '"')
+                return fail("expected a member name");
+            out.members.emplace_back();
+            if (!parse_string(out.members.back().first))
+                return false;
+            if (!consume(':'))
+                return fail("expected ':'");
+            if (!parse_value(out.members.back().second, depth + 1))
+                return false;
+        } while (consume(','));
+        return consume('}') || fail("expected ',' or '}'");
+    }
+
+    const char* p;
+    const char* end;
+    const char* begin;
+    std::string message;
+};
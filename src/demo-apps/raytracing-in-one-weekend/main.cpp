@@ -1,5 +1,6 @@
 #include <iostream>
-#include <fstream>
+#include <chrono>
+#include <csignal>
 
 #include "color.hpp"
 #include "vec3.hpp"
@@ -7,117 +8,300 @@
 #include "sphere.hpp"
 #include "utils.hpp"
 #include "hittable_list.hpp"
+#include "bvh.hpp"
+#include "sphere_soa.hpp"
 #include "camera.hpp"
 #include "material.hpp"
+#include "scene.hpp"
+#include "scene_file.hpp"
+#include "random_scene.hpp"
+#include "renderer.hpp"
+#include "denoiser.hpp"
+#include "options.hpp"
+#include "async_image_writer.hpp"
+#include "worker_processes.hpp"
+#include "checkpoint.hpp"
+#include "animation.hpp"
 
-color ray_color(const ray& r, const hittable& world, int depth = 4) {
-    hit_record rec;
+// Set by SIGINT/SIGTERM while checkpointing, the render then saves and stops after the current pass.
+volatile std::sig_atomic_t stop_requested = 0;
 
-    if (depth <= 0)
-        return color{0,0,0};
+extern "C" void request_stop(int) {
+    stop_requested = 1;
+}
 
-    // Fix shadow acne by using 0.001
-    if (world.hit(r, 0.001, infinity, rec)) {
-        ray scattered;
-        color attenuation;
-        if (rec.mat_ptr->scatter(r, rec, attenuation, scattered))
-            return attenuation * ray_color(scattered, world, depth-1);
-        return color(0,0,0);
-    }
+// Renders the same frame with a growing number of threads. Every run must produce the
+// exact same framebuffer since pixels are seeded by position only.
+void measure_scaling(const hittable& world, const std::vector<material>& materials, const camera& cam, render_settings settings, unsigned max_threads) {
+    framebuffer reference(settings.image_width, settings.image_height);
+    double single_thread_seconds = 0.0;
 
-    vec3 unit_direction = unit_vector(r.direction()); // unit vector will be in range `-1.0 < val < 1.0`
-    auto t = 0.5*(unit_direction.y() + 1.0); // map (-1,1) to (0, 1)
-    return (1.0-t)*color(1.0, 1.0, 1.0) + t*color(0.5, 0.7, 1.0); // LERP/linear interpolation/blend `(1-t) * startValue + t * endValue`
-}
+    std::cout << "threads  seconds  speedup  efficiency  identical\n";
+    for (unsigned threads = 1;; threads = std::min(threads * 2, max_threads)) {
+        thread_pool pool(threads);
+        framebuffer fb(settings.image_width, settings.image_height);
 
-hittable_list random_scene() {
-    hittable_list world;
-
-    auto ground_material = std::make_shared<lambertian>(color(0.5, 0.5, 0.5));
-    world.add(std::make_shared<sphere>(point3(0,-1000,0), 1000, ground_material));
-
-    for (int a = -11; a < 11; a++) {
-        for (int b = -11; b < 11; b++) {
-            auto choose_mat = random_double();
-            point3 center(a + 0.9*random_double(), 0.2, b + 0.9*random_double());
-
-            if ((center - point3(4, 0.2, 0)).length() > 0.9) {
-                std::shared_ptr<material> sphere_material;
-
-                if (choose_mat < 0.8) {
-                    // diffuse
-                    auto albedo = color::random() * color::random();
-                    sphere_material = std::make_shared<lambertian>(albedo);
-                    world.add(std::make_shared<sphere>(center, 0.2, sphere_material));
-                } else if (choose_mat < 0.95) {
-                    // metal
-                    auto albedo = color::random(0.5, 1);
-                    auto fuzz = random_double(0, 0.5);
-                    sphere_material = std::make_shared<metal>(albedo, fuzz);
-                    world.add(std::make_shared<sphere>(center, 0.2, sphere_material));
-                } else {
-                    // glass
-                    sphere_material = std::make_shared<dielectric>(1.5);
-                    world.add(std::make_shared<sphere>(center, 0.2, sphere_material));
-                }
-            }
+        const auto start = std::chrono::steady_clock::now();
+        render(world, materials, cam, settings, pool, fb);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (threads == 1) {
+            reference = fb;
+            single_thread_seconds = elapsed.count();
         }
+        const auto speedup = single_thread_seconds / elapsed.count();
+        const bool identical = std::equal(fb.pixels.begin(), fb.pixels.end(), reference.pixels.begin(),
+                                          [](const color& a, const color& b) {
+                                              return a.x() == b.x() && a.y() == b.y() && a.z() == b.z();
+                                          });
+        std::cout << threads << "  " << elapsed.count() << "  " << speedup << "  "
+                  << speedup / threads << "  " << (identical ? "yes" : "NO") << '\n';
+        if (threads == max_threads)
+            break;
     }
+}
 
-    auto material1 = std::make_shared<dielectric>(1.5);
-    world.add(std::make_shared<sphere>(point3(0, 1, 0), 1.0, material1));
+/*!
+ * Renders `options.frames` frames of the animated scene. The thread pool, framebuffer and
+ * acceleration structure live across frames: between frames the objects move, the structure
+ * is refit instead of rebuilt and the framebuffer is cleared in place. One image writer and
+ * its thread write every frame.
+ */
+int render_sequence(const scene& world_scene, hittable& world, const render_options& options,
+                    const render_settings& settings, thread_pool& pool) {
+    animation_settings animation_options;
+    animation_options.frames = options.frames;
+    animation_options.fps = static_cast<real>(options.fps);
+    animation_options.orbit_degrees = static_cast<real>(options.orbit_degrees);
+    animation_options.bounce_height = static_cast<real>(options.bounce_height);
+    scene_animation animation(world_scene, animation_options);
 
-    auto material2 = std::make_shared<lambertian>(color(0.4, 0.2, 0.1));
-    world.add(std::make_shared<sphere>(point3(-4, 1, 0), 1.0, material2));
+    framebuffer fb(settings.image_width, settings.image_height);
+    if (options.denoise)
+        fb.enable_features();
+    denoise_settings denoise_options;
+    denoise_options.iterations = options.denoise_iterations;
 
-    auto material3 = std::make_shared<metal>(color(0.7, 0.6, 0.5), 0.0);
-    world.add(std::make_shared<sphere>(point3(4, 1, 0), 1.0, material3));
+    std::cout << "Rendering " << options.frames << " frames " << settings.image_width << 'x' << settings.image_height
+              << " @ " << settings.samples_per_pixel << " spp on " << pool.size() << " threads, "
+              << animation.moving_objects() << " moving spheres\n";
+    async_image_writer writer(make_image_writer(options.format), fb);
+    double setup_seconds = 0.0;
+    double render_seconds = 0.0;
+    for (int frame = 0; frame < options.frames; ++frame) {
+        const auto setup_start = std::chrono::steady_clock::now();
+        animation.move_objects(frame);
+        world.refit();
+        const camera cam = animation.frame_camera(frame);
+        fb.clear();
+        const std::chrono::duration<double> setup_time = std::chrono::steady_clock::now() - setup_start;
 
-    return world;
+        // rows of the frame are written while it renders, as for single images
+        const auto path = frame_path(options.output, frame);
+        if (!options.denoise && !writer.start(path))
+            return 1;
+        std::function<void(const tile&)> on_tile_done;
+        if (!options.denoise)
+            on_tile_done = [&writer](const tile& t) { writer.tile_done(t); };
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto stats = render(world, world_scene.materials, cam, settings, pool, fb, on_tile_done);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        const bool written = options.denoise ? write_image(denoise(fb, denoise_options, pool), options.format, path)
+                                             : writer.finish();
+        if (!written) {
+            std::cerr << "failed to write " << path << '\n';
+            return 1;
+        }
+        std::cout << "Frame " << frame << ": setup " << setup_time.count() * 1e3 << " ms, render " << elapsed.count()
+                  << " s, " << stats.rays / elapsed.count() / 1e6 << " Mrays/s, " << path << '\n';
+        setup_seconds += setup_time.count();
+        render_seconds += elapsed.count();
+    }
+    std::cout << "Average per frame: setup " << setup_seconds / options.frames * 1e3 << " ms, render "
+              << render_seconds / options.frames << " s\n";
+    return 0;
 }
 
-int main() {
-    // Image
-    const auto aspect_ratio = 3.0 / 2.0;
-    const int image_width = 1200;
-    const int image_height = static_cast<int>(image_width / aspect_ratio);
-    const int samples_per_pixel = 500;
-    const int max_depth = 50;
+int main(int argc, char* argv[]) {
+    const auto options = parse_options(argc, argv);
 
     // World
-    auto world = random_scene();
+    const auto load_start = std::chrono::steady_clock::now();
+    scene world_scene;
+    if (options.scene.empty()) {
+        seed_random(0);
+        world_scene = random_scene();
+    } else if (!load_scene(options.scene, world_scene)) {
+        return 1;
+    }
+    const auto& scene_objects = world_scene.objects;
+    if (!options.scene.empty()) {
+        const std::chrono::duration<double> load_time = std::chrono::steady_clock::now() - load_start;
+        std::cout << "Loaded " << options.scene << " in " << load_time.count() << " s\n";
+    }
+
+    if (!options.save_scene.empty()) {
+        if (!save_scene(world_scene, options.save_scene))
+            return 1;
+        std::cout << "Scene written to " << options.save_scene << '\n';
+        return 0;
+    }
+
+    // Image
+    const auto aspect_ratio = world_scene.view.aspect_ratio;
+    const int image_width = options.image_width;
+    const int image_height = std::max(2, static_cast<int>(image_width / aspect_ratio));
+    const int samples_per_pixel = options.samples_per_pixel;
+    const int max_depth = options.max_depth;
+
+    const auto build_start = std::chrono::steady_clock::now();
+    std::shared_ptr<hittable> world_ptr;
+    std::string accel_name = "linear";
+    if (options.accel == accel_type::bvh) {
+        world_ptr = std::make_shared<bvh_node>(scene_objects);
+        accel_name = "bvh";
+    } else if (options.accel == accel_type::simd) {
+        auto soa = std::make_shared<sphere_soa>(scene_objects, options.kernel);
+        accel_name = std::string("simd/") + to_string(soa->kernel());
+        world_ptr = soa;
+    } else {
+        world_ptr = std::make_shared<hittable_list>(scene_objects);
+    }
+    const hittable& world = *world_ptr;
+    const std::chrono::duration<double> build_time = std::chrono::steady_clock::now() - build_start;
+    std::cout << scene_objects.objects.size() << " objects, " << world_scene.materials.size() << " materials, "
+              << accel_name << " build time: " << build_time.count() << " s\n";
 
     // Camera
-    point3 lookfrom(13,2,3);
-    point3 lookat(0,0,0);
-    vec3 vup(0,1,0);
-    auto dist_to_focus = 10.0;
-    auto aperture = 0.1;
+    const camera cam = world_scene.view.make_camera();
 
-    camera cam(lookfrom, lookat, vup, 20, aspect_ratio, aperture, dist_to_focus);
+    if (options.measure_scaling) {
+        // reduced workload, otherwise the single threaded run alone takes hours
+        measure_scaling(world, world_scene.materials, cam, render_settings{image_width / 4, image_height / 4, 16, max_depth, options.tile_size, options.roulette_depth, options.sampler}, options.threads);
+        return 0;
+    }
 
     // Render
-    std::ofstream ofs;
-    ofs.open("./image.ppm", std::ios_base::trunc);
-    ofs << "P3\n" << image_width << ' ' << image_height << "\n255\n";
-
-    for (int j = image_height-1; j >= 0; --j) {
-        std::cout << "Scanlines remaining: " << j << '\n';
-        for (int i = 0; i < image_width; ++i) {
-            // A pixel is 1x1 in size of whatever unit, random sampling within this size
-            // to get color will reduce jaggedness. Very basic antialiasing approach.
-            color pixel_color(0, 0, 0);
-            for (int s = 0; s < samples_per_pixel; ++s) {
-                auto u = (i + random_double()) / (image_width-1);
-                auto v = (j + random_double()) / (image_height-1);
-                ray r = cam.get_ray(u, v);
-                pixel_color += ray_color(r, world, max_depth);
-            }
-            write_color(ofs, pixel_color, samples_per_pixel);
+    render_settings settings{image_width, image_height, samples_per_pixel, max_depth, options.tile_size};
+    settings.pass_samples = options.pass_samples;
+    settings.roulette_depth = options.roulette_depth;
+    settings.sampler = options.sampler;
+    settings.noise_threshold = options.noise_threshold;
+    if (options.frames > 0) {
+        thread_pool pool(options.threads);
+        return render_sequence(world_scene, *world_ptr, options, settings, pool);
+    }
+
+    framebuffer fb(image_width, image_height);
+    if (options.denoise)
+        fb.enable_features();
+    if (!options.resume.empty()) {
+        if (!load_checkpoint(options.resume, settings, fb))
+            return 1;
+        const auto resumed_samples = *std::min_element(fb.samples.begin(), fb.samples.end());
+        std::cout << "Resumed " << options.resume << " at " << resumed_samples << " spp\n";
+    }
+
+#ifdef RT_HAS_WORKER_PROCESSES
+    // forked before any thread exists, a child process only inherits the thread calling fork()
+    std::unique_ptr<worker_processes> workers;
+    if (options.workers > 0) {
+        workers = std::make_unique<worker_processes>(world, world_scene.materials, cam, settings, fb.has_features(), options.workers);
+        std::cout << "Worker processes:";
+        for (const auto pid : workers->pids())
+            std::cout << ' ' << pid;
+        std::cout << std::endl; // flushed, so scripts can pick up the pids right away
+    }
+#else
+    if (options.workers > 0) {
+        std::cerr << "worker processes are not supported on this platform\n";
+        return 1;
+    }
+#endif
+    // with worker processes only the denoiser runs on the pool
+    thread_pool pool(options.threads);
+
+    // Rows are written by a separate thread while the rest of the image is still rendering.
+    // Progressive renders instead rewrite the whole image after every pass, denoised and
+    // checkpointed (which may stop early) renders are written once rendering ended.
+    const bool stream_rows = !options.progressive && !options.denoise && options.checkpoint.empty();
+    async_image_writer writer(make_image_writer(options.format), fb);
+    if (stream_rows && !writer.start(options.output))
+        return 1;
+    std::function<void(const tile&)> on_tile_done;
+    if (stream_rows)
+        on_tile_done = [&writer](const tile& t) { writer.tile_done(t); };
+
+    if (!options.checkpoint.empty()) {
+        std::signal(SIGINT, request_stop);
+        std::signal(SIGTERM, request_stop);
+    }
+    auto last_checkpoint = std::chrono::steady_clock::now();
+    std::function<bool(int, const framebuffer&)> on_pass_done = [&](int pass, const framebuffer& current) {
+        if (options.progressive) {
+            write_image(current, options.format, options.output);
+            std::cout << "Pass " << pass << " written to " << options.output << '\n';
+        }
+        if (options.checkpoint.empty())
+            return true;
+        const auto now = std::chrono::steady_clock::now();
+        if (stop_requested || now - last_checkpoint >= std::chrono::duration<double>(options.checkpoint_interval)) {
+            if (save_checkpoint(current, settings, options.checkpoint))
+                std::cout << "Pass " << pass << " checkpointed to " << options.checkpoint << std::endl;
+            last_checkpoint = now;
+        }
+        return !stop_requested;
+    };
+
+    std::cout << "Rendering " << image_width << 'x' << image_height << " @ " << samples_per_pixel << " spp on "
+              << (options.workers > 0 ? options.workers : pool.size()) << (options.workers > 0 ? " processes, " : " threads, ")
+              << (sizeof(real) == sizeof(float) ? "float" : "double") << " precision, "
+              << to_string(settings.sampler) << " sampler\n";
+    const auto start = std::chrono::steady_clock::now();
+    render_stats stats;
+#ifdef RT_HAS_WORKER_PROCESSES
+    if (workers)
+        stats = workers->render(fb, options.sample_ranges, on_tile_done);
+    else
+#endif
+        stats = render(world, world_scene.materials, cam, settings, pool, fb, on_tile_done, on_pass_done);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    const auto fixed_samples = static_cast<std::uint64_t>(image_width) * image_height * samples_per_pixel;
+    std::cout << "Render time: " << elapsed.count() << " s, " << stats.passes << " passes\n"
+              << "Samples: " << stats.samples << " of " << fixed_samples << " at fixed spp ("
+              << 100.0 * stats.samples / fixed_samples << "%)\n"
+              << "Rays cast: " << stats.rays << " (" << stats.rays / elapsed.count() / 1e6 << " Mrays/s)\n";
+
+    if (!options.checkpoint.empty()) {
+        // the final state too, so the render can later be resumed with more samples
+        if (!save_checkpoint(fb, settings, options.checkpoint))
+            return 1;
+        if (stop_requested)
+            std::cout << "Stopped, continue with --resume " << options.checkpoint << '\n';
+    }
+
+    if (options.denoise) {
+        denoise_settings denoise_options;
+        denoise_options.iterations = options.denoise_iterations;
+        const auto denoise_start = std::chrono::steady_clock::now();
+        const auto denoised = denoise(fb, denoise_options, pool);
+        const std::chrono::duration<double> denoise_time = std::chrono::steady_clock::now() - denoise_start;
+        std::cout << "Denoise time: " << denoise_time.count() << " s\n";
+        if (!write_image(denoised, options.format, options.output)) {
+            std::cerr << "failed to write " << options.output << '\n';
+            return 1;
         }
+    } else if (stream_rows && !writer.finish()) {
+        std::cerr << "failed to write " << options.output << '\n';
+        return 1;
+    } else if (!stream_rows && !options.progressive && !write_image(fb, options.format, options.output)) {
+        std::cerr << "failed to write " << options.output << '\n';
+        return 1;
     }
     std::cout << "\nDone.\n";
-    ofs.close();
 
     return 0;
 }
\ No newline at end of file
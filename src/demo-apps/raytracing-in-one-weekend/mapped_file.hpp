@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RT_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define RT_HAS_MMAP 0
+#endif
+
+/*!
+ * Read-only view of a whole file. On POSIX systems the file is memory mapped, so only the
+ * pages that are actually touched get read from disk. Elsewhere it is read into memory.
+ */
+class mapped_file {
+public:
+    mapped_file() = default;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    ~mapped_file() {
+#if RT_HAS_MMAP
+        if (mapping)
+            munmap(mapping, length);
+#endif
+    }
+
+    bool open(const std::string& path) {
+#if RT_HAS_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info{};
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            length = static_cast<size_t>(info.st_size);
+            void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            mapping = address == MAP_FAILED ? nullptr : address;
+        }
+        ::close(fd); // the mapping stays valid after closing the descriptor
+        return mapping != nullptr;
+#else
+        std::ifstream in(path, std::ios_base::binary | std::ios_base::ate);
+        if (!in)
+            return false;
+        buffer.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        length = buffer.size();
+        return static_cast<bool>(in) && length > 0;
+#endif
+    }
+
+    const char* data() const {
+#if RT_HAS_MMAP
+        return static_cast<const char*>(mapping);
+#else
+        return buffer.data();
+#endif
+    }
+
+    size_t size() const { return length; }
+
+private:
+#if RT_HAS_MMAP
+    void* mapping = nullptr;
+#else
+    std::vector<char> buffer;
+#endif
+    size_t length = 0;
+};
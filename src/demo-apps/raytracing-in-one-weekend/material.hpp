@@ -1,83 +1,103 @@
 #pragma once
 
+#include <cstdint>
+
 #include "utils.hpp"
 #include "vec3.hpp"
 #include "hittable.hpp"
 
-class material {
-public:
-    virtual bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered) const = 0;
+enum class material_type : std::uint8_t {
+    lambertian,
+    metal,
+    dielectric,
 };
 
-class lambertian : public material {
-public:
-    lambertian(const color& a) : albedo(a) {}
-
-    virtual bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered) const override {
-        auto scatter_direction = rec.normal + random_unit_vector();
-
-        // Catch degenerate scatter direction
-        if (scatter_direction.near_zero())
-            scatter_direction = rec.normal;
-
-        scattered = ray(rec.p, scatter_direction);
-        attenuation = albedo;
-        return true;
-    }
-
-public:
-    color albedo;
+/*!
+ * Tagged material, every scene keeps them in one contiguous `std::vector<material>` and
+ * `hit_record::mat_id` indexes into it. `scatter` dispatches with a switch, so the path
+ * tracing loop has neither virtual calls nor shared_ptr refcounting per bounce.
+ */
+struct material {
+    material_type type = material_type::lambertian;
+    color albedo{0, 0, 0}; // lambertian, metal
+    real fuzz = 0;         // metal
+    real ir = 1;           // dielectric, index of refraction
 };
 
-class metal : public material {
-public:
-    metal(const color& a, float f) : albedo(a), fuzz(f < 1 ? f : 1) {}
-
-    virtual bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered) const override {
-        vec3 reflected = reflect(unit_vector(r_in.direction()), rec.normal);
-        auto fuzzVec = fuzz*random_in_unit_sphere(); // low fuzz means sharper reflections
-        scattered = ray(rec.p, reflected + fuzzVec);
-        attenuation = albedo;
-        // return false if scatter direction is behind normal or points inside the object
-        return (dot(scattered.direction(), rec.normal) > 0);
+inline material lambertian(const color& a) {
+    material m;
+    m.type = material_type::lambertian;
+    m.albedo = a;
+    return m;
+}
+
+inline material metal(const color& a, real f) {
+    material m;
+    m.type = material_type::metal;
+    m.albedo = a;
+    m.fuzz = f < 1 ? f : 1;
+    return m;
+}
+
+inline material dielectric(real index_of_refraction) {
+    material m;
+    m.type = material_type::dielectric;
+    m.ir = index_of_refraction;
+    return m;
+}
+
+// Albedo as seen by the denoiser, glass passes all light through.
+inline color feature_albedo(const material& m) {
+    return m.type == material_type::dielectric ? color(1, 1, 1) : m.albedo;
+}
+
+inline real reflectance(real cosine, real ref_idx) {
+    // Use Schlick's approximation for reflectance.
+    auto r0 = (1-ref_idx) / (1+ref_idx);
+    r0 = r0*r0;
+    return r0 + (1-r0)*std::pow((1 - cosine),5);
+}
+
+inline bool scatter(const material& m, const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered) {
+    switch (m.type) {
+        case material_type::lambertian: {
+            auto scatter_direction = rec.normal + random_unit_vector();
+
+            // Catch degenerate scatter direction
+            if (scatter_direction.near_zero())
+                scatter_direction = rec.normal;
+
+            scattered = ray(rec.p, scatter_direction);
+            attenuation = m.albedo;
+            return true;
+        }
+        case material_type::metal: {
+            vec3 reflected = reflect(unit_vector(r_in.direction()), rec.normal);
+            auto fuzzVec = m.fuzz*random_in_unit_sphere(); // low fuzz means sharper reflections
+            scattered = ray(rec.p, reflected + fuzzVec);
+            attenuation = m.albedo;
+            // return false if scatter direction is behind normal or points inside the object
+            return (dot(scattered.direction(), rec.normal) > 0);
+        }
+        case material_type::dielectric: {
+            attenuation = color(1.0, 1.0, 1.0);
+            real refraction_ratio = rec.front_face ? (1/m.ir) : m.ir;
+
+            vec3 unit_direction = unit_vector(r_in.direction());
+            real cos_theta = std::fmin(dot(-unit_direction, rec.normal), real(1));
+            real sin_theta = std::sqrt(1 - cos_theta*cos_theta);
+
+            bool cannot_refract = refraction_ratio * sin_theta > 1.0;
+            vec3 direction;
+
+            if (cannot_refract || reflectance(cos_theta, refraction_ratio) > random_double())
+                direction = reflect(unit_direction, rec.normal);
+            else
+                direction = refract(unit_direction, rec.normal, refraction_ratio);
+
+            scattered = ray(rec.p, direction);
+            return true;
+        }
     }
-
-public:
-    color albedo;
-    double fuzz;
-};
-
-class dielectric : public material {
-public:
-    dielectric(double index_of_refraction) : ir(index_of_refraction) {}
-
-    virtual bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered) const override {
-        attenuation = color(1.0, 1.0, 1.0);
-        double refraction_ratio = rec.front_face ? (1.0/ir) : ir;
-
-        vec3 unit_direction = unit_vector(r_in.direction());
-        double cos_theta = fmin(dot(-unit_direction, rec.normal), 1.0);
-        double sin_theta = sqrt(1.0 - cos_theta*cos_theta);
-
-        bool cannot_refract = refraction_ratio * sin_theta > 1.0;
-        vec3 direction;
-
-        if (cannot_refract || reflectance(cos_theta, refraction_ratio) > random_double())
-            direction = reflect(unit_direction, rec.normal);
-        else
-            direction = refract(unit_direction, rec.normal, refraction_ratio);
-
-        scattered = ray(rec.p, direction);
-        return true;
-    }
-
-private:
-    double ir; // Index of Refraction
-
-    static double reflectance(double cosine, double ref_idx) {
-        // Use Schlick's approximation for reflectance.
-        auto r0 = (1-ref_idx) / (1+ref_idx);
-        r0 = r0*r0;
-        return r0 + (1-r0)*pow((1 - cosine),5);
-    }
-};
+    return false;
+}
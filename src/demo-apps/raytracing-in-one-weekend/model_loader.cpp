@@ -0,0 +1,24 @@
+// Separate translation unit so the raytracer headers never see the GL/glm headers of the
+// graphics library, `Model::loadGeometry` itself doesn't need an OpenGL context.
+
+#include "model_loader.hpp"
+
+#include <graphics/Model.hpp>
+
+bool load_model_triangles(const std::string& path, std::vector<float>& positions, std::vector<std::uint32_t>& indices) {
+    const auto meshes = Model::loadGeometry(path.c_str());
+    const auto indices_before = indices.size();
+
+    for (const auto& mesh : meshes) {
+        const auto base = static_cast<std::uint32_t>(positions.size() / 3);
+        positions.reserve(positions.size() + mesh.positions.size() * 3);
+        for (const auto& p : mesh.positions) {
+            positions.push_back(p.x);
+            positions.push_back(p.y);
+            positions.push_back(p.z);
+        }
+        for (const auto index : mesh.indices)
+            indices.push_back(base + index);
+    }
+    return indices.size() > indices_before;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Appends the triangles of every mesh in a model file (OBJ, DAE, FBX, ...) as one indexed
+// triangle list. Implemented in model_loader.cpp on top of `Model::loadGeometry` of the
+// graphics library, only available in builds with RT_HAS_MODEL_LOADER.
+bool load_model_triangles(const std::string& path, std::vector<float>& positions, std::vector<std::uint32_t>& indices);
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "sphere_soa.hpp"
+#include "image_writer.hpp"
+
+enum class accel_type {
+    linear, // test every object of the hittable_list
+    bvh,
+    simd, // sphere_soa, vectorized over spheres
+};
+
+struct render_options {
+    int image_width = 1200;
+    int samples_per_pixel = 500;
+    int max_depth = 50;
+    int roulette_depth = 3;
+    int pass_samples = 0;          // 0: single pass, or 16 with --adaptive/--progressive/--checkpoint
+    double noise_threshold = 0.0;  // > 0 enables adaptive sampling
+    bool progressive = false;      // rewrite the output image after every pass
+    bool denoise = false;          // filter the final image with the albedo/normal guided denoiser
+    int denoise_iterations = 3;
+    unsigned threads = std::thread::hardware_concurrency();
+    unsigned workers = 0;   // > 0 renders with worker processes instead of threads
+    int sample_ranges = 1;  // jobs per tile with worker processes, each renders a range of the samples
+    std::string checkpoint;           // save the accumulation buffers here every checkpoint_interval seconds
+    double checkpoint_interval = 300.0;
+    std::string resume;               // checkpoint to continue from
+    int frames = 0;                   // > 0 renders an animated sequence, output gets a frame number suffix
+    double fps = 24.0;
+    double orbit_degrees = 30.0;
+    double bounce_height = 0.5;
+    int tile_size = 32;
+    accel_type accel = accel_type::bvh;
+    simd_kernel kernel = detect_simd_kernel();
+    sampler_type sampler = sampler_type::sobol;
+    std::string scene;      // scene file, the built-in random scene if empty
+    std::string save_scene; // write the scene as binary scene file and exit
+    std::string output = "./image.ppm";
+    image_format format = image_format::ppm;
+    // render the scene with 1,2,4..threads workers and report speedup instead of writing an image
+    bool measure_scaling = false;
+};
+
+void print_usage(const char* app) {
+    std::cout << "usage: " << app << " [options]\n"
+              << "  --scene <path>    JSON or binary scene file (default: the random spheres scene)\n"
+              << "  --save-scene <path> convert the scene to the memory mappable binary format and exit\n"
+              << "  --width <n>       image width, height follows the camera aspect ratio (default: 1200)\n"
+              << "  --spp <n>         samples per pixel (default: 500)\n"
+              << "  --max-depth <n>   maximum ray bounces (default: 50)\n"
+              << "  --roulette-depth <n> bounces before Russian roulette, >= max-depth disables (default: 3)\n"
+              << "  --adaptive <e>    stop sampling pixels whose display value noise is below e, e.g. 0.005\n"
+              << "  --progressive     rewrite the output image after every pass\n"
+              << "  --pass-samples <n> samples per pixel and pass (default: 16 with --adaptive/--progressive/--checkpoint)\n"
+              << "  --denoise         edge-avoiding a-trous filter guided by first hit albedo and normals\n"
+              << "  --denoise-iterations <n> filter iterations, the radius doubles with each (default: 3)\n"
+              << "  --checkpoint <path> save the accumulation buffers after passes and on SIGINT/SIGTERM\n"
+              << "  --checkpoint-interval <s> seconds between checkpoints (default: 300)\n"
+              << "  --resume <path>   continue a checkpointed render, --spp may be raised\n"
+              << "  --frames <n>      render an animated sequence, image_0000.ppm, image_0001.ppm, ...\n"
+              << "  --fps <n>         frames per second of the sequence (default: 24)\n"
+              << "  --orbit <deg>     camera rotation around the look-at point over the sequence (default: 30)\n"
+              << "  --bounce <h>      bounce height of the small spheres (default: 0.5)\n"
+              << "  --output <path>   image file to write (default: ./image.ppm)\n"
+              << "  --format <type>   ppm | ppm-ascii | png | pfm (default: from the --output extension)\n"
+              << "  --threads <n>     number of render threads (default: all cores)\n"
+              << "  --workers <n>     render with n forked worker processes instead of threads, a killed\n"
+              << "                    worker's tiles are reassigned (not with --adaptive/--progressive)\n"
+              << "  --sample-ranges <n> split the samples of every tile into n worker jobs (default: 1)\n"
+              << "  --tile-size <n>   tile edge length in pixels (default: 32)\n"
+              << "  --accel <type>    linear | bvh | simd (default: bvh)\n"
+              << "  --kernel <type>   scalar | sse2 | avx2, kernel of --accel simd (default: fastest supported)\n"
+              << "  --sampler <type>  sobol | pcg32 | xoshiro256 (default: sobol)\n"
+              << "  --scaling         measure speedup over thread counts and verify determinism\n";
+}
+
+render_options parse_options(int argc, char* argv[]) {
+    render_options options;
+    bool format_given = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const auto next_value = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << "missing value for " << arg << '\n';
+                std::exit(EXIT_FAILURE);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--scene") {
+            options.scene = next_value();
+        } else if (arg == "--save-scene") {
+            options.save_scene = next_value();
+        } else if (arg == "--width") {
+            options.image_width = std::max(2, std::atoi(next_value()));
+        } else if (arg == "--spp") {
+            options.samples_per_pixel = std::max(1, std::atoi(next_value()));
+        } else if (arg == "--max-depth") {
+            options.max_depth = std::max(1, std::atoi(next_value()));
+        } else if (arg == "--roulette-depth") {
+            options.roulette_depth = std::max(1, std::atoi(next_value()));
+        } else if (arg == "--adaptive") {
+            options.noise_threshold = std::max(0.0, std::atof(next_value()));
+        } else if (arg == "--progressive") {
+            options.progressive = true;
+        } else if (arg == "--denoise") {
+            options.denoise = true;
+        } else if (arg == "--denoise-iterations") {
+            options.denoise_iterations = std::max(1, std::atoi(next_value()));
+        } else if (arg == "--pass-samples") {
+            options.pass_samples = std::max(1, std::atoi(next_value()));
+        } else if (arg == "--checkpoint") {
+            options.checkpoint = next_value();
+        } else if (arg == "--checkpoint-interval") {
+            options.checkpoint_interval = std::max(0.0, std::atof(next_value()));
+        } else if (arg == "--resume") {
+            options.resume = next_value();
+        } else if (arg == "--frames") {
+            options.frames = std::max(0, std::atoi(next_value()));
+        } else if (arg == "--fps") {
+            options.fps = std::max(1.0, std::atof(next_value()));
+        } else if (arg == "--orbit") {
+            options.orbit_degrees = std::atof(next_value());
+        } else if (arg == "--bounce") {
+            options.bounce_height = std::max(0.0, std::atof(next_value()));
+        } else if (arg == "--output") {
+            options.output = next_value();
+        } else if (arg == "--format") {
+            const std::string value = next_value();
+            format_given = true;
+            if (value == "ppm") {
+                options.format = image_format::ppm;
+            } else if (value == "ppm-ascii") {
+                options.format = image_format::ppm_ascii;
+            } else if (value == "png") {
+                options.format = image_format::png;
+            } else if (value == "pfm") {
+                options.format = image_format::pfm;
+            } else {
+                std::cerr << "unknown image format " << value << '\n';
+                std::exit(EXIT_FAILURE);
+            }
+        } else if (arg == "--threads") {
+            options.threads = static_cast<unsigned>(std::max(1, std::atoi(next_value())));
+        } else if (arg == "--workers") {
+            options.workers = static_cast<unsigned>(std::max(0, std::atoi(next_value())));
+        } else if (arg == "--sample-ranges") {
+            options.sample_ranges = std::max(1, std::atoi(next_value()));
+        } else if (arg == "--tile-size") {
+            options.tile_size = std::max(1, std::atoi(next_value()));
+        } else if (arg == "--accel") {
+            const std::string value = next_value();
+            if (value == "linear") {
+                options.accel = accel_type::linear;
+            } else if (value == "bvh") {
+                options.accel = accel_type::bvh;
+            } else if (value == "simd") {
+                options.accel = accel_type::simd;
+            } else {
+                std::cerr << "unknown acceleration structure " << value << '\n';
+                std::exit(EXIT_FAILURE);
+            }
+        } else if (arg == "--kernel") {
+            const std::string value = next_value();
+            if (value == "scalar") {
+                options.kernel = simd_kernel::scalar;
+            } else if (value == "sse2") {
+                options.kernel = simd_kernel::sse2;
+            } else if (value == "avx2") {
+                options.kernel = simd_kernel::avx2;
+            } else {
+                std::cerr << "unknown kernel " << value << '\n';
+                std::exit(EXIT_FAILURE);
+            }
+        } else if (arg == "--sampler") {
+            const std::string value = next_value();
+            if (value == "sobol") {
+                options.sampler = sampler_type::sobol;
+            } else if (value == "pcg32") {
+                options.sampler = sampler_type::pcg32;
+            } else if (value == "xoshiro256") {
+                options.sampler = sampler_type::xoshiro256;
+            } else {
+                std::cerr << "unknown sampler " << value << '\n';
+                std::exit(EXIT_FAILURE);
+            }
+        } else if (arg == "--scaling") {
+            options.measure_scaling = true;
+        } else {
+            print_usage(argv[0]);
+            std::exit(arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    if (options.workers > 0 && (options.noise_threshold > 0.0 || options.progressive || !options.checkpoint.empty() || !options.resume.empty())) {
+        // workers only see their own samples of a pixel and render without passes
+        std::cerr << "--workers can't be combined with --adaptive, --progressive, --checkpoint or --resume\n";
+        std::exit(EXIT_FAILURE);
+    }
+    if (options.frames > 0 && (options.workers > 0 || options.progressive || !options.checkpoint.empty() || !options.resume.empty())) {
+        std::cerr << "--frames can't be combined with --workers, --progressive, --checkpoint or --resume\n";
+        std::exit(EXIT_FAILURE);
+    }
+    // checkpoints are taken between passes
+    if (options.pass_samples == 0 && (options.noise_threshold > 0.0 || options.progressive || !options.checkpoint.empty()))
+        options.pass_samples = 16;
+    if (!format_given)
+        options.format = format_from_path(options.output);
+
+    return options;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+
+#include "scene.hpp"
+#include "sphere.hpp"
+#include "utils.hpp"
+
+// Final scene of the book: three big spheres surrounded by (2 * grid)^2 small ones, minus
+// the few that would intersect the metal sphere. Depends on the state of `random_double()`,
+// seed it first to get the same scene every run.
+scene random_scene(int grid = 11) {
+    scene world;
+
+    auto ground_material = world.add_material(lambertian(color(0.5, 0.5, 0.5)));
+    world.objects.add(std::make_shared<sphere>(point3(0,-1000,0), 1000, ground_material));
+
+    for (int a = -grid; a < grid; a++) {
+        for (int b = -grid; b < grid; b++) {
+            auto choose_mat = random_double();
+            point3 center(a + 0.9*random_double(), 0.2, b + 0.9*random_double());
+
+            if ((center - point3(4, 0.2, 0)).length() > 0.9) {
+                int sphere_material;
+
+                if (choose_mat < 0.8) {
+                    // diffuse
+                    auto albedo = color::random() * color::random();
+                    sphere_material = world.add_material(lambertian(albedo));
+                    world.objects.add(std::make_shared<sphere>(center, 0.2, sphere_material));
+                } else if (choose_mat < 0.95) {
+                    // metal
+                    auto albedo = color::random(0.5, 1);
+                    auto fuzz = random_double(0, 0.5);
+                    sphere_material = world.add_material(metal(albedo, fuzz));
+                    world.objects.add(std::make_shared<sphere>(center, 0.2, sphere_material));
+                } else {
+                    // glass
+                    sphere_material = world.add_material(dielectric(1.5));
+                    world.objects.add(std::make_shared<sphere>(center, 0.2, sphere_material));
+                }
+            }
+        }
+    }
+
+    auto material1 = world.add_material(dielectric(1.5));
+    world.objects.add(std::make_shared<sphere>(point3(0, 1, 0), 1.0, material1));
+
+    auto material2 = world.add_material(lambertian(color(0.4, 0.2, 0.1)));
+    world.objects.add(std::make_shared<sphere>(point3(-4, 1, 0), 1.0, material2));
+
+    auto material3 = world.add_material(metal(color(0.7, 0.6, 0.5), 0.0));
+    world.objects.add(std::make_shared<sphere>(point3(4, 1, 0), 1.0, material3));
+
+    return world;
+}
@@ -2,21 +2,24 @@
 
 #include "vec3.hpp"
 
-class ray {
+template<typename T>
+class ray_t {
 public:
-    ray() {}
-    ray(const point3& origin, const vec3& direction)
+    ray_t() {}
+    ray_t(const vec3_t<T>& origin, const vec3_t<T>& direction)
             : orig(origin), dir(direction)
     {}
 
-    point3 origin() const  { return orig; }
-    vec3 direction() const { return dir; }
+    vec3_t<T> origin() const  { return orig; }
+    vec3_t<T> direction() const { return dir; }
 
-    point3 at(double t) const {
+    vec3_t<T> at(T t) const {
         return orig + t*dir;
     }
 
 public:
-    point3 orig;
-    vec3 dir;
-};
\ No newline at end of file
+    vec3_t<T> orig;
+    vec3_t<T> dir;
+};
+
+using ray = ray_t<real>;
\ No newline at end of file
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "vec3.hpp"
+#include "ray.hpp"
+#include "utils.hpp"
+#include "hittable.hpp"
+#include "camera.hpp"
+#include "material.hpp"
+#include "thread_pool.hpp"
+
+// Rays traced by the calling thread, read before and after a tile to get its ray count.
+inline std::uint64_t& ray_counter() {
+    thread_local std::uint64_t count = 0;
+    return count;
+}
+
+inline color sky_color(const ray& r) {
+    vec3 unit_direction = unit_vector(r.direction()); // unit vector will be in range `-1.0 < val < 1.0`
+    auto t = 0.5*(unit_direction.y() + 1.0); // map (-1,1) to (0, 1)
+    return (1.0-t)*color(1.0, 1.0, 1.0) + t*color(0.5, 0.7, 1.0); // LERP/linear interpolation/blend `(1-t) * startValue + t * endValue`
+}
+
+// Surface seen through a pixel, the denoiser uses it to tell edges from noise.
+struct pixel_features {
+    color albedo;
+    vec3 normal;
+};
+
+/*!
+ * Iterative path tracer. Instead of multiplying the attenuation on the way back up a
+ * recursion, the product of all attenuations so far (`throughput`) is carried along the path.
+ *
+ * After `roulette_depth` bounces a path survives each further bounce with a probability equal
+ * to its brightest throughput channel and is re-weighted by 1/probability, so dim paths end
+ * early without biasing the image.
+ */
+color ray_color(const ray& r, const hittable& world, const std::vector<material>& materials,
+                int max_depth, int roulette_depth, pixel_features* features = nullptr) {
+    color throughput(1, 1, 1);
+    ray current = r;
+
+    for (int depth = 0; depth < max_depth; ++depth) {
+        ++ray_counter();
+
+        hit_record rec;
+        // Fix shadow acne by using 0.001
+        if (!world.hit(current, 0.001, infinity, rec)) {
+            if (features && depth == 0)
+                *features = {sky_color(current), vec3(0, 0, 0)};
+            return throughput * sky_color(current);
+        }
+        if (features && depth == 0)
+            *features = {feature_albedo(materials[rec.mat_id]), rec.normal};
+
+        ray scattered;
+        color attenuation;
+        if (!scatter(materials[rec.mat_id], current, rec, attenuation, scattered))
+            return color(0,0,0);
+        throughput = throughput * attenuation;
+
+        if (depth + 1 >= roulette_depth) {
+            const auto survival = std::min<real>(std::max({throughput.x(), throughput.y(), throughput.z()}), 0.95);
+            if (random_double() >= survival)
+                return color(0,0,0);
+            throughput /= survival;
+        }
+        current = scattered;
+    }
+
+    return color(0,0,0);
+}
+
+struct render_settings {
+    int image_width;
+    int image_height;
+    int samples_per_pixel;
+    int max_depth;
+    int tile_size = 32;
+    // Bounces before Russian roulette may terminate a path, >= max_depth disables it.
+    int roulette_depth = 3;
+    sampler_type sampler = sampler_type::sobol;
+    // Samples added to every pixel per pass, 0 takes all samples in a single pass.
+    int pass_samples = 0;
+    // Adaptive sampling: a pixel stops receiving samples once the standard error of its
+    // gamma encoded value is below this threshold. 0 disables it.
+    double noise_threshold = 0.0;
+};
+
+struct render_stats {
+    std::uint64_t samples = 0;
+    std::uint64_t rays = 0;
+    int passes = 0;
+};
+
+/*!
+ * Sum of all samples of every pixel plus the per-pixel sample count, which differs between
+ * pixels with adaptive sampling. Row 0 is the bottom scanline, same as the `v` axis of the
+ * camera, so output has to be written starting from the last row.
+ *
+ * A framebuffer may also cover just a part of the image, e.g. the tile a worker process
+ * renders: pixel coordinates stay image coordinates, `origin_x/y` is its lower left pixel.
+ */
+struct framebuffer {
+    framebuffer(int w, int h)
+        : width(w), height(h), pixels(static_cast<std::size_t>(w) * h),
+          samples(pixels.size(), 0), luminance_squared(pixels.size(), 0.0) {}
+    framebuffer(int w, int h, int x, int y) : framebuffer(w, h) {
+        origin_x = x;
+        origin_y = y;
+    }
+
+    // Also accumulate first hit albedo and normal of every sample, needed by the denoiser.
+    void enable_features() {
+        albedo.assign(pixels.size(), color(0, 0, 0));
+        normal.assign(pixels.size(), vec3(0, 0, 0));
+    }
+    bool has_features() const { return !albedo.empty(); }
+
+    // Drops all samples but keeps the allocations, e.g. for the next frame of a sequence.
+    void clear() {
+        std::fill(pixels.begin(), pixels.end(), color(0, 0, 0));
+        std::fill(samples.begin(), samples.end(), 0u);
+        std::fill(luminance_squared.begin(), luminance_squared.end(), 0.0);
+        std::fill(albedo.begin(), albedo.end(), color(0, 0, 0));
+        std::fill(normal.begin(), normal.end(), vec3(0, 0, 0));
+    }
+
+    size_t index(int i, int j) const { return static_cast<std::size_t>(j - origin_y) * width + (i - origin_x); }
+    color& at(int i, int j) { return pixels[index(i, j)]; }
+    const color& at(int i, int j) const { return pixels[index(i, j)]; }
+
+    int width;
+    int height;
+    int origin_x = 0;
+    int origin_y = 0;
+    std::vector<color> pixels;
+    std::vector<std::uint32_t> samples;
+    std::vector<double> luminance_squared; // sum of squared sample luminance, for the variance
+    std::vector<color> albedo; // sums like `pixels`, empty unless enabled
+    std::vector<vec3> normal;
+};
+
+inline double luminance(const color& c) {
+    return 0.2126 * c.x() + 0.7152 * c.y() + 0.0722 * c.z();
+}
+
+bool pixel_converged(const framebuffer& fb, size_t idx, double threshold) {
+    const double n = fb.samples[idx];
+    if (n < 2)
+        return false;
+    const auto mean = luminance(fb.pixels[idx]) / n;
+    const auto variance = std::max(0.0, (fb.luminance_squared[idx] / n - mean * mean) * n / (n - 1));
+    const auto std_error = std::sqrt(variance / n);
+    // output is gamma 2 encoded, d sqrt(x)/dx = 1/(2 sqrt(x)) scales the error into display space
+    const auto display_error = std_error / (2.0 * std::sqrt(std::max(mean, 1e-4)));
+    return display_error <= threshold;
+}
+
+// Half-open pixel rectangle [x0,x1) x [y0,y1).
+struct tile {
+    int x0, y0, x1, y1;
+};
+
+std::vector<tile> make_tiles(int width, int height, int tile_size) {
+    std::vector<tile> tiles;
+    // top rows first so the upper part of the image finishes first, same as the old scanline order
+    for (int y1 = height; y1 > 0; y1 -= tile_size) {
+        for (int x0 = 0; x0 < width; x0 += tile_size)
+            tiles.push_back({x0, std::max(0, y1 - tile_size), std::min(width, x0 + tile_size), y1});
+    }
+    return tiles;
+}
+
+// Seed only depends on the pixel position, never on the thread or tile that renders it. Later
+// passes continue the pixel's sample sequence at the sample count it already has.
+inline std::uint64_t pixel_seed(int i, int j, int image_width) {
+    return static_cast<std::uint64_t>(j) * image_width + i;
+}
+
+// Adds `sample_count` samples to every pixel of the tile that isn't converged yet, never more
+// than `settings.samples_per_pixel` in total. Returns the samples taken.
+std::uint64_t render_tile(const hittable& world, const std::vector<material>& materials, const camera& cam, const render_settings& settings,
+                          const tile& t, int max_sample_count, framebuffer& fb) {
+    std::uint64_t taken = 0;
+    for (int j = t.y0; j < t.y1; ++j) {
+        for (int i = t.x0; i < t.x1; ++i) {
+            const auto idx = fb.index(i, j);
+            if (settings.noise_threshold > 0.0 && pixel_converged(fb, idx, settings.noise_threshold))
+                continue;
+            const int sample_count = std::min(max_sample_count, settings.samples_per_pixel - static_cast<int>(fb.samples[idx]));
+            if (sample_count <= 0)
+                continue;
+
+            const auto seed = pixel_seed(i, j, settings.image_width);
+            // A pixel is 1x1 in size of whatever unit, random sampling within this size
+            // to get color will reduce jaggedness. Very basic antialiasing approach.
+            color pixel_color(0, 0, 0);
+            double luminance_squared = 0.0;
+            pixel_features features{};
+            color albedo_sum(0, 0, 0);
+            vec3 normal_sum(0, 0, 0);
+            const bool want_features = fb.has_features();
+            for (int s = 0; s < sample_count; ++s) {
+                start_sample(settings.sampler, seed, fb.samples[idx] + static_cast<std::uint32_t>(s));
+                auto u = (i + random_double()) / (settings.image_width-1);
+                auto v = (j + random_double()) / (settings.image_height-1);
+                ray r = cam.get_ray(u, v);
+                const auto sample = ray_color(r, world, materials, settings.max_depth, settings.roulette_depth,
+                                              want_features ? &features : nullptr);
+                pixel_color += sample;
+                if (want_features) {
+                    albedo_sum += features.albedo;
+                    normal_sum += features.normal;
+                }
+                luminance_squared += luminance(sample) * luminance(sample);
+            }
+            fb.pixels[idx] += pixel_color;
+            fb.luminance_squared[idx] += luminance_squared;
+            fb.samples[idx] += sample_count;
+            if (want_features) {
+                fb.albedo[idx] += albedo_sum;
+                fb.normal[idx] += normal_sum;
+            }
+            taken += sample_count;
+        }
+    }
+    return taken;
+}
+
+/*!
+ * Renders `settings.samples_per_pixel` samples in passes of `settings.pass_samples`, stops
+ * early once adaptive sampling considers every pixel converged. A framebuffer that already
+ * has samples, e.g. restored from a checkpoint, continues where it left off.
+ *
+ * `on_tile_done` is called from the render thread once a tile has received its final samples,
+ * `on_pass_done` from the calling thread after every pass, returning false stops the render
+ * after that pass. Tiles of a render that stopped early are reported from the calling thread
+ * before returning, so a consumer waiting for every tile (e.g. `async_image_writer`) never
+ * blocks.
+ */
+render_stats render(const hittable& world, const std::vector<material>& materials, const camera& cam, const render_settings& settings,
+                    thread_pool& pool, framebuffer& fb,
+                    const std::function<void(const tile&)>& on_tile_done = {},
+                    const std::function<bool(int pass, const framebuffer&)>& on_pass_done = {}) {
+    const auto tiles = make_tiles(settings.image_width, settings.image_height, settings.tile_size);
+    const int pass_samples = settings.pass_samples > 0 ? settings.pass_samples : settings.samples_per_pixel;
+    const int samples_before = fb.samples.empty() ? 0 : static_cast<int>(*std::min_element(fb.samples.begin(), fb.samples.end()));
+
+    render_stats stats;
+    bool tiles_reported = false;
+    for (int first_sample = samples_before; first_sample < settings.samples_per_pixel; first_sample += pass_samples) {
+        const int sample_count = std::min(pass_samples, settings.samples_per_pixel - first_sample);
+        const bool last_pass = first_sample + sample_count >= settings.samples_per_pixel;
+
+        std::atomic<std::uint64_t> pass_samples_taken{0};
+        std::atomic<std::uint64_t> pass_rays{0};
+        pool.parallel_for(static_cast<int>(tiles.size()), [&](int idx) {
+            const auto rays_before = ray_counter();
+            pass_samples_taken += render_tile(world, materials, cam, settings, tiles[idx], sample_count, fb);
+            pass_rays += ray_counter() - rays_before;
+            if (last_pass && on_tile_done)
+                on_tile_done(tiles[idx]);
+        });
+        tiles_reported = last_pass;
+
+        stats.samples += pass_samples_taken;
+        stats.rays += pass_rays;
+        ++stats.passes;
+        if (on_pass_done && !on_pass_done(stats.passes, fb))
+            break;
+        if (pass_samples_taken == 0)
+            break; // every pixel converged
+    }
+
+    if (!tiles_reported && on_tile_done) {
+        for (const auto& t : tiles)
+            on_tile_done(t);
+    }
+    return stats;
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Sample generators behind `random_double()`. Every render thread owns one `sampler`, the
+ * renderer restarts it for every sample of every pixel (`start_sample`), so an image only
+ * depends on pixel positions and sample indices, never on threads or tiles.
+ *
+ * The pseudo random generators are small enough to reseed per sample. The Sobol sampler
+ * hands out dimension after dimension of one low discrepancy point per sample: the first
+ * `random_double()` calls of a sample (pixel jitter, lens, first bounce) are stratified
+ * against each other and against the other samples of the pixel.
+ */
+
+enum class sampler_type {
+    pcg32,
+    xoshiro256,
+    sobol, // Owen scrambled, shuffled per pixel
+};
+
+inline const char* to_string(sampler_type type) {
+    switch (type) {
+        case sampler_type::pcg32: return "pcg32";
+        case sampler_type::xoshiro256: return "xoshiro256++";
+        default: return "sobol";
+    }
+}
+
+// SplitMix64 finalizer - spreads consecutive seeds (e.g. pixel indices) over the whole range.
+inline std::uint64_t mix_seed(std::uint64_t seed) {
+    seed += 0x9e3779b97f4a7c15ull;
+    seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ull;
+    seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebull;
+    return seed ^ (seed >> 31);
+}
+
+// PCG-XSH-RR - https://www.pcg-random.org, 16 bytes of state, one multiply per number.
+struct pcg32 {
+    std::uint64_t state = 0;
+    std::uint64_t increment = 1;
+
+    void seed(std::uint64_t seed, std::uint64_t stream) {
+        state = 0;
+        increment = (stream << 1u) | 1u;
+        next();
+        state += seed;
+        next();
+    }
+
+    std::uint32_t next() {
+        const auto old = state;
+        state = old * 6364136223846793005ull + increment;
+        const auto xorshifted = static_cast<std::uint32_t>(((old >> 18u) ^ old) >> 27u);
+        const auto rot = static_cast<std::uint32_t>(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+    // [0,1) with 32 bits of resolution
+    double next_double() { return next() * 0x1p-32; }
+};
+
+// xoshiro256++ - https://prng.di.unimi.it, 64 bits per call, enough for a full double mantissa.
+struct xoshiro256 {
+    std::uint64_t s[4] = {};
+
+    void seed(std::uint64_t seed) {
+        for (auto& word : s) {
+            seed = mix_seed(seed);
+            word = seed;
+        }
+    }
+
+    static std::uint64_t rotl(std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    std::uint64_t next() {
+        const auto result = rotl(s[0] + s[3], 23) + s[0];
+        const auto t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // [0,1) with 53 bits of resolution
+    double next_double() { return (next() >> 11) * 0x1p-53; }
+};
+
+/*!
+ * Direction numbers of the first 4 Sobol dimensions, primitive polynomials and initial values
+ * from Joe & Kuo - https://web.maths.unsw.edu.au/~fkuo/sobol/
+ *
+ * Stored as XOR tables per 4 bit chunk of the index, so a point takes 8 lookups instead of a
+ * loop over all 32 index bits (scrambled indices use all of them).
+ */
+struct sobol_tables {
+    std::uint32_t chunks[4][8][16];
+
+    sobol_tables() {
+        const int degree[4] = {0, 1, 2, 3};
+        const std::uint32_t coefficients[4] = {0, 0, 1, 1};
+        const std::uint32_t initial[4][3] = {{0, 0, 0}, {1, 0, 0}, {1, 3, 0}, {1, 3, 1}};
+
+        std::uint32_t v[4][32];
+        for (int bit = 0; bit < 32; ++bit)
+            v[0][bit] = 1u << (31 - bit); // van der Corput
+        for (int d = 1; d < 4; ++d) {
+            const int s = degree[d];
+            for (int bit = 0; bit < 32; ++bit) {
+                if (bit < s) {
+                    v[d][bit] = initial[d][bit] << (31 - bit);
+                    continue;
+                }
+                v[d][bit] = v[d][bit - s] ^ (v[d][bit - s] >> s);
+                for (int k = 1; k < s; ++k)
+                    v[d][bit] ^= ((coefficients[d] >> (s - 1 - k)) & 1u) * v[d][bit - k];
+            }
+        }
+
+        for (int d = 0; d < 4; ++d) {
+            for (int chunk = 0; chunk < 8; ++chunk) {
+                for (std::uint32_t n = 0; n < 16; ++n) {
+                    std::uint32_t x = 0;
+                    for (int b = 0; b < 4; ++b) {
+                        if (n & (1u << b))
+                            x ^= v[d][4 * chunk + b];
+                    }
+                    chunks[d][chunk][n] = x;
+                }
+            }
+        }
+    }
+
+    std::uint32_t sample(std::uint32_t index, std::uint32_t dimension) const {
+        const auto& table = chunks[dimension];
+        std::uint32_t x = 0;
+        for (int chunk = 0; chunk < 8; ++chunk, index >>= 4)
+            x ^= table[chunk][index & 15u];
+        return x;
+    }
+};
+
+inline const sobol_tables sobol_directions;
+
+/*!
+ * Scrambled Sobol sequence after Burley, "Practical Hash-based Owen Scrambling", JCGT 2020.
+ * Only the first 4 Sobol dimensions are used, higher dimensions are padded: every group of
+ * 4 dimensions gets its own seed, so it is an independently shuffled and scrambled copy.
+ */
+struct sobol_sequence {
+    // Seed of the 4 dimensions starting at `dimension`, derived from the pixel.
+    static std::uint32_t group_seed(std::uint64_t pixel_seed, std::uint32_t dimension) {
+        return static_cast<std::uint32_t>(mix_seed(pixel_seed ^ (std::uint64_t(dimension / 4) << 48)));
+    }
+
+    // Per pixel shuffle of the sample order, an Owen scramble of the index.
+    static std::uint32_t shuffle(std::uint32_t index, std::uint32_t seed) {
+        return nested_uniform_scramble(index, seed);
+    }
+
+    static double sample(std::uint32_t shuffled_index, std::uint32_t dimension, std::uint32_t seed) {
+        const auto dim = dimension % 4;
+        const auto value = nested_uniform_scramble(sobol_directions.sample(shuffled_index, dim), hash_combine(seed, dim));
+        return value * 0x1p-32;
+    }
+
+    static std::uint32_t reverse_bits(std::uint32_t x) {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+        x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    // Laine-Karras style permutation with the improved constants of Nathan Vegdahl, a hash in
+    // which every bit only depends on the bits below it, i.e. an Owen scramble of the reversed bits.
+    static std::uint32_t laine_karras_permutation(std::uint32_t x, std::uint32_t seed) {
+        x ^= x * 0x3d20adeau;
+        x += seed;
+        x *= (seed >> 16) | 1u;
+        x ^= x * 0x05526c56u;
+        x ^= x * 0x53a22864u;
+        return x;
+    }
+
+    static std::uint32_t nested_uniform_scramble(std::uint32_t x, std::uint32_t seed) {
+        return reverse_bits(laine_karras_permutation(reverse_bits(x), seed));
+    }
+
+    static std::uint32_t hash_combine(std::uint32_t seed, std::uint32_t v) {
+        return seed ^ (v + (seed << 6) + (seed >> 2));
+    }
+};
+
+// Per thread state behind `random_double()`.
+struct sampler {
+    sampler_type type = sampler_type::pcg32;
+    std::uint64_t seed = 0;
+    std::uint32_t sample_index = 0;
+    std::uint32_t dimension = 0;
+    pcg32 pcg;
+    xoshiro256 xoshiro;
+    std::uint32_t group_seed = 0;     // sobol: seed and shuffled index of the current group of 4 dimensions
+    std::uint32_t shuffled_index = 0;
+
+    void start_sample(std::uint64_t pixel_seed, std::uint32_t index) {
+        seed = pixel_seed;
+        sample_index = index;
+        dimension = 0;
+        switch (type) {
+            case sampler_type::pcg32: pcg.seed(mix_seed(pixel_seed), index); break;
+            case sampler_type::xoshiro256: xoshiro.seed(pixel_seed ^ mix_seed(index)); break;
+            case sampler_type::sobol: break;
+        }
+    }
+
+    double next() {
+        switch (type) {
+            case sampler_type::pcg32: return pcg.next_double();
+            case sampler_type::xoshiro256: return xoshiro.next_double();
+            default:
+                if (dimension % 4 == 0) {
+                    group_seed = sobol_sequence::group_seed(seed, dimension);
+                    shuffled_index = sobol_sequence::shuffle(sample_index, group_seed);
+                }
+                return sobol_sequence::sample(shuffled_index, dimension++, group_seed);
+        }
+    }
+};
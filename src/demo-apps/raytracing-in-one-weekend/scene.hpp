@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+#include "hittable_list.hpp"
+#include "material.hpp"
+#include "camera.hpp"
+
+// Everything needed to construct the `camera`, the image height follows from `aspect_ratio`.
+struct camera_settings {
+    point3 lookfrom{13, 2, 3};
+    point3 lookat{0, 0, 0};
+    vec3 vup{0, 1, 0};
+    real vfov = 20;
+    real aspect_ratio = 3.0 / 2.0;
+    real aperture = 0.1;
+    real focus_dist = 10;
+
+    camera make_camera() const {
+        return camera(lookfrom, lookat, vup, vfov, aspect_ratio, aperture, focus_dist);
+    }
+};
+
+// Geometry plus the flat material table its `mat_id`s index into.
+struct scene {
+    int add_material(const material& m) {
+        materials.push_back(m);
+        return static_cast<int>(materials.size()) - 1;
+    }
+
+    hittable_list objects;
+    std::vector<material> materials;
+    camera_settings view;
+};
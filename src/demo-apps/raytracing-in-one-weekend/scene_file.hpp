@@ -0,0 +1,486 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "json.hpp"
+#include "mapped_file.hpp"
+#include "scene.hpp"
+#include "sphere.hpp"
+#include "triangle_mesh.hpp"
+#ifdef RT_HAS_MODEL_LOADER
+#include "model_loader.hpp"
+#endif
+
+/*
+ * Scene files, either JSON for hand written scenes:
+ *
+ *   {
+ *     "camera": { "lookfrom": [13, 2, 3], "lookat": [0, 0, 0], "vup": [0, 1, 0],
+ *                 "vfov": 20, "aspect_ratio": 1.5, "aperture": 0.1, "focus_dist": 10 },
+ *     "materials": [
+ *       { "name": "ground", "type": "lambertian", "albedo": [0.5, 0.5, 0.5] },
+ *       { "name": "mirror", "type": "metal", "albedo": [0.7, 0.6, 0.5], "fuzz": 0.0 },
+ *       { "name": "glass", "type": "dielectric", "ir": 1.5 }
+ *     ],
+ *     "spheres": [ { "center": [0, -1000, 0], "radius": 1000, "material": "ground" } ],
+ *     "meshes": [ { "positions": [x0, y0, z0, x1, ...], "indices": [0, 1, 2, ...], "material": 1 },
+ *                 { "file": "resources/models/rock/rock.obj", "scale": 0.5, "translate": [0, 1, 0], "material": 2 } ]
+ *   }
+ *
+ * or the binary format written by `save_scene`, which is memory mapped on load. Mesh vertex
+ * and index arrays are used in place, loading costs page faults instead of parsing:
+ *
+ *   scene_file_header
+ *   scene_file_material[material_count]
+ *   scene_file_sphere[sphere_count]
+ *   scene_file_mesh[mesh_count]
+ *   per mesh, 16 byte aligned: float positions[3 * vertex_count], uint32 indices[3 * triangle_count]
+ *
+ * All values are little endian. Every camera key and every section is optional, materials
+ * are referenced by index or, in JSON, by name.
+ *
+ * Mesh files are loaded through assimp by the graphics library and need a build with
+ * RT_HAS_MODEL_LOADER, relative paths are relative to the working directory like in the demos.
+ * Converting such a scene with `--save-scene` embeds the triangles, so render nodes don't need
+ * assimp or the model files.
+ */
+
+constexpr char scene_file_magic[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', '1'};
+
+struct scene_file_header {
+    char magic[8];
+    std::uint32_t material_count;
+    std::uint32_t sphere_count;
+    std::uint32_t mesh_count;
+    std::uint32_t reserved;
+    float camera[16]; // lookfrom, lookat, vup, vfov, aspect_ratio, aperture, focus_dist, 3 unused
+};
+
+struct scene_file_material {
+    std::uint32_t type; // material_type
+    float albedo[3];
+    float fuzz;
+    float ir;
+};
+
+struct scene_file_sphere {
+    float center[3];
+    float radius;
+    std::int32_t material;
+};
+
+struct scene_file_mesh {
+    std::uint64_t positions_offset; // bytes from the start of the file
+    std::uint64_t vertex_count;
+    std::uint64_t indices_offset;
+    std::uint64_t triangle_count;
+    std::int32_t material;
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(scene_file_header) == 88, "scene_file_header must not contain padding");
+static_assert(sizeof(scene_file_material) == 24, "scene_file_material must not contain padding");
+static_assert(sizeof(scene_file_sphere) == 20, "scene_file_sphere must not contain padding");
+static_assert(sizeof(scene_file_mesh) == 40, "scene_file_mesh must not contain padding");
+
+inline bool scene_error(const std::string& path, const std::string& what) {
+    std::cerr << path << ": " << what << '\n';
+    return false;
+}
+
+// Checks the indices once at load time, so the mesh can use them without bounds checks.
+inline bool valid_mesh(const std::uint32_t* indices, size_t triangle_count, size_t vertex_count) {
+    for (size_t i = 0; i < 3 * triangle_count; ++i) {
+        if (indices[i] >= vertex_count)
+            return false;
+    }
+    return true;
+}
+
+// The image height and the camera basis are derived from these, degenerate values would turn
+// into an out of range image size or NaN rays. Also rejects NaN.
+inline bool valid_view(const camera_settings& view, const std::string& path) {
+    for (int a = 0; a < 3; ++a) {
+        if (!std::isfinite(view.lookfrom[a]) || !std::isfinite(view.lookat[a]) || !std::isfinite(view.vup[a]))
+            return scene_error(path, "camera vectors must be finite");
+    }
+    if (!(view.vfov > 0 && view.vfov < 180))
+        return scene_error(path, "camera vfov must lie between 0 and 180 degrees");
+    if (!(view.aspect_ratio >= real(1e-3) && view.aspect_ratio <= real(1e3)))
+        return scene_error(path, "camera aspect_ratio must lie between 0.001 and 1000");
+    if (!(view.focus_dist > 0) || !std::isfinite(view.focus_dist))
+        return scene_error(path, "camera focus_dist must be positive");
+    if (!(view.aperture >= 0) || !std::isfinite(view.aperture))
+        return scene_error(path, "camera aperture must not be negative");
+    if ((view.lookfrom - view.lookat).near_zero())
+        return scene_error(path, "camera lookfrom and lookat must differ");
+    if (cross(view.vup, view.lookfrom - view.lookat).near_zero())
+        return scene_error(path, "camera vup must not be parallel to the view direction");
+    return true;
+}
+
+// --- JSON ---
+
+// Numbers must be finite and fit the target type, converting anything else is undefined.
+template <typename T>
+inline bool representable(double number) {
+    return std::isfinite(number) && number >= static_cast<double>(std::numeric_limits<T>::lowest()) &&
+           number <= static_cast<double>(std::numeric_limits<T>::max());
+}
+
+inline bool read_vec3(const json_value& object, const char* key, vec3& out) {
+    const auto* value = object.find(key);
+    if (!value)
+        return true; // keep the default
+    if (!value->is_array() || value->items.size() != 3)
+        return false;
+    for (int a = 0; a < 3; ++a) {
+        if (!value->items[a].is_number() || !representable<real>(value->items[a].number))
+            return false;
+        out[a] = static_cast<real>(value->items[a].number);
+    }
+    return true;
+}
+
+inline bool read_real(const json_value& object, const char* key, real& out) {
+    const auto* value = object.find(key);
+    if (!value)
+        return true;
+    if (!value->is_number() || !representable<real>(value->number))
+        return false;
+    out = static_cast<real>(value->number);
+    return true;
+}
+
+bool load_scene_json(const char* text, size_t length, const std::string& path, scene& out) {
+    json_value root;
+    json_parser parser(text, text + length);
+    if (!parser.parse(root))
+        return scene_error(path, parser.error());
+    if (!root.is_object())
+        return scene_error(path, "the document must be an object");
+
+    if (const auto* cam = root.find("camera")) {
+        auto& view = out.view;
+        if (!cam->is_object() || !read_vec3(*cam, "lookfrom", view.lookfrom) || !read_vec3(*cam, "lookat", view.lookat) ||
+            !read_vec3(*cam, "vup", view.vup) || !read_real(*cam, "vfov", view.vfov) ||
+            !read_real(*cam, "aspect_ratio", view.aspect_ratio) || !read_real(*cam, "aperture", view.aperture) ||
+            !read_real(*cam, "focus_dist", view.focus_dist))
+            return scene_error(path, "invalid camera");
+        if (!valid_view(view, path))
+            return false;
+    }
+
+    std::map<std::string, int> material_names;
+    if (const auto* materials = root.find("materials")) {
+        if (!materials->is_array())
+            return scene_error(path, "\"materials\" must be an array");
+        for (const auto& m : materials->items) {
+            const auto* type = m.is_object() ? m.find("type") : nullptr;
+            if (!type || !type->is_string())
+                return scene_error(path, "material " + std::to_string(out.materials.size()) + " has no type");
+
+            color albedo(0.5, 0.5, 0.5);
+            real fuzz = 0;
+            real ir = 1.5;
+            if (!read_vec3(m, "albedo", albedo) || !read_real(m, "fuzz", fuzz) || !read_real(m, "ir", ir))
+                return scene_error(path, "invalid material " + std::to_string(out.materials.size()));
+
+            int id;
+            if (type->string == "lambertian") {
+                id = out.add_material(lambertian(albedo));
+            } else if (type->string == "metal") {
+                id = out.add_material(metal(albedo, fuzz));
+            } else if (type->string == "dielectric") {
+                id = out.add_material(dielectric(ir));
+            } else {
+                return scene_error(path, "unknown material type " + type->string);
+            }
+            if (const auto* name = m.find("name"); name && name->is_string())
+                material_names[name->string] = id;
+        }
+    }
+
+    const auto material_of = [&](const json_value& object, int& id) {
+        const auto* value = object.find("material");
+        if (!value)
+            return false;
+        if (value->is_string()) {
+            auto it = material_names.find(value->string);
+            if (it == material_names.end())
+                return false;
+            id = it->second;
+            return true;
+        }
+        // range check the double, the cast of an out of range value is undefined
+        if (!value->is_number() || !(value->number >= 0 && value->number < static_cast<double>(out.materials.size())))
+            return false;
+        id = static_cast<int>(value->number);
+        return true;
+    };
+
+    if (const auto* spheres = root.find("spheres")) {
+        if (!spheres->is_array())
+            return scene_error(path, "\"spheres\" must be an array");
+        for (size_t i = 0; i < spheres->items.size(); ++i) {
+            const auto& s = spheres->items[i];
+            point3 center;
+            real radius = -1;
+            int mat_id = -1;
+            if (!s.is_object() || !s.find("center") || !read_vec3(s, "center", center) || !read_real(s, "radius", radius) ||
+                radius <= 0 || !material_of(s, mat_id))
+                return scene_error(path, "sphere " + std::to_string(i) + " needs a finite center, a positive radius and a valid material");
+            out.objects.add(std::make_shared<sphere>(center, radius, mat_id));
+        }
+    }
+
+    if (const auto* meshes = root.find("meshes")) {
+        if (!meshes->is_array())
+            return scene_error(path, "\"meshes\" must be an array");
+        for (size_t i = 0; i < meshes->items.size(); ++i) {
+            const auto& m = meshes->items[i];
+            const auto* file = m.is_object() ? m.find("file") : nullptr;
+            std::vector<float> vertex_data;
+            std::vector<std::uint32_t> index_data;
+            int mat_id = -1;
+            if (file) {
+                if (!file->is_string() || !material_of(m, mat_id))
+                    return scene_error(path, "mesh " + std::to_string(i) + " needs a file name and a valid material");
+#ifdef RT_HAS_MODEL_LOADER
+                if (!load_model_triangles(file->string, vertex_data, index_data))
+                    return scene_error(path, "cannot load triangles of " + file->string);
+#else
+                return scene_error(path, "mesh " + std::to_string(i) + ": this build can't load " + file->string +
+                                         ", convert the scene with --save-scene on a build with RT_HAS_MODEL_LOADER");
+#endif
+            } else {
+                const auto* positions = m.is_object() ? m.find("positions") : nullptr;
+                const auto* indices = m.is_object() ? m.find("indices") : nullptr;
+                if (!positions || !positions->is_array() || positions->items.size() % 3 != 0 ||
+                    !indices || !indices->is_array() || indices->items.size() % 3 != 0 || !material_of(m, mat_id))
+                    return scene_error(path, "mesh " + std::to_string(i) + " needs positions, indices and a valid material");
+
+                vertex_data.reserve(positions->items.size());
+                for (const auto& v : positions->items) {
+                    if (!v.is_number() || !representable<float>(v.number))
+                        return scene_error(path, "mesh " + std::to_string(i) + " has a position that is not a finite float");
+                    vertex_data.push_back(static_cast<float>(v.number));
+                }
+                index_data.reserve(indices->items.size());
+                for (const auto& v : indices->items) {
+                    // indices that aren't whole numbers in range are stored as UINT32_MAX, which
+                    // valid_mesh rejects below
+                    const bool whole = v.is_number() && v.number >= 0 && v.number < UINT32_MAX && v.number == std::floor(v.number);
+                    index_data.push_back(whole ? static_cast<std::uint32_t>(v.number) : UINT32_MAX);
+                }
+            }
+
+            // optional uniform scale, then translation
+            real scale = 1;
+            vec3 translate(0, 0, 0);
+            if (!read_real(m, "scale", scale) || !read_vec3(m, "translate", translate))
+                return scene_error(path, "mesh " + std::to_string(i) + " has an invalid transform");
+            if (scale != 1 || translate.length_squared() > 0) {
+                for (size_t v = 0; v < vertex_data.size(); ++v) {
+                    const double p = static_cast<double>(vertex_data[v]) * scale + translate[static_cast<int>(v % 3)];
+                    if (!representable<float>(p))
+                        return scene_error(path, "mesh " + std::to_string(i) + " is transformed out of the float range");
+                    vertex_data[v] = static_cast<float>(p);
+                }
+            }
+
+            if (!valid_mesh(index_data.data(), index_data.size() / 3, vertex_data.size() / 3))
+                return scene_error(path, "mesh " + std::to_string(i) + " has indices out of range");
+
+            out.objects.add(std::make_shared<triangle_mesh>(std::move(vertex_data), std::move(index_data), mat_id));
+        }
+    }
+    return true;
+}
+
+// --- binary ---
+
+// Whether `count` elements of `stride` bytes starting at `offset` lie inside a file of `size`
+// bytes. Offset and count come from the file, the check must not overflow.
+inline bool array_in_file(std::uint64_t offset, std::uint64_t count, std::uint64_t stride, size_t size) {
+    return offset <= size && count <= (size - offset) / stride;
+}
+
+bool load_scene_binary(std::shared_ptr<mapped_file> file, const std::string& path, scene& out) {
+    const char* data = file->data();
+    const size_t size = file->size();
+
+    scene_file_header header;
+    if (size < sizeof(header))
+        return scene_error(path, "truncated header");
+    std::memcpy(&header, data, sizeof(header));
+
+    const size_t tables_size = header.material_count * sizeof(scene_file_material) +
+                               header.sphere_count * sizeof(scene_file_sphere) +
+                               header.mesh_count * sizeof(scene_file_mesh);
+    if (size - sizeof(header) < tables_size)
+        return scene_error(path, "truncated file");
+    const char* cursor = data + sizeof(header);
+
+    auto& view = out.view;
+    const float* c = header.camera;
+    view.lookfrom = point3(c[0], c[1], c[2]);
+    view.lookat = point3(c[3], c[4], c[5]);
+    view.vup = vec3(c[6], c[7], c[8]);
+    view.vfov = c[9];
+    view.aspect_ratio = c[10];
+    view.aperture = c[11];
+    view.focus_dist = c[12];
+    if (!valid_view(view, path))
+        return false;
+
+    out.materials.reserve(out.materials.size() + header.material_count);
+    for (std::uint32_t i = 0; i < header.material_count; ++i, cursor += sizeof(scene_file_material)) {
+        scene_file_material m;
+        std::memcpy(&m, cursor, sizeof(m));
+        const color albedo(m.albedo[0], m.albedo[1], m.albedo[2]);
+        switch (static_cast<material_type>(m.type)) {
+            case material_type::lambertian: out.add_material(lambertian(albedo)); break;
+            case material_type::metal: out.add_material(metal(albedo, m.fuzz)); break;
+            case material_type::dielectric: out.add_material(dielectric(m.ir)); break;
+            default: return scene_error(path, "unknown material type " + std::to_string(m.type));
+        }
+    }
+
+    const auto material_count = static_cast<std::int32_t>(out.materials.size());
+    out.objects.objects.reserve(out.objects.objects.size() + header.sphere_count + header.mesh_count);
+    for (std::uint32_t i = 0; i < header.sphere_count; ++i, cursor += sizeof(scene_file_sphere)) {
+        scene_file_sphere s;
+        std::memcpy(&s, cursor, sizeof(s));
+        if (s.material < 0 || s.material >= material_count)
+            return scene_error(path, "sphere " + std::to_string(i) + " has an invalid material");
+        // also rejects NaN
+        if (!(s.radius > 0) || !std::isfinite(s.radius) ||
+            !std::isfinite(s.center[0]) || !std::isfinite(s.center[1]) || !std::isfinite(s.center[2]))
+            return scene_error(path, "sphere " + std::to_string(i) + " needs a finite center and a positive radius");
+        out.objects.add(std::make_shared<sphere>(point3(s.center[0], s.center[1], s.center[2]), s.radius, s.material));
+    }
+
+    for (std::uint32_t i = 0; i < header.mesh_count; ++i, cursor += sizeof(scene_file_mesh)) {
+        scene_file_mesh m;
+        std::memcpy(&m, cursor, sizeof(m));
+        if (m.positions_offset % 16 != 0 || m.indices_offset % 16 != 0 ||
+            !array_in_file(m.positions_offset, m.vertex_count, 3 * sizeof(float), size) ||
+            !array_in_file(m.indices_offset, m.triangle_count, 3 * sizeof(std::uint32_t), size))
+            return scene_error(path, "mesh " + std::to_string(i) + " lies outside of the file");
+        if (m.material < 0 || m.material >= material_count)
+            return scene_error(path, "mesh " + std::to_string(i) + " has an invalid material");
+
+        // the mapping is page aligned and the offsets 16 byte aligned, the arrays are used in place
+        const auto* positions = reinterpret_cast<const float*>(data + m.positions_offset);
+        const auto* indices = reinterpret_cast<const std::uint32_t*>(data + m.indices_offset);
+        if (!valid_mesh(indices, m.triangle_count, m.vertex_count))
+            return scene_error(path, "mesh " + std::to_string(i) + " has indices out of range");
+        out.objects.add(std::make_shared<triangle_mesh>(positions, m.vertex_count, indices, m.triangle_count,
+                                                        m.material, file));
+    }
+    return true;
+}
+
+// Loads a JSON or binary scene file, the format is detected from the content.
+bool load_scene(const std::string& path, scene& out) {
+    auto file = std::make_shared<mapped_file>();
+    if (!file->open(path))
+        return scene_error(path, "cannot open scene file");
+
+    if (file->size() >= sizeof(scene_file_magic) && std::memcmp(file->data(), scene_file_magic, sizeof(scene_file_magic)) == 0)
+        return load_scene_binary(file, path, out);
+    return load_scene_json(file->data(), file->size(), path, out);
+}
+
+// Writes `s` in the binary format. Only spheres and triangle meshes can be stored.
+bool save_scene(const scene& s, const std::string& path) {
+    std::vector<scene_file_sphere> spheres;
+    std::vector<std::shared_ptr<triangle_mesh>> meshes;
+    for (const auto& object : s.objects.objects) {
+        if (auto sp = std::dynamic_pointer_cast<sphere>(object)) {
+            scene_file_sphere record{};
+            for (int a = 0; a < 3; ++a)
+                record.center[a] = static_cast<float>(sp->center[a]);
+            record.radius = static_cast<float>(sp->radius);
+            record.material = sp->mat_id;
+            spheres.push_back(record);
+        } else if (auto mesh = std::dynamic_pointer_cast<triangle_mesh>(object)) {
+            meshes.push_back(mesh);
+        } else {
+            return scene_error(path, "the scene contains objects the scene file format can't store");
+        }
+    }
+
+    scene_file_header header{};
+    std::memcpy(header.magic, scene_file_magic, sizeof(header.magic));
+    header.material_count = static_cast<std::uint32_t>(s.materials.size());
+    header.sphere_count = static_cast<std::uint32_t>(spheres.size());
+    header.mesh_count = static_cast<std::uint32_t>(meshes.size());
+    const auto& view = s.view;
+    const real camera[13] = {view.lookfrom.x(), view.lookfrom.y(), view.lookfrom.z(),
+                             view.lookat.x(), view.lookat.y(), view.lookat.z(),
+                             view.vup.x(), view.vup.y(), view.vup.z(),
+                             view.vfov, view.aspect_ratio, view.aperture, view.focus_dist};
+    for (int i = 0; i < 13; ++i)
+        header.camera[i] = static_cast<float>(camera[i]);
+
+    std::vector<scene_file_material> materials;
+    for (const auto& m : s.materials) {
+        scene_file_material record{};
+        record.type = static_cast<std::uint32_t>(m.type);
+        for (int a = 0; a < 3; ++a)
+            record.albedo[a] = static_cast<float>(m.albedo[a]);
+        record.fuzz = static_cast<float>(m.fuzz);
+        record.ir = static_cast<float>(m.ir);
+        materials.push_back(record);
+    }
+
+    const auto align = [](std::uint64_t offset) { return (offset + 15) & ~std::uint64_t(15); };
+    std::uint64_t offset = sizeof(header) + materials.size() * sizeof(scene_file_material) +
+                           spheres.size() * sizeof(scene_file_sphere) + meshes.size() * sizeof(scene_file_mesh);
+    std::vector<scene_file_mesh> mesh_records;
+    for (const auto& mesh : meshes) {
+        scene_file_mesh record{};
+        record.positions_offset = align(offset);
+        record.vertex_count = mesh->vertex_count();
+        record.indices_offset = align(record.positions_offset + record.vertex_count * 3 * sizeof(float));
+        record.triangle_count = mesh->triangle_count();
+        record.material = mesh->material_id();
+        offset = record.indices_offset + record.triangle_count * 3 * sizeof(std::uint32_t);
+        mesh_records.push_back(record);
+    }
+
+    std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+    if (!file)
+        return scene_error(path, "cannot open for writing");
+    const auto write = [&file](const void* bytes, size_t count) {
+        file.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(count));
+    };
+    const auto pad_to = [&](std::uint64_t position) {
+        static const char zeros[16] = {};
+        write(zeros, position - static_cast<std::uint64_t>(file.tellp()));
+    };
+
+    write(&header, sizeof(header));
+    write(materials.data(), materials.size() * sizeof(scene_file_material));
+    write(spheres.data(), spheres.size() * sizeof(scene_file_sphere));
+    write(mesh_records.data(), mesh_records.size() * sizeof(scene_file_mesh));
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        pad_to(mesh_records[i].positions_offset);
+        write(meshes[i]->positions(), mesh_records[i].vertex_count * 3 * sizeof(float));
+        pad_to(mesh_records[i].indices_offset);
+        write(meshes[i]->indices(), mesh_records[i].triangle_count * 3 * sizeof(std::uint32_t));
+    }
+    return static_cast<bool>(file);
+}
@@ -6,19 +6,21 @@
 class sphere : public hittable {
 public:
     sphere() {}
-    sphere(point3 cen, double r, std::shared_ptr<material> material)
-        : center(cen), radius(r), mat_ptr(std::move(material)) {};
+    sphere(point3 cen, real r, int material_id)
+        : center(cen), radius(r), mat_id(material_id) {};
 
     virtual bool hit(
-            const ray& r, double t_min, double t_max, hit_record& rec) const override;
+            const ray& r, real t_min, real t_max, hit_record& rec) const override;
+
+    virtual bool bounding_box(aabb& output_box) const override;
 
 public:
     point3 center;
-    double radius;
-    std::shared_ptr<material> mat_ptr;
+    real radius;
+    int mat_id;
 };
 
-bool sphere::hit(const ray& r, double t_min, double t_max, hit_record& rec) const {
+bool sphere::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
     // Analytic solution - https://www.scratchapixel.com/lessons/3d-basic-rendering/minimal-ray-tracer-rendering-simple-shapes/ray-sphere-intersection.html
     vec3 oc = r.origin() - center;
     // simplify equation by substituting `b = 2h`
@@ -28,7 +30,7 @@ bool sphere::hit(const ray& r, double t_min, double t_max, hit_record& rec) cons
 
     auto discriminant = half_b*half_b - a*c;
     if (discriminant < 0) return false; // ray has no hit
-    auto sqrtd = sqrt(discriminant);
+    auto sqrtd = std::sqrt(discriminant);
 
     // Find the nearest root that lies in the acceptable range.
     auto root = (-half_b - sqrtd) / a; // use first root (-)
@@ -42,7 +44,12 @@ bool sphere::hit(const ray& r, double t_min, double t_max, hit_record& rec) cons
     rec.p = r.at(rec.t);
     vec3 outward_normal = (rec.p - center) / radius;
     rec.set_face_normal(r, outward_normal);
-    rec.mat_ptr = mat_ptr;
+    rec.mat_id = mat_id;
+
+    return true;
+}
 
+bool sphere::bounding_box(aabb& output_box) const {
+    output_box = aabb(center - vec3(radius, radius, radius), center + vec3(radius, radius, radius));
     return true;
 }
\ No newline at end of file
@@ -0,0 +1,427 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RT_HAS_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define RT_HAS_X86_SIMD 0
+#endif
+
+#include "hittable.hpp"
+#include "hittable_list.hpp"
+#include "sphere.hpp"
+
+// Intersection kernels of `sphere_soa`, ordered from slowest to fastest.
+enum class simd_kernel {
+    scalar,
+    sse2, // 2 spheres per instruction, 4 with RT_USE_FLOAT
+    avx2, // 4 spheres per instruction, 8 with RT_USE_FLOAT
+};
+
+inline const char* to_string(simd_kernel kernel) {
+    switch (kernel) {
+        case simd_kernel::sse2: return "sse2";
+        case simd_kernel::avx2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+// Fastest kernel the running CPU supports.
+inline simd_kernel detect_simd_kernel() {
+#if RT_HAS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return simd_kernel::avx2;
+    if (__builtin_cpu_supports("sse2"))
+        return simd_kernel::sse2;
+#endif
+    return simd_kernel::scalar;
+}
+
+/*!
+ * Flat list of spheres stored as structure of arrays, so one ray can be tested against
+ * several spheres with a single SIMD instruction. Every kernel performs the same operations
+ * in the same order as `sphere::hit`, images match the scalar path.
+ *
+ * Objects that aren't spheres are kept in a regular `hittable_list` and tested after the spheres.
+ */
+class sphere_soa : public hittable {
+public:
+    explicit sphere_soa(const hittable_list& list, simd_kernel requested = detect_simd_kernel());
+
+    virtual bool hit(
+            const ray& r, real t_min, real t_max, hit_record& rec) const override;
+
+    virtual bool bounding_box(aabb& output_box) const override;
+
+    // Gathers the current centers and radii of the spheres again.
+    virtual void refit() override;
+
+    simd_kernel kernel() const { return active_kernel; }
+    size_t sphere_count() const { return material_ids.size(); }
+
+private:
+    // lane count of the widest kernel, arrays are padded to a multiple of it
+    static constexpr size_t padding = 32 / sizeof(real);
+
+    // Index of the closest sphere hit within [t_min, t_max] or -1, `t_hit` receives its root.
+    long closest_scalar(const ray& r, real t_min, real t_max, real& t_hit) const;
+#if RT_HAS_X86_SIMD
+    long closest_sse2(const ray& r, real t_min, real t_max, real& t_hit) const;
+    long closest_avx2(const ray& r, real t_min, real t_max, real& t_hit) const;
+#endif
+
+    std::vector<real> center_x;
+    std::vector<real> center_y;
+    std::vector<real> center_z;
+    std::vector<real> radius_squared;
+    std::vector<real> radius;
+    std::vector<int> material_ids;
+    std::vector<std::shared_ptr<sphere>> sources; // for refit
+    hittable_list others;
+    aabb box;
+    simd_kernel active_kernel;
+};
+
+sphere_soa::sphere_soa(const hittable_list& list, simd_kernel requested)
+    : active_kernel(std::min(requested, detect_simd_kernel())) {
+    for (const auto& object : list.objects) {
+        auto s = std::dynamic_pointer_cast<sphere>(object);
+        if (!s) {
+            others.add(object);
+            continue;
+        }
+        center_x.push_back(s->center.x());
+        center_y.push_back(s->center.y());
+        center_z.push_back(s->center.z());
+        radius_squared.push_back(s->radius * s->radius);
+        radius.push_back(s->radius);
+        material_ids.push_back(s->mat_id);
+        sources.push_back(s);
+    }
+
+    // Padding lanes sit at the origin with a negative squared radius. Their discriminant
+    // `half_b^2 - a*(|oc|^2 + 1)` is always negative, so they never report a hit.
+    while (center_x.size() % padding != 0) {
+        center_x.push_back(0.0);
+        center_y.push_back(0.0);
+        center_z.push_back(0.0);
+        radius_squared.push_back(-1.0);
+    }
+
+    list.bounding_box(box);
+}
+
+void sphere_soa::refit() {
+    box = aabb();
+    for (size_t i = 0; i < sources.size(); ++i) {
+        const auto& s = *sources[i];
+        center_x[i] = s.center.x();
+        center_y[i] = s.center.y();
+        center_z[i] = s.center.z();
+        radius_squared[i] = s.radius * s.radius;
+        radius[i] = s.radius;
+        aabb sphere_box;
+        s.bounding_box(sphere_box);
+        box = surrounding_box(box, sphere_box);
+    }
+    others.refit();
+    aabb others_box;
+    if (others.bounding_box(others_box))
+        box = surrounding_box(box, others_box);
+}
+
+bool sphere_soa::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+    real root = t_max;
+    long idx = -1;
+    switch (active_kernel) {
+#if RT_HAS_X86_SIMD
+        case simd_kernel::avx2: idx = closest_avx2(r, t_min, t_max, root); break;
+        case simd_kernel::sse2: idx = closest_sse2(r, t_min, t_max, root); break;
+#endif
+        default: idx = closest_scalar(r, t_min, t_max, root); break;
+    }
+
+    bool hit_anything = false;
+    if (idx >= 0) {
+        const point3 center(center_x[idx], center_y[idx], center_z[idx]);
+        rec.t = root;
+        rec.p = r.at(rec.t);
+        vec3 outward_normal = (rec.p - center) / radius[idx];
+        rec.set_face_normal(r, outward_normal);
+        rec.mat_id = material_ids[idx];
+        hit_anything = true;
+    }
+
+    if (others.hit(r, t_min, hit_anything ? rec.t : t_max, rec))
+        hit_anything = true;
+
+    return hit_anything;
+}
+
+bool sphere_soa::bounding_box(aabb& output_box) const {
+    output_box = box;
+    return true;
+}
+
+long sphere_soa::closest_scalar(const ray& r, real t_min, real t_max, real& t_hit) const {
+    const vec3 d = r.direction();
+    const auto a = d.length_squared();
+    long closest = -1;
+
+    for (size_t i = 0; i < center_x.size(); ++i) {
+        const vec3 oc = r.origin() - point3(center_x[i], center_y[i], center_z[i]);
+        const auto half_b = dot(oc, d);
+        const auto c = oc.length_squared() - radius_squared[i];
+        const auto discriminant = half_b*half_b - a*c;
+        if (discriminant < 0) continue;
+        const auto sqrtd = std::sqrt(discriminant);
+
+        auto root = (-half_b - sqrtd) / a;
+        if (root < t_min || t_max < root) {
+            root = (-half_b + sqrtd) / a;
+            if (root < t_min || t_max < root)
+                continue;
+        }
+        t_max = root;
+        closest = static_cast<long>(i);
+    }
+
+    t_hit = t_max;
+    return closest;
+}
+
+#if RT_HAS_X86_SIMD
+
+// Sphere indices are tracked in floating point lanes next to the roots, exact up to 2^24
+// spheres in float mode.
+#ifndef RT_USE_FLOAT
+
+__attribute__((target("sse2")))
+long sphere_soa::closest_sse2(const ray& r, real t_min, real t_max, real& t_hit) const {
+    const vec3 d = r.direction();
+    const vec3 o = r.origin();
+    const __m128d ox = _mm_set1_pd(o.x()), oy = _mm_set1_pd(o.y()), oz = _mm_set1_pd(o.z());
+    const __m128d dx = _mm_set1_pd(d.x()), dy = _mm_set1_pd(d.y()), dz = _mm_set1_pd(d.z());
+    const __m128d a = _mm_set1_pd(d.length_squared());
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d tmin = _mm_set1_pd(t_min);
+
+    __m128d best_t = _mm_set1_pd(t_max);
+    __m128d best_idx = _mm_set1_pd(-1.0);
+    __m128d idx = _mm_set_pd(1.0, 0.0);
+    const __m128d step = _mm_set1_pd(2.0);
+
+    for (size_t i = 0; i < center_x.size(); i += 2, idx = _mm_add_pd(idx, step)) {
+        const __m128d ocx = _mm_sub_pd(ox, _mm_loadu_pd(&center_x[i]));
+        const __m128d ocy = _mm_sub_pd(oy, _mm_loadu_pd(&center_y[i]));
+        const __m128d ocz = _mm_sub_pd(oz, _mm_loadu_pd(&center_z[i]));
+        const __m128d half_b = _mm_add_pd(_mm_add_pd(_mm_mul_pd(ocx, dx), _mm_mul_pd(ocy, dy)), _mm_mul_pd(ocz, dz));
+        const __m128d oc_len = _mm_add_pd(_mm_add_pd(_mm_mul_pd(ocx, ocx), _mm_mul_pd(ocy, ocy)), _mm_mul_pd(ocz, ocz));
+        const __m128d c = _mm_sub_pd(oc_len, _mm_loadu_pd(&radius_squared[i]));
+        const __m128d discriminant = _mm_sub_pd(_mm_mul_pd(half_b, half_b), _mm_mul_pd(a, c));
+        const __m128d has_root = _mm_cmpge_pd(discriminant, zero);
+        if (_mm_movemask_pd(has_root) == 0)
+            continue;
+
+        const __m128d sqrtd = _mm_sqrt_pd(_mm_max_pd(discriminant, zero));
+        const __m128d near_root = _mm_div_pd(_mm_sub_pd(_mm_sub_pd(zero, half_b), sqrtd), a);
+        const __m128d far_root = _mm_div_pd(_mm_add_pd(_mm_sub_pd(zero, half_b), sqrtd), a);
+        const __m128d near_ok = _mm_and_pd(_mm_cmpge_pd(near_root, tmin), _mm_cmple_pd(near_root, best_t));
+        const __m128d far_ok = _mm_and_pd(_mm_cmpge_pd(far_root, tmin), _mm_cmple_pd(far_root, best_t));
+        // SSE2 has no blendv, select with and/andnot/or
+        const __m128d root = _mm_or_pd(_mm_and_pd(near_ok, near_root), _mm_andnot_pd(near_ok, far_root));
+        const __m128d accept = _mm_and_pd(has_root, _mm_or_pd(near_ok, far_ok));
+        best_t = _mm_or_pd(_mm_and_pd(accept, root), _mm_andnot_pd(accept, best_t));
+        best_idx = _mm_or_pd(_mm_and_pd(accept, idx), _mm_andnot_pd(accept, best_idx));
+    }
+
+    alignas(16) double lane_t[2];
+    alignas(16) double lane_idx[2];
+    _mm_store_pd(lane_t, best_t);
+    _mm_store_pd(lane_idx, best_idx);
+
+    long closest = -1;
+    t_hit = t_max;
+    for (int lane = 0; lane < 2; ++lane) {
+        if (lane_idx[lane] >= 0.0 && lane_t[lane] <= t_hit) {
+            t_hit = lane_t[lane];
+            closest = static_cast<long>(lane_idx[lane]);
+        }
+    }
+    return closest;
+}
+
+__attribute__((target("avx2")))
+long sphere_soa::closest_avx2(const ray& r, real t_min, real t_max, real& t_hit) const {
+    const vec3 d = r.direction();
+    const vec3 o = r.origin();
+    const __m256d ox = _mm256_set1_pd(o.x()), oy = _mm256_set1_pd(o.y()), oz = _mm256_set1_pd(o.z());
+    const __m256d dx = _mm256_set1_pd(d.x()), dy = _mm256_set1_pd(d.y()), dz = _mm256_set1_pd(d.z());
+    const __m256d a = _mm256_set1_pd(d.length_squared());
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d tmin = _mm256_set1_pd(t_min);
+
+    __m256d best_t = _mm256_set1_pd(t_max);
+    __m256d best_idx = _mm256_set1_pd(-1.0);
+    __m256d idx = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+    const __m256d step = _mm256_set1_pd(4.0);
+
+    for (size_t i = 0; i < center_x.size(); i += 4, idx = _mm256_add_pd(idx, step)) {
+        const __m256d ocx = _mm256_sub_pd(ox, _mm256_loadu_pd(&center_x[i]));
+        const __m256d ocy = _mm256_sub_pd(oy, _mm256_loadu_pd(&center_y[i]));
+        const __m256d ocz = _mm256_sub_pd(oz, _mm256_loadu_pd(&center_z[i]));
+        const __m256d half_b = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ocx, dx), _mm256_mul_pd(ocy, dy)), _mm256_mul_pd(ocz, dz));
+        const __m256d oc_len = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ocx, ocx), _mm256_mul_pd(ocy, ocy)), _mm256_mul_pd(ocz, ocz));
+        const __m256d c = _mm256_sub_pd(oc_len, _mm256_loadu_pd(&radius_squared[i]));
+        const __m256d discriminant = _mm256_sub_pd(_mm256_mul_pd(half_b, half_b), _mm256_mul_pd(a, c));
+        const __m256d has_root = _mm256_cmp_pd(discriminant, zero, _CMP_GE_OQ);
+        if (_mm256_movemask_pd(has_root) == 0)
+            continue;
+
+        const __m256d sqrtd = _mm256_sqrt_pd(_mm256_max_pd(discriminant, zero));
+        const __m256d near_root = _mm256_div_pd(_mm256_sub_pd(_mm256_sub_pd(zero, half_b), sqrtd), a);
+        const __m256d far_root = _mm256_div_pd(_mm256_add_pd(_mm256_sub_pd(zero, half_b), sqrtd), a);
+        const __m256d near_ok = _mm256_and_pd(_mm256_cmp_pd(near_root, tmin, _CMP_GE_OQ), _mm256_cmp_pd(near_root, best_t, _CMP_LE_OQ));
+        const __m256d far_ok = _mm256_and_pd(_mm256_cmp_pd(far_root, tmin, _CMP_GE_OQ), _mm256_cmp_pd(far_root, best_t, _CMP_LE_OQ));
+        const __m256d root = _mm256_blendv_pd(far_root, near_root, near_ok);
+        const __m256d accept = _mm256_and_pd(has_root, _mm256_or_pd(near_ok, far_ok));
+        best_t = _mm256_blendv_pd(best_t, root, accept);
+        best_idx = _mm256_blendv_pd(best_idx, idx, accept);
+    }
+
+    alignas(32) double lane_t[4];
+    alignas(32) double lane_idx[4];
+    _mm256_store_pd(lane_t, best_t);
+    _mm256_store_pd(lane_idx, best_idx);
+
+    long closest = -1;
+    t_hit = t_max;
+    for (int lane = 0; lane < 4; ++lane) {
+        if (lane_idx[lane] >= 0.0 && lane_t[lane] <= t_hit) {
+            t_hit = lane_t[lane];
+            closest = static_cast<long>(lane_idx[lane]);
+        }
+    }
+    return closest;
+}
+
+#else
+
+__attribute__((target("sse2")))
+long sphere_soa::closest_sse2(const ray& r, real t_min, real t_max, real& t_hit) const {
+    const vec3 d = r.direction();
+    const vec3 o = r.origin();
+    const __m128 ox = _mm_set1_ps(o.x()), oy = _mm_set1_ps(o.y()), oz = _mm_set1_ps(o.z());
+    const __m128 dx = _mm_set1_ps(d.x()), dy = _mm_set1_ps(d.y()), dz = _mm_set1_ps(d.z());
+    const __m128 a = _mm_set1_ps(d.length_squared());
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 tmin = _mm_set1_ps(t_min);
+
+    __m128 best_t = _mm_set1_ps(t_max);
+    __m128 best_idx = _mm_set1_ps(-1.0f);
+    __m128 idx = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 step = _mm_set1_ps(4.0f);
+
+    for (size_t i = 0; i < center_x.size(); i += 4, idx = _mm_add_ps(idx, step)) {
+        const __m128 ocx = _mm_sub_ps(ox, _mm_loadu_ps(&center_x[i]));
+        const __m128 ocy = _mm_sub_ps(oy, _mm_loadu_ps(&center_y[i]));
+        const __m128 ocz = _mm_sub_ps(oz, _mm_loadu_ps(&center_z[i]));
+        const __m128 half_b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, dx), _mm_mul_ps(ocy, dy)), _mm_mul_ps(ocz, dz));
+        const __m128 oc_len = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz));
+        const __m128 c = _mm_sub_ps(oc_len, _mm_loadu_ps(&radius_squared[i]));
+        const __m128 discriminant = _mm_sub_ps(_mm_mul_ps(half_b, half_b), _mm_mul_ps(a, c));
+        const __m128 has_root = _mm_cmpge_ps(discriminant, zero);
+        if (_mm_movemask_ps(has_root) == 0)
+            continue;
+
+        const __m128 sqrtd = _mm_sqrt_ps(_mm_max_ps(discriminant, zero));
+        const __m128 near_root = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(zero, half_b), sqrtd), a);
+        const __m128 far_root = _mm_div_ps(_mm_add_ps(_mm_sub_ps(zero, half_b), sqrtd), a);
+        const __m128 near_ok = _mm_and_ps(_mm_cmpge_ps(near_root, tmin), _mm_cmple_ps(near_root, best_t));
+        const __m128 far_ok = _mm_and_ps(_mm_cmpge_ps(far_root, tmin), _mm_cmple_ps(far_root, best_t));
+        // SSE2 has no blendv, select with and/andnot/or
+        const __m128 root = _mm_or_ps(_mm_and_ps(near_ok, near_root), _mm_andnot_ps(near_ok, far_root));
+        const __m128 accept = _mm_and_ps(has_root, _mm_or_ps(near_ok, far_ok));
+        best_t = _mm_or_ps(_mm_and_ps(accept, root), _mm_andnot_ps(accept, best_t));
+        best_idx = _mm_or_ps(_mm_and_ps(accept, idx), _mm_andnot_ps(accept, best_idx));
+    }
+
+    alignas(16) float lane_t[4];
+    alignas(16) float lane_idx[4];
+    _mm_store_ps(lane_t, best_t);
+    _mm_store_ps(lane_idx, best_idx);
+
+    long closest = -1;
+    t_hit = t_max;
+    for (int lane = 0; lane < 4; ++lane) {
+        if (lane_idx[lane] >= 0.0f && lane_t[lane] <= t_hit) {
+            t_hit = lane_t[lane];
+            closest = static_cast<long>(lane_idx[lane]);
+        }
+    }
+    return closest;
+}
+
+__attribute__((target("avx2")))
+long sphere_soa::closest_avx2(const ray& r, real t_min, real t_max, real& t_hit) const {
+    const vec3 d = r.direction();
+    const vec3 o = r.origin();
+    const __m256 ox = _mm256_set1_ps(o.x()), oy = _mm256_set1_ps(o.y()), oz = _mm256_set1_ps(o.z());
+    const __m256 dx = _mm256_set1_ps(d.x()), dy = _mm256_set1_ps(d.y()), dz = _mm256_set1_ps(d.z());
+    const __m256 a = _mm256_set1_ps(d.length_squared());
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 tmin = _mm256_set1_ps(t_min);
+
+    __m256 best_t = _mm256_set1_ps(t_max);
+    __m256 best_idx = _mm256_set1_ps(-1.0f);
+    __m256 idx = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+    const __m256 step = _mm256_set1_ps(8.0f);
+
+    for (size_t i = 0; i < center_x.size(); i += 8, idx = _mm256_add_ps(idx, step)) {
+        const __m256 ocx = _mm256_sub_ps(ox, _mm256_loadu_ps(&center_x[i]));
+        const __m256 ocy = _mm256_sub_ps(oy, _mm256_loadu_ps(&center_y[i]));
+        const __m256 ocz = _mm256_sub_ps(oz, _mm256_loadu_ps(&center_z[i]));
+        const __m256 half_b = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, dx), _mm256_mul_ps(ocy, dy)), _mm256_mul_ps(ocz, dz));
+        const __m256 oc_len = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)), _mm256_mul_ps(ocz, ocz));
+        const __m256 c = _mm256_sub_ps(oc_len, _mm256_loadu_ps(&radius_squared[i]));
+        const __m256 discriminant = _mm256_sub_ps(_mm256_mul_ps(half_b, half_b), _mm256_mul_ps(a, c));
+        const __m256 has_root = _mm256_cmp_ps(discriminant, zero, _CMP_GE_OQ);
+        if (_mm256_movemask_ps(has_root) == 0)
+            continue;
+
+        const __m256 sqrtd = _mm256_sqrt_ps(_mm256_max_ps(discriminant, zero));
+        const __m256 near_root = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(zero, half_b), sqrtd), a);
+        const __m256 far_root = _mm256_div_ps(_mm256_add_ps(_mm256_sub_ps(zero, half_b), sqrtd), a);
+        const __m256 near_ok = _mm256_and_ps(_mm256_cmp_ps(near_root, tmin, _CMP_GE_OQ), _mm256_cmp_ps(near_root, best_t, _CMP_LE_OQ));
+        const __m256 far_ok = _mm256_and_ps(_mm256_cmp_ps(far_root, tmin, _CMP_GE_OQ), _mm256_cmp_ps(far_root, best_t, _CMP_LE_OQ));
+        const __m256 root = _mm256_blendv_ps(far_root, near_root, near_ok);
+        const __m256 accept = _mm256_and_ps(has_root, _mm256_or_ps(near_ok, far_ok));
+        best_t = _mm256_blendv_ps(best_t, root, accept);
+        best_idx = _mm256_blendv_ps(best_idx, idx, accept);
+    }
+
+    alignas(32) float lane_t[8];
+    alignas(32) float lane_idx[8];
+    _mm256_store_ps(lane_t, best_t);
+    _mm256_store_ps(lane_idx, best_idx);
+
+    long closest = -1;
+    t_hit = t_max;
+    for (int lane = 0; lane < 8; ++lane) {
+        if (lane_idx[lane] >= 0.0f && lane_t[lane] <= t_hit) {
+            t_hit = lane_t[lane];
+            closest = static_cast<long>(lane_idx[lane]);
+        }
+    }
+    return closest;
+}
+
+#endif // RT_USE_FLOAT
+
+#endif // RT_HAS_X86_SIMD
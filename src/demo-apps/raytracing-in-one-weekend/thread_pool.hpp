@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * Fixed set of worker threads with one job queue per worker. Jobs of a `parallel_for` are
+ * dealt out in contiguous blocks, each worker drains its own queue from the back and, once
+ * empty, steals from the front of the other queues. Expensive tiles (e.g. glass spheres)
+ * therefore don't leave the remaining cores idle at the end of a frame.
+ *
+ * Workers are kept alive between calls so repeated renders don't pay thread start-up cost.
+ * `parallel_for` must not be called from inside a job.
+ */
+class thread_pool {
+public:
+    explicit thread_pool(unsigned thread_count = std::thread::hardware_concurrency()) {
+        thread_count = std::max(1u, thread_count);
+        for (unsigned i = 0; i < thread_count; ++i)
+            queues.push_back(std::make_unique<work_queue>());
+        for (unsigned i = 0; i < thread_count; ++i)
+            workers.emplace_back([this, i] { worker_loop(i); });
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    // Runs `job(index)` for every index in [0, job_count) and blocks until all of them finished.
+    void parallel_for(int job_count, std::function<void(int)> job) {
+        if (job_count <= 0)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            current_job = std::move(job);
+            remaining = job_count;
+            for (int i = 0; i < job_count; ++i) {
+                auto& queue = *queues[static_cast<std::size_t>(i) * queues.size() / job_count];
+                std::lock_guard<std::mutex> queue_lock(queue.mutex);
+                queue.jobs.push_back(i);
+            }
+            ++generation;
+        }
+        wake.notify_all();
+
+        std::unique_lock<std::mutex> lock(state_mutex);
+        done.wait(lock, [this] { return remaining == 0; });
+        current_job = nullptr;
+    }
+
+private:
+    struct work_queue {
+        std::mutex mutex;
+        std::deque<int> jobs;
+    };
+
+    bool pop_local(unsigned self, int& job) {
+        auto& queue = *queues[self];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty())
+            return false;
+        job = queue.jobs.back();
+        queue.jobs.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned self, int& job) {
+        for (std::size_t offset = 1; offset < queues.size(); ++offset) {
+            auto& queue = *queues[(self + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.jobs.empty())
+                continue;
+            job = queue.jobs.front();
+            queue.jobs.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void worker_loop(unsigned self) {
+        std::uint64_t seen_generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(state_mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen_generation; });
+                if (stopping)
+                    return;
+                seen_generation = generation;
+            }
+
+            int job;
+            while (pop_local(self, job) || steal(self, job)) {
+                current_job(job);
+                if (remaining.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> lock(state_mutex);
+                    done.notify_all();
+                }
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<work_queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex state_mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::function<void(int)> current_job;
+    std::atomic<int> remaining{0};
+    std::uint64_t generation{0};
+    bool stopping{false};
+};
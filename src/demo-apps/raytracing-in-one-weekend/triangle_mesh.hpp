@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "hittable.hpp"
+#include "aabb.hpp"
+
+/*!
+ * Indexed triangle mesh with its own BVH over the triangles. The mesh is a single object for
+ * the scene's acceleration structure, so a million triangles don't turn into a million
+ * `shared_ptr<hittable>`s.
+ *
+ * Vertex positions (3 floats per vertex) and indices (3 per triangle) aren't copied, they may
+ * point straight into a memory mapped scene file. `storage` keeps whatever owns them alive.
+ */
+class triangle_mesh : public hittable {
+public:
+    triangle_mesh(const float* positions, size_t vertex_count,
+                  const std::uint32_t* indices, size_t triangle_count,
+                  int material_id, std::shared_ptr<const void> storage = nullptr);
+    triangle_mesh(std::vector<float> positions, std::vector<std::uint32_t> indices, int material_id);
+
+    virtual bool hit(
+            const ray& r, real t_min, real t_max, hit_record& rec) const override;
+
+    virtual bool bounding_box(aabb& output_box) const override;
+
+    const float* positions() const { return vertex_data; }
+    const std::uint32_t* indices() const { return index_data; }
+    size_t vertex_count() const { return vertices; }
+    size_t triangle_count() const { return triangles; }
+    int material_id() const { return mat_id; }
+
+private:
+    // Flat BVH node. Inner nodes store their left child right after themselves.
+    struct node {
+        aabb box;
+        std::uint32_t offset; // leaf: first entry of `triangle_order`, inner: index of the right child
+        std::uint32_t count;  // triangles of a leaf, 0 for inner nodes
+        int axis;             // split axis of an inner node
+    };
+
+    static constexpr int bin_count = 16;
+    static constexpr size_t max_leaf_size = 4;
+    static constexpr size_t max_sah_leaf_size = 16; // larger leaves are split even if the SAH disagrees
+    static constexpr int max_traversal_depth = 64;
+
+    point3 vertex(std::uint32_t index) const {
+        const float* v = vertex_data + 3 * static_cast<size_t>(index);
+        return point3(v[0], v[1], v[2]);
+    }
+
+    aabb triangle_box(std::uint32_t triangle) const;
+    void build();
+    std::uint32_t build_node(const std::vector<aabb>& boxes, const std::vector<point3>& centroids,
+                             size_t start, size_t end, int depth);
+    struct watertight_ray;
+    bool hit_triangle(const watertight_ray& wr, std::uint32_t triangle, real t_min, real t_max, real& t) const;
+
+    const float* vertex_data;
+    size_t vertices;
+    const std::uint32_t* index_data;
+    size_t triangles;
+    int mat_id;
+    std::shared_ptr<const void> storage;
+
+    std::vector<node> nodes;
+    std::vector<std::uint32_t> triangle_order;
+};
+
+triangle_mesh::triangle_mesh(const float* positions, size_t vertex_count,
+                             const std::uint32_t* indices, size_t triangle_count,
+                             int material_id, std::shared_ptr<const void> storage)
+    : vertex_data(positions), vertices(vertex_count), index_data(indices), triangles(triangle_count),
+      mat_id(material_id), storage(std::move(storage)) {
+    build();
+}
+
+triangle_mesh::triangle_mesh(std::vector<float> positions, std::vector<std::uint32_t> indices, int material_id)
+    : mat_id(material_id) {
+    auto owned = std::make_shared<std::pair<std::vector<float>, std::vector<std::uint32_t>>>(
+            std::move(positions), std::move(indices));
+    vertex_data = owned->first.data();
+    vertices = owned->first.size() / 3;
+    index_data = owned->second.data();
+    triangles = owned->second.size() / 3;
+    storage = std::move(owned);
+    build();
+}
+
+aabb triangle_mesh::triangle_box(std::uint32_t triangle) const {
+    const std::uint32_t* idx = index_data + 3 * static_cast<size_t>(triangle);
+    aabb box = surrounding_box(surrounding_box(aabb(), vertex(idx[0])), vertex(idx[1]));
+    box = surrounding_box(box, vertex(idx[2]));
+
+    // Axis aligned triangles have a flat box, which the slab test never reports as hit.
+    const real padding = 0.0001;
+    for (int a = 0; a < 3; ++a) {
+        if (box.maximum[a] - box.minimum[a] < padding) {
+            box.minimum[a] -= padding / 2;
+            box.maximum[a] += padding / 2;
+        }
+    }
+    return box;
+}
+
+void triangle_mesh::build() {
+    if (triangles == 0)
+        return;
+
+    std::vector<aabb> boxes(triangles);
+    std::vector<point3> centroids(triangles);
+    triangle_order.resize(triangles);
+    for (std::uint32_t i = 0; i < triangles; ++i) {
+        boxes[i] = triangle_box(i);
+        centroids[i] = boxes[i].centroid();
+        triangle_order[i] = i;
+    }
+
+    nodes.reserve(2 * triangles / max_leaf_size + 1);
+    build_node(boxes, centroids, 0, triangles, 0);
+}
+
+// Binned SAH like `bvh_node`, but over triangle indices into one node array.
+std::uint32_t triangle_mesh::build_node(const std::vector<aabb>& boxes, const std::vector<point3>& centroids,
+                                        size_t start, size_t end, int depth) {
+    const auto node_index = static_cast<std::uint32_t>(nodes.size());
+    nodes.push_back(node{});
+
+    aabb box, centroid_bounds;
+    for (size_t i = start; i < end; ++i) {
+        box = surrounding_box(box, boxes[triangle_order[i]]);
+        centroid_bounds = surrounding_box(centroid_bounds, centroids[triangle_order[i]]);
+    }
+    nodes[node_index].box = box;
+
+    const size_t span = end - start;
+    // the depth limit keeps traversal within its fixed size stack
+    if (span <= max_leaf_size || depth + 1 >= max_traversal_depth) {
+        nodes[node_index].offset = static_cast<std::uint32_t>(start);
+        nodes[node_index].count = static_cast<std::uint32_t>(span);
+        return node_index;
+    }
+
+    auto best_cost = static_cast<real>(span) * box.surface_area(); // cost of not splitting
+    int best_axis = -1;
+    int best_split = 0;
+
+    for (int a = 0; a < 3; ++a) {
+        const auto extent = centroid_bounds.max()[a] - centroid_bounds.min()[a];
+        if (extent <= 0.0)
+            continue;
+
+        aabb bin_boxes[bin_count];
+        size_t bin_counts[bin_count] = {};
+        for (size_t i = start; i < end; ++i) {
+            const auto t = triangle_order[i];
+            const int bin = std::min(static_cast<int>(bin_count * (centroids[t][a] - centroid_bounds.min()[a]) / extent), bin_count - 1);
+            bin_boxes[bin] = surrounding_box(bin_boxes[bin], boxes[t]);
+            bin_counts[bin]++;
+        }
+
+        real right_area[bin_count];
+        size_t right_count[bin_count];
+        aabb accumulated;
+        size_t count = 0;
+        for (int b = bin_count - 1; b > 0; --b) {
+            accumulated = surrounding_box(accumulated, bin_boxes[b]);
+            count += bin_counts[b];
+            right_area[b] = accumulated.surface_area();
+            right_count[b] = count;
+        }
+
+        accumulated = aabb();
+        count = 0;
+        for (int b = 0; b < bin_count - 1; ++b) {
+            accumulated = surrounding_box(accumulated, bin_boxes[b]);
+            count += bin_counts[b];
+            if (count == 0 || right_count[b + 1] == 0)
+                continue;
+            const auto cost = accumulated.surface_area() * count + right_area[b + 1] * right_count[b + 1];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = a;
+                best_split = b + 1;
+            }
+        }
+    }
+
+    int axis = best_axis;
+    size_t mid = start + span / 2;
+    if (best_axis >= 0) {
+        const auto extent = centroid_bounds.max()[axis] - centroid_bounds.min()[axis];
+        const auto split_position = centroid_bounds.min()[axis] + extent * best_split / bin_count;
+        auto it = std::partition(triangle_order.begin() + start, triangle_order.begin() + end, [&](std::uint32_t t) {
+            return centroids[t][axis] < split_position;
+        });
+        mid = static_cast<size_t>(it - triangle_order.begin());
+    }
+    if (best_axis < 0 || mid == start || mid == end) {
+        if (best_axis < 0 && span <= max_sah_leaf_size) {
+            // splitting costs more than testing every triangle
+            nodes[node_index].offset = static_cast<std::uint32_t>(start);
+            nodes[node_index].count = static_cast<std::uint32_t>(span);
+            return node_index;
+        }
+        axis = centroid_bounds.longest_axis();
+        mid = start + span / 2;
+        std::nth_element(triangle_order.begin() + start, triangle_order.begin() + mid, triangle_order.begin() + end,
+                         [&](std::uint32_t a, std::uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+    }
+
+    nodes[node_index].axis = axis;
+    build_node(boxes, centroids, start, mid, depth + 1);
+    const auto right = build_node(boxes, centroids, mid, end, depth + 1);
+    nodes[node_index].offset = right;
+    nodes[node_index].count = 0;
+    return node_index;
+}
+
+/*!
+ * Watertight ray/triangle test - Woop, Benthin, Wald, "Watertight Ray/Triangle Intersection",
+ * JCGT 2013. Vertices are moved into a space where the ray starts at the origin and points
+ * along +z, the edge functions are then evaluated in 2D. Unlike Möller–Trumbore, a ray through
+ * a shared edge or vertex always hits at least one of the adjacent triangles, so meshes have
+ * no cracks for light to leak through. The shear only depends on the ray and is computed once
+ * per mesh traversal.
+ */
+struct triangle_mesh::watertight_ray {
+    explicit watertight_ray(const ray& r) : origin(r.origin()) {
+        const vec3& d = r.direction();
+        kz = std::fabs(d.x()) > std::fabs(d.y()) ? (std::fabs(d.x()) > std::fabs(d.z()) ? 0 : 2)
+                                                 : (std::fabs(d.y()) > std::fabs(d.z()) ? 1 : 2);
+        kx = (kz + 1) % 3;
+        ky = (kx + 1) % 3;
+        if (d[kz] < 0) std::swap(kx, ky); // keep the winding order
+        shear_x = d[kx] / d[kz];
+        shear_y = d[ky] / d[kz];
+        shear_z = 1 / d[kz];
+    }
+
+    point3 origin;
+    int kx, ky, kz;
+    real shear_x, shear_y, shear_z;
+};
+
+bool triangle_mesh::hit_triangle(const watertight_ray& wr, std::uint32_t triangle, real t_min, real t_max, real& t) const {
+    const std::uint32_t* idx = index_data + 3 * static_cast<size_t>(triangle);
+    const vec3 a = vertex(idx[0]) - wr.origin;
+    const vec3 b = vertex(idx[1]) - wr.origin;
+    const vec3 c = vertex(idx[2]) - wr.origin;
+
+    const auto ax = a[wr.kx] - wr.shear_x * a[wr.kz];
+    const auto ay = a[wr.ky] - wr.shear_y * a[wr.kz];
+    const auto bx = b[wr.kx] - wr.shear_x * b[wr.kz];
+    const auto by = b[wr.ky] - wr.shear_y * b[wr.kz];
+    const auto cx = c[wr.kx] - wr.shear_x * c[wr.kz];
+    const auto cy = c[wr.ky] - wr.shear_y * c[wr.kz];
+
+    // scaled barycentric coordinates
+    auto u = cx * by - cy * bx;
+    auto v = ax * cy - ay * cx;
+    auto w = bx * ay - by * ax;
+    if (sizeof(real) < sizeof(double) && (u == 0 || v == 0 || w == 0)) {
+        // exactly on an edge in float, decide in double like the paper does
+        u = static_cast<real>(double(cx) * double(by) - double(cy) * double(bx));
+        v = static_cast<real>(double(ax) * double(cy) - double(ay) * double(cx));
+        w = static_cast<real>(double(bx) * double(ay) - double(by) * double(ax));
+    }
+    if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0))
+        return false;
+
+    const auto det = u + v + w;
+    if (det == 0) return false; // ray lies in the triangle plane
+
+    const auto scaled_t = u * wr.shear_z * a[wr.kz] + v * wr.shear_z * b[wr.kz] + w * wr.shear_z * c[wr.kz];
+    t = scaled_t / det;
+    return t_min <= t && t <= t_max;
+}
+
+bool triangle_mesh::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+    if (nodes.empty())
+        return false;
+
+    std::uint32_t stack[max_traversal_depth];
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+
+    const watertight_ray wr(r);
+    bool hit_anything = false;
+    std::uint32_t closest = 0;
+    while (stack_size > 0) {
+        const node& n = nodes[stack[--stack_size]];
+        if (!n.box.hit(r, t_min, t_max))
+            continue;
+
+        if (n.count > 0) {
+            for (std::uint32_t i = n.offset; i < n.offset + n.count; ++i) {
+                real t;
+                if (hit_triangle(wr, triangle_order[i], t_min, t_max, t)) {
+                    hit_anything = true;
+                    t_max = t;
+                    closest = triangle_order[i];
+                }
+            }
+            continue;
+        }
+
+        // push the far child first so the near one is popped next and shortens t_max early
+        const auto left = static_cast<std::uint32_t>(&n - nodes.data()) + 1;
+        const bool left_first = r.direction()[n.axis] >= 0;
+        stack[stack_size++] = left_first ? n.offset : left;
+        stack[stack_size++] = left_first ? left : n.offset;
+    }
+
+    if (!hit_anything)
+        return false;
+
+    rec.t = t_max;
+    rec.p = r.at(rec.t);
+    const std::uint32_t* idx = index_data + 3 * static_cast<size_t>(closest);
+    const point3 v0 = vertex(idx[0]);
+    rec.set_face_normal(r, unit_vector(cross(vertex(idx[1]) - v0, vertex(idx[2]) - v0)));
+    rec.mat_id = mat_id;
+    return true;
+}
+
+bool triangle_mesh::bounding_box(aabb& output_box) const {
+    if (nodes.empty())
+        return false;
+    output_box = nodes.front().box;
+    return true;
+}
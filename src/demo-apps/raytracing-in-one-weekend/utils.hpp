@@ -1,9 +1,19 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
 #include <limits>
 #include <memory>
-#include <random>
+
+#include "sampler.hpp"
+
+// Scalar type of the math types (`vec3`, `ray`, `camera`, `hit_record`). Define RT_USE_FLOAT
+// at build time for the faster, less precise preview renderer.
+#ifdef RT_USE_FLOAT
+using real = float;
+#else
+using real = double;
+#endif
 
 // Constants
 const double infinity = std::numeric_limits<double>::infinity();
@@ -15,13 +25,30 @@ inline double degrees_to_radians(double degrees) {
     return degrees * pi / 180.0;
 }
 
+// Every thread owns its sampler, the renderer restarts it for every sample of a pixel.
+inline sampler& thread_sampler() {
+    thread_local sampler instance;
+    return instance;
+}
+
+// Starts sample `sample_index` of the pixel identified by `pixel_seed` with the given generator.
+inline void start_sample(sampler_type type, std::uint64_t pixel_seed, std::uint32_t sample_index) {
+    auto& s = thread_sampler();
+    s.type = type;
+    s.start_sample(pixel_seed, sample_index);
+}
+
+// Plain pseudo random stream, e.g. for building a scene.
+inline void seed_random(std::uint64_t seed) {
+    start_sample(sampler_type::pcg32, seed, 0);
+}
+
+// Returns a random real in [0,1), the next dimension of the current sample.
 inline double random_double() {
-    static std::uniform_real_distribution<double> distribution(0.0, 1.0);
-    static std::mt19937 generator;
-    return distribution(generator);
+    return thread_sampler().next();
 }
 
 inline double random_double(double min, double max) {
     // Returns a random real in [min,max).
     return min + (max-min)*random_double();
-}
\ No newline at end of file
+}
@@ -1,154 +1,193 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
 #include "utils.hpp"
 
-class vec3 {
+/*!
+ * Templated on the scalar type so previews can be rendered in `float` (see `real` in utils.hpp).
+ * Scalar arguments of the free operators are taken as `vec3_t<T>::value_type` so double
+ * literals like `0.5 * v` still work with a float vector.
+ */
+template<typename T>
+class vec3_t {
 public:
-    vec3() : e{0,0,0} {}
-    vec3(double e0, double e1, double e2) : e{e0, e1, e2} {}
+    using value_type = T;
 
-    double x() const { return e[0]; }
-    double y() const { return e[1]; }
-    double z() const { return e[2]; }
+    vec3_t() : e{0,0,0} {}
+    vec3_t(T e0, T e1, T e2) : e{e0, e1, e2} {}
 
-    vec3 operator-() const { return vec3(-e[0], -e[1], -e[2]); }
-    double operator[](int i) const { return e[i]; }
-    double& operator[](int i) { return e[i]; }
+    T x() const { return e[0]; }
+    T y() const { return e[1]; }
+    T z() const { return e[2]; }
 
-    vec3& operator+=(const vec3 &v) {
+    vec3_t operator-() const { return vec3_t(-e[0], -e[1], -e[2]); }
+    T operator[](int i) const { return e[i]; }
+    T& operator[](int i) { return e[i]; }
+
+    vec3_t& operator+=(const vec3_t &v) {
         e[0] += v.e[0];
         e[1] += v.e[1];
         e[2] += v.e[2];
         return *this;
     }
 
-    vec3& operator*=(const double t) {
+    vec3_t& operator*=(const T t) {
         e[0] *= t;
         e[1] *= t;
         e[2] *= t;
         return *this;
     }
 
-    vec3& operator/=(const double t) {
+    vec3_t& operator/=(const T t) {
         return *this *= 1/t;
     }
 
-    double length() const {
-        return sqrt(length_squared());
+    T length() const {
+        return std::sqrt(length_squared());
     }
 
-    double length_squared() const {
+    T length_squared() const {
         return e[0]*e[0] + e[1]*e[1] + e[2]*e[2];
     }
 
-    inline static vec3 random() {
-        return vec3(random_double(), random_double(), random_double());
+    inline static vec3_t random() {
+        return vec3_t(random_double(), random_double(), random_double());
     }
 
-    inline static vec3 random(double min, double max) {
-        return vec3(random_double(min,max), random_double(min,max), random_double(min,max));
+    inline static vec3_t random(double min, double max) {
+        return vec3_t(random_double(min,max), random_double(min,max), random_double(min,max));
     }
 
     bool near_zero() const {
         // Return true if the vector is close to zero in all dimensions.
         const auto s = 1e-8;
-        return (fabs(e[0]) < s) && (fabs(e[1]) < s) && (fabs(e[2]) < s);
+        return (std::fabs(e[0]) < s) && (std::fabs(e[1]) < s) && (std::fabs(e[2]) < s);
     }
 
 public:
-    double e[3];
+    T e[3];
 };
 
 // Type aliases for vec3
+using vec3 = vec3_t<real>;
 using point3 = vec3;   // 3D point
 using color = vec3;    // RGB color
 
 // vec3 Utility Functions
 
-inline std::ostream& operator<<(std::ostream &out, const vec3 &v) {
+template<typename T>
+inline std::ostream& operator<<(std::ostream &out, const vec3_t<T> &v) {
     return out << v.e[0] << ' ' << v.e[1] << ' ' << v.e[2];
 }
 
-inline vec3 operator+(const vec3 &u, const vec3 &v) {
-    return vec3(u.e[0] + v.e[0], u.e[1] + v.e[1], u.e[2] + v.e[2]);
+template<typename T>
+inline vec3_t<T> operator+(const vec3_t<T> &u, const vec3_t<T> &v) {
+    return vec3_t<T>(u.e[0] + v.e[0], u.e[1] + v.e[1], u.e[2] + v.e[2]);
 }
 
-inline vec3 operator-(const vec3 &u, const vec3 &v) {
-    return vec3(u.e[0] - v.e[0], u.e[1] - v.e[1], u.e[2] - v.e[2]);
+template<typename T>
+inline vec3_t<T> operator-(const vec3_t<T> &u, const vec3_t<T> &v) {
+    return vec3_t<T>(u.e[0] - v.e[0], u.e[1] - v.e[1], u.e[2] - v.e[2]);
 }
 
-inline vec3 operator*(const vec3 &u, const vec3 &v) {
-    return vec3(u.e[0] * v.e[0], u.e[1] * v.e[1], u.e[2] * v.e[2]);
+template<typename T>
+inline vec3_t<T> operator*(const vec3_t<T> &u, const vec3_t<T> &v) {
+    return vec3_t<T>(u.e[0] * v.e[0], u.e[1] * v.e[1], u.e[2] * v.e[2]);
 }
 
-inline vec3 operator*(double t, const vec3 &v) {
-    return vec3(t*v.e[0], t*v.e[1], t*v.e[2]);
+template<typename T>
+inline vec3_t<T> operator*(typename vec3_t<T>::value_type t, const vec3_t<T> &v) {
+    return vec3_t<T>(t*v.e[0], t*v.e[1], t*v.e[2]);
 }
 
-inline vec3 operator*(const vec3 &v, double t) {
+template<typename T>
+inline vec3_t<T> operator*(const vec3_t<T> &v, typename vec3_t<T>::value_type t) {
     return t * v;
 }
 
-inline vec3 operator/(vec3 v, double t) {
+template<typename T>
+inline vec3_t<T> operator/(vec3_t<T> v, typename vec3_t<T>::value_type t) {
     return (1/t) * v;
 }
 
-inline double dot(const vec3 &u, const vec3 &v) {
+template<typename T>
+inline T dot(const vec3_t<T> &u, const vec3_t<T> &v) {
     return u.e[0] * v.e[0]
            + u.e[1] * v.e[1]
            + u.e[2] * v.e[2];
 }
 
-inline vec3 cross(const vec3 &u, const vec3 &v) {
-    return vec3(u.e[1] * v.e[2] - u.e[2] * v.e[1],
-                u.e[2] * v.e[0] - u.e[0] * v.e[2],
-                u.e[0] * v.e[1] - u.e[1] * v.e[0]);
+template<typename T>
+inline vec3_t<T> cross(const vec3_t<T> &u, const vec3_t<T> &v) {
+    return vec3_t<T>(u.e[1] * v.e[2] - u.e[2] * v.e[1],
+                     u.e[2] * v.e[0] - u.e[0] * v.e[2],
+                     u.e[0] * v.e[1] - u.e[1] * v.e[0]);
 }
 
-inline vec3 unit_vector(vec3 v) {
+template<typename T>
+inline vec3_t<T> unit_vector(vec3_t<T> v) {
     return v / v.length();
 }
 
-inline vec3 random_in_unit_sphere() {
-    while (true) {
-        auto p = vec3::random(-1,1);
-        if (p.length_squared() >= 1)
-            continue;
-        return p;
-    }
+// Uniform direction without rejection: z is uniform in [-1,1] (Archimedes' hat-box theorem),
+// the azimuth uniform in [0,2pi). Always consumes exactly 2 random numbers.
+template<typename T = real>
+inline vec3_t<T> random_unit_vector() {
+    const auto z = 1 - 2 * random_double();
+    const auto phi = 2 * pi * random_double();
+    const auto r = std::sqrt(std::max(0.0, 1 - z * z));
+    return vec3_t<T>(static_cast<T>(r * std::cos(phi)), static_cast<T>(r * std::sin(phi)), static_cast<T>(z));
 }
 
-inline vec3 random_unit_vector() {
-    return unit_vector(random_in_unit_sphere());
+// Uniform point in the unit ball, a direction scaled by the cube root of a uniform number.
+template<typename T = real>
+inline vec3_t<T> random_in_unit_sphere() {
+    const auto direction = random_unit_vector<T>();
+    return static_cast<T>(std::cbrt(random_double())) * direction;
 }
 
-inline vec3 random_in_hemisphere(const vec3& normal) {
-    vec3 in_unit_sphere = random_in_unit_sphere();
+template<typename T>
+inline vec3_t<T> random_in_hemisphere(const vec3_t<T>& normal) {
+    vec3_t<T> in_unit_sphere = random_in_unit_sphere<T>();
     if (dot(in_unit_sphere, normal) > 0.0) // In the same hemisphere as the normal
         return in_unit_sphere;
     else
         return -in_unit_sphere;
 }
 
-vec3 reflect(const vec3& v, const vec3& n) {
+template<typename T>
+vec3_t<T> reflect(const vec3_t<T>& v, const vec3_t<T>& n) {
     return v - 2*dot(v,n)*n;
 }
 
 // confusing to understand, but is available in libraries
-vec3 refract(const vec3& uv, const vec3& n, double etai_over_etat) {
-    auto cos_theta = fmin(dot(-uv, n), 1.0);
-    vec3 r_out_perp =  etai_over_etat * (uv + cos_theta*n);
-    vec3 r_out_parallel = -sqrt(fabs(1.0 - r_out_perp.length_squared())) * n;
+template<typename T>
+vec3_t<T> refract(const vec3_t<T>& uv, const vec3_t<T>& n, typename vec3_t<T>::value_type etai_over_etat) {
+    auto cos_theta = std::fmin(dot(-uv, n), T(1));
+    vec3_t<T> r_out_perp =  etai_over_etat * (uv + cos_theta*n);
+    vec3_t<T> r_out_parallel = -std::sqrt(std::fabs(1 - r_out_perp.length_squared())) * n;
     return r_out_perp + r_out_parallel;
 }
 
-vec3 random_in_unit_disk() {
-    while (true) {
-        auto p = vec3(random_double(-1,1), random_double(-1,1), 0);
-        if (p.length_squared() >= 1) continue;
-        return p;
+// Shirley-Chiu concentric mapping of the unit square onto the unit disk, keeps the
+// stratification of low discrepancy samples intact and needs no rejection loop.
+template<typename T = real>
+vec3_t<T> random_in_unit_disk() {
+    const auto a = 2 * random_double() - 1;
+    const auto b = 2 * random_double() - 1;
+    if (a == 0 && b == 0)
+        return vec3_t<T>(0, 0, 0);
+
+    double r, phi;
+    if (std::fabs(a) > std::fabs(b)) {
+        r = a;
+        phi = (pi / 4) * (b / a);
+    } else {
+        r = b;
+        phi = (pi / 2) - (pi / 4) * (a / b);
     }
-}
\ No newline at end of file
+    return vec3_t<T>(static_cast<T>(r * std::cos(phi)), static_cast<T>(r * std::sin(phi)), 0);
+}
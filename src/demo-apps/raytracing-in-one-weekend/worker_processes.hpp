@@ -0,0 +1,326 @@
+#pragma once
+
+// Rendering with worker processes needs fork() and local sockets.
+#if defined(__unix__) || defined(__APPLE__)
+#define RT_HAS_WORKER_PROCESSES
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "renderer.hpp"
+
+/*!
+ * Renders an image with independent worker processes instead of threads. A worker is a fork
+ * of the coordinator, so it inherits the scene, acceleration structure and camera and only
+ * ever receives small job messages over its end of a socket pair.
+ *
+ * A job is a tile plus a range of its sample indices, `sample_ranges` > 1 splits every tile
+ * into several jobs. Workers return the sums of their samples (color, squared luminance,
+ * features) and the coordinator adds them into the framebuffer. Since pixels are seeded by
+ * position and sample index, the merged image doesn't depend on which worker rendered what,
+ * with a single range per tile it is bit identical to a threaded render.
+ *
+ * A worker that dies (crash, OOM killer, `kill -9`) is noticed as soon as its socket hangs
+ * up. Its unfinished job goes back to the front of the queue for the remaining workers, a
+ * partially sent result is dropped. Should all workers die, the coordinator renders the
+ * remaining jobs itself.
+ */
+class worker_processes {
+public:
+    worker_processes(const hittable& world, const std::vector<material>& materials, const camera& cam,
+                     const render_settings& settings, bool with_features, unsigned count)
+        : world(world), materials(materials), cam(cam), settings(settings), with_features(with_features) {
+        // writing to a dead worker must fail with EPIPE instead of killing the coordinator
+        std::signal(SIGPIPE, SIG_IGN);
+
+        for (unsigned i = 0; i < count; ++i) {
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+                std::cerr << "socketpair failed: errno " << errno << '\n';
+                break;
+            }
+            const pid_t pid = fork();
+            if (pid < 0) {
+                std::cerr << "fork failed: errno " << errno << '\n';
+                close(fds[0]);
+                close(fds[1]);
+                break;
+            }
+            if (pid == 0) {
+                close(fds[0]);
+                for (const auto& w : workers)
+                    close(w.fd);
+                run_worker(fds[1]);
+            }
+            close(fds[1]);
+            workers.push_back({pid, fds[0]});
+        }
+    }
+
+    ~worker_processes() {
+        // workers exit once their socket is closed
+        for (auto& w : workers) {
+            if (w.alive)
+                stop(w);
+        }
+    }
+
+    worker_processes(const worker_processes&) = delete;
+    worker_processes& operator=(const worker_processes&) = delete;
+
+    std::vector<pid_t> pids() const {
+        std::vector<pid_t> result;
+        for (const auto& w : workers)
+            result.push_back(w.pid);
+        return result;
+    }
+
+    /*!
+     * Renders `settings.samples_per_pixel` samples of every pixel into `fb`, which has to start
+     * out empty. `on_tile_done` is called once all sample ranges of a tile are merged.
+     */
+    render_stats render(framebuffer& fb, int sample_ranges, const std::function<void(const tile&)>& on_tile_done = {}) {
+        const auto tiles = make_tiles(settings.image_width, settings.image_height, settings.tile_size);
+        sample_ranges = std::max(1, std::min(sample_ranges, settings.samples_per_pixel));
+
+        std::vector<job> jobs;
+        for (size_t t = 0; t < tiles.size(); ++t) {
+            for (int r = 0; r < sample_ranges; ++r) {
+                const auto first = static_cast<std::uint32_t>(settings.samples_per_pixel * r / sample_ranges);
+                const auto end = static_cast<std::uint32_t>(settings.samples_per_pixel * (r + 1) / sample_ranges);
+                const auto& region = tiles[t];
+                jobs.push_back({region.x0, region.y0, region.x1, region.y1, first, end - first});
+            }
+        }
+        std::vector<int> ranges_missing(tiles.size(), sample_ranges);
+        std::deque<size_t> pending;
+        for (size_t j = 0; j < jobs.size(); ++j)
+            pending.push_back(j);
+
+        render_stats stats;
+        size_t jobs_done = 0;
+        const auto job_done = [&](size_t index, const job_result_header& header, const framebuffer& result) {
+            merge(result, fb);
+            stats.samples += header.samples;
+            stats.rays += header.rays;
+            ++jobs_done;
+            const auto tile_index = index / static_cast<size_t>(sample_ranges);
+            if (--ranges_missing[tile_index] == 0 && on_tile_done)
+                on_tile_done(tiles[tile_index]);
+        };
+
+        std::vector<pollfd> polled;
+        std::vector<worker*> polled_workers;
+        while (jobs_done < jobs.size()) {
+            // hand out jobs to idle workers, one job in flight per worker
+            for (auto& w : workers) {
+                if (!w.alive || w.busy || pending.empty())
+                    continue;
+                w.job = pending.front();
+                pending.pop_front();
+                w.busy = true;
+                if (!write_all(w.fd, &jobs[w.job], sizeof(job)))
+                    worker_died(w, pending);
+            }
+
+            polled.clear();
+            polled_workers.clear();
+            for (auto& w : workers) {
+                if (w.alive && w.busy) {
+                    polled.push_back({w.fd, POLLIN, 0});
+                    polled_workers.push_back(&w);
+                }
+            }
+            if (polled.empty()) {
+                std::cerr << "all worker processes died, rendering the remaining " << pending.size() << " jobs\n";
+                for (const auto index : pending) {
+                    framebuffer result = make_result(jobs[index]);
+                    const auto header = run_job(jobs[index], result);
+                    job_done(index, header, result);
+                }
+                break;
+            }
+            if (poll(polled.data(), polled.size(), -1) < 0) {
+                if (errno != EINTR)
+                    std::cerr << "poll failed: errno " << errno << '\n';
+                continue;
+            }
+
+            for (size_t i = 0; i < polled.size(); ++i) {
+                if (polled[i].revents == 0)
+                    continue;
+                auto& w = *polled_workers[i];
+                framebuffer result = make_result(jobs[w.job]);
+                job_result_header header{};
+                if (!read_all(w.fd, &header, sizeof(header)) || !read_tile(w.fd, result)) {
+                    worker_died(w, pending);
+                    continue;
+                }
+                w.busy = false;
+                job_done(w.job, header, result);
+            }
+        }
+        stats.passes = 1;
+        return stats;
+    }
+
+private:
+    // Coordinator -> worker, render `sample_count` samples starting at `first_sample` for every pixel of the tile.
+    struct job {
+        std::int32_t x0, y0, x1, y1;
+        std::uint32_t first_sample;
+        std::uint32_t sample_count;
+    };
+
+    // Worker -> coordinator, followed by the tile's pixel, sample count, luminance and feature arrays.
+    struct job_result_header {
+        std::uint64_t samples;
+        std::uint64_t rays;
+    };
+
+    struct worker {
+        pid_t pid;
+        int fd;
+        bool alive = true;
+        bool busy = false;
+        size_t job = 0;
+    };
+
+    // Both ends run the same executable, so the arrays are sent in their in-memory layout.
+    static bool write_tile(int fd, const framebuffer& fb) {
+        return write_all(fd, fb.pixels.data(), fb.pixels.size() * sizeof(color)) &&
+               write_all(fd, fb.samples.data(), fb.samples.size() * sizeof(std::uint32_t)) &&
+               write_all(fd, fb.luminance_squared.data(), fb.luminance_squared.size() * sizeof(double)) &&
+               write_all(fd, fb.albedo.data(), fb.albedo.size() * sizeof(color)) &&
+               write_all(fd, fb.normal.data(), fb.normal.size() * sizeof(vec3));
+    }
+
+    static bool read_tile(int fd, framebuffer& fb) {
+        return read_all(fd, fb.pixels.data(), fb.pixels.size() * sizeof(color)) &&
+               read_all(fd, fb.samples.data(), fb.samples.size() * sizeof(std::uint32_t)) &&
+               read_all(fd, fb.luminance_squared.data(), fb.luminance_squared.size() * sizeof(double)) &&
+               read_all(fd, fb.albedo.data(), fb.albedo.size() * sizeof(color)) &&
+               read_all(fd, fb.normal.data(), fb.normal.size() * sizeof(vec3));
+    }
+
+    static bool write_all(int fd, const void* data, size_t size) {
+        auto bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            const auto written = write(fd, bytes, size);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return false;
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    // False on errors and on end of file, i.e. the other side is gone.
+    static bool read_all(int fd, void* data, size_t size) {
+        auto bytes = static_cast<char*>(data);
+        while (size > 0) {
+            const auto received = read(fd, bytes, size);
+            if (received < 0 && errno == EINTR)
+                continue;
+            if (received <= 0)
+                return false;
+            bytes += received;
+            size -= static_cast<size_t>(received);
+        }
+        return true;
+    }
+
+    static void merge(const framebuffer& result, framebuffer& fb) {
+        for (int j = result.origin_y; j < result.origin_y + result.height; ++j) {
+            for (int i = result.origin_x; i < result.origin_x + result.width; ++i) {
+                const auto from = result.index(i, j);
+                const auto to = fb.index(i, j);
+                fb.pixels[to] += result.pixels[from];
+                fb.samples[to] += result.samples[from];
+                fb.luminance_squared[to] += result.luminance_squared[from];
+                if (fb.has_features() && result.has_features()) {
+                    fb.albedo[to] += result.albedo[from];
+                    fb.normal[to] += result.normal[from];
+                }
+            }
+        }
+    }
+
+    // Empty framebuffer covering the tile of the job.
+    framebuffer make_result(const job& next) const {
+        framebuffer result(next.x1 - next.x0, next.y1 - next.y0, next.x0, next.y0);
+        if (with_features)
+            result.enable_features();
+        return result;
+    }
+
+    job_result_header run_job(const job& next, framebuffer& result) const {
+        // render_tile continues every pixel's sample sequence at its sample count, start at
+        // the job's range and keep only the samples added here
+        std::fill(result.samples.begin(), result.samples.end(), next.first_sample);
+        const auto rays_before = ray_counter();
+        job_result_header header{};
+        header.samples = render_tile(world, materials, cam, settings, {next.x0, next.y0, next.x1, next.y1},
+                                     static_cast<int>(next.sample_count), result);
+        header.rays = ray_counter() - rays_before;
+        for (auto& count : result.samples)
+            count -= next.first_sample;
+        return header;
+    }
+
+    // Loop of a worker process, never returns.
+    [[noreturn]] void run_worker(int fd) const {
+        job next{};
+        while (read_all(fd, &next, sizeof(next))) {
+            framebuffer result = make_result(next);
+            const auto header = run_job(next, result);
+            if (!write_all(fd, &header, sizeof(header)) || !write_tile(fd, result))
+                break;
+        }
+        // skip the destructors and atexit handlers of the coordinator's copy of the process
+        _exit(0);
+    }
+
+    void worker_died(worker& w, std::deque<size_t>& pending) {
+        if (w.busy)
+            pending.push_front(w.job);
+        int status = 0;
+        close(w.fd);
+        waitpid(w.pid, &status, 0);
+        w.alive = false;
+        w.busy = false;
+        std::cerr << "worker " << w.pid << " died";
+        if (WIFSIGNALED(status))
+            std::cerr << " (signal " << WTERMSIG(status) << ")";
+        std::cerr << ", its job is reassigned\n";
+    }
+
+    void stop(worker& w) {
+        close(w.fd);
+        waitpid(w.pid, nullptr, 0);
+        w.alive = false;
+    }
+
+    const hittable& world;
+    const std::vector<material>& materials;
+    const camera& cam;
+    render_settings settings;
+    bool with_features;
+    std::vector<worker> workers;
+};
+
+#endif
@@ -0,0 +1,677 @@
+// Microbenchmarks of the skeletal animation runtime, no window or OpenGL context needed.
+//
+//   skeletal-animation-benchmark [animated model]
+//
+// Without a model file a synthetic character built in code is animated, so the numbers can be
+// reproduced from the repository alone. Every case runs `kRepeat` times, the fastest run is
+// reported.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include <assimp/anim.h>
+#include <assimp/scene.h>
+
+#include <graphics/Animation.hpp>
+#include <graphics/Animator.hpp>
+#include <graphics/BakedAnimation.hpp>
+#include <graphics/BlendAnimator.hpp>
+#include <graphics/Camera.hpp>
+#include <graphics/Bone.hpp>
+#include <graphics/CompressedClip.hpp>
+#include <graphics/CpuSkinner.hpp>
+#include <graphics/CrowdAnimator.hpp>
+#include <graphics/JobPool.hpp>
+#include <graphics/Model.hpp>
+
+constexpr int kRepeat = 5;
+
+// the synthetic character, about the size of a mixamo rig and clip
+constexpr int kSyntheticBoneCount = 65;
+constexpr int kSyntheticKeyCount = 300;
+
+// results are accumulated here so the timed loops can't be optimized away
+volatile long gSink = 0;
+
+// Fastest of `kRepeat` runs in nanoseconds.
+double timeNs(const std::function<void()>& run) {
+    double best = 1e300;
+    for (int i = 0; i < kRepeat; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, std::chrono::duration<double, std::nano>(elapsed).count());
+    }
+    return best;
+}
+
+// The lookup Bone used before key cursors, scans from the first key on every call.
+template<typename T>
+int linearScanIdx(float animationTime, const std::vector<T>& keys) {
+    for (std::size_t idx = 0; idx + 1 < keys.size(); ++idx) {
+        if (animationTime < keys[idx + 1].timeStamp) {
+            return static_cast<int>(idx);
+        }
+    }
+    return static_cast<int>(keys.size()) - 2;
+}
+
+// Channel with `keyCount` position keys one tick apart, rotations and scales are constant.
+std::unique_ptr<aiNodeAnim> makeChannel(int keyCount) {
+    auto channel = std::make_unique<aiNodeAnim>();
+    channel->mNodeName = aiString{std::string{"benchmark"}};
+    channel->mNumPositionKeys = keyCount;
+    channel->mPositionKeys = new aiVectorKey[keyCount];
+    for (int idx = 0; idx < keyCount; idx++) {
+        channel->mPositionKeys[idx].mTime = idx;
+        channel->mPositionKeys[idx].mValue = aiVector3D{std::sin(idx * 0.1f), 0.0f, 0.0f};
+    }
+    channel->mNumRotationKeys = 1;
+    channel->mRotationKeys = new aiQuatKey[1]{};
+    channel->mNumScalingKeys = 1;
+    channel->mScalingKeys = new aiVectorKey[1]{};
+    channel->mScalingKeys[0].mValue = aiVector3D{1.0f, 1.0f, 1.0f};
+    return channel;
+}
+
+/*** Synthetic character ***/
+// Channel of bone `index` with keys one tick apart like `makeChannel`, but rotating. Every seventh
+// bone keeps a constant position, like the many bones of a mixamo rig that only rotate.
+aiNodeAnim* makeSyntheticChannel(const std::string& name, int index, int keyCount) {
+    auto* channel = new aiNodeAnim;
+    channel->mNodeName = aiString{name};
+    const int positionKeyCount = index % 7 == 0 ? 1 : keyCount;
+    channel->mNumPositionKeys = positionKeyCount;
+    channel->mPositionKeys = new aiVectorKey[positionKeyCount];
+    for (int idx = 0; idx < positionKeyCount; idx++) {
+        const float time = static_cast<float>(idx);
+        channel->mPositionKeys[idx].mTime = time;
+        channel->mPositionKeys[idx].mValue = aiVector3D{0.01f * std::sin(time * 0.05f + index + 1), 1.0f + 0.05f * std::cos(time * 0.03f), 0.0f};
+    }
+
+    // swings back and forth around an axis of its own
+    aiVector3D axis{std::sin(index * 1.3f), std::cos(index * 0.7f), 0.5f};
+    axis.Normalize();
+    channel->mNumRotationKeys = keyCount;
+    channel->mRotationKeys = new aiQuatKey[keyCount];
+    for (int idx = 0; idx < keyCount; idx++) {
+        const float halfAngle = 0.3f * std::sin(idx * 0.04f + index);
+        channel->mRotationKeys[idx].mTime = idx;
+        channel->mRotationKeys[idx].mValue = aiQuaternion{std::cos(halfAngle), std::sin(halfAngle) * axis.x,
+                                                          std::sin(halfAngle) * axis.y, std::sin(halfAngle) * axis.z};
+    }
+
+    channel->mNumScalingKeys = 1;
+    channel->mScalingKeys = new aiVectorKey[1]{};
+    channel->mScalingKeys[0].mValue = aiVector3D{1.0f, 1.0f, 1.0f};
+    return channel;
+}
+
+// A node of the synthetic rig and its children, depth first like a file's hierarchy. Every node is
+// an animated bone of `model`. The offset matrices are identity, the random vertices of the
+// synthetic meshes don't belong to a bind pose anyway.
+aiNode* makeSyntheticNode(int depth, int boneCount, int keyCount, std::vector<aiNodeAnim*>& channels, Model& model) {
+    const int index = static_cast<int>(channels.size());
+    const std::string name = "mixamorig:Bone" + std::to_string(index);
+    auto* node = new aiNode(name);
+    node->mTransformation.b4 = 1.0f + 0.1f * depth;
+    model.getBoneInfoMap()[name] = Model::BoneInfo{index, glm::mat4{1.0f}};
+    model.getBoneCount()++;
+    channels.push_back(makeSyntheticChannel(name, index, keyCount));
+
+    // splits into three twice, then continues as chains like fingers
+    const int childCount = depth < 2 ? 3 : (depth < 12 ? 1 : 0);
+    std::vector<aiNode*> children;
+    for (int child = 0; child < childCount && static_cast<int>(channels.size()) < boneCount; child++) {
+        children.push_back(makeSyntheticNode(depth + 1, boneCount, keyCount, channels, model));
+    }
+    node->addChildren(static_cast<unsigned int>(children.size()), children.data());
+    return node;
+}
+
+// Scene with the node hierarchy and a clip of `keyCount` ticks at 30 ticks per second, the bones
+// are added to `model`.
+std::unique_ptr<aiScene> makeSyntheticScene(int boneCount, int keyCount, Model& model) {
+    std::vector<aiNodeAnim*> channels;
+    std::vector<aiNode*> roots;
+    while (static_cast<int>(channels.size()) < boneCount) {
+        roots.push_back(makeSyntheticNode(0, boneCount, keyCount, channels, model));
+    }
+    auto* rootNode = new aiNode("RootNode");
+    rootNode->addChildren(static_cast<unsigned int>(roots.size()), roots.data());
+
+    auto* animation = new aiAnimation;
+    animation->mDuration = keyCount - 1;
+    animation->mTicksPerSecond = 30.0;
+    animation->mNumChannels = static_cast<unsigned int>(channels.size());
+    animation->mChannels = new aiNodeAnim*[channels.size()];
+    std::copy(channels.begin(), channels.end(), animation->mChannels);
+
+    // the scene owns and deletes the nodes, animation and channels
+    auto scene = std::make_unique<aiScene>();
+    scene->mRootNode = rootNode;
+    scene->mNumAnimations = 1;
+    scene->mAnimations = new aiAnimation*[1]{animation};
+    return scene;
+}
+
+// Meshes of a character's typical sizes made of random vertices, each weighted to one to four
+// random bones. Vertex 0 of every mesh references a bone the rig doesn't have and vertex 1 has no
+// bones, both have to keep their bind pose.
+std::vector<Mesh> makeSyntheticMeshes(int boneCount) {
+    std::mt19937 rng{7};
+    std::uniform_real_distribution<float> coordinate{-1.0f, 1.0f};
+    std::uniform_int_distribution<int> anyBone{0, boneCount - 1};
+    std::uniform_int_distribution<int> influenceCount{1, MAX_BONE_INFLUENCE};
+
+    std::vector<Mesh> meshes;
+    for (const int vertexCount : {30000, 8000, 700}) {
+        std::vector<Mesh::Vertex> vertices(vertexCount);
+        for (auto& vertex : vertices) {
+            vertex = Mesh::Vertex{};
+            vertex.position = glm::vec3{coordinate(rng), coordinate(rng), coordinate(rng)};
+            vertex.normal = glm::normalize(glm::vec3{coordinate(rng), coordinate(rng), coordinate(rng)});
+            const int influences = influenceCount(rng);
+            float weightSum = 0.0f;
+            for (int idx = 0; idx < MAX_BONE_INFLUENCE; idx++) {
+                vertex.boneIds[idx] = idx < influences ? anyBone(rng) : -1;
+                vertex.boneWeights[idx] = idx < influences ? coordinate(rng) + 1.1f : 0.0f;
+                weightSum += vertex.boneWeights[idx];
+            }
+            for (float& weight : vertex.boneWeights) {
+                weight /= weightSum;
+            }
+        }
+        vertices[0].boneIds[0] = boneCount + 500;
+        std::fill(std::begin(vertices[1].boneIds), std::end(vertices[1].boneIds), -1);
+        meshes.emplace_back(std::move(vertices), std::vector<unsigned int>{}, std::vector<Mesh::Texture>{}, false);
+    }
+    return meshes;
+}
+
+/*** Key lookup ***/
+// Playback at 30 ticks per second and 60 frames per second over the whole clip, plus random seeks.
+void benchmarkKeyLookup() {
+    fmt::println("key lookup: ns per lookup");
+    fmt::println("{:>8} {:>12} {:>12} {:>12} {:>12}", "keys", "scan/play", "cursor/play", "scan/seek", "cursor/seek");
+
+    for (const int keyCount : {30, 300, 3000, 30000}) {
+        const auto channel = makeChannel(keyCount);
+        Bone bone{"benchmark", 0, channel.get()};
+
+        std::vector<KeyPosition> keys(keyCount);
+        for (int idx = 0; idx < keyCount; idx++) {
+            keys[idx].timeStamp = static_cast<float>(channel->mPositionKeys[idx].mTime);
+        }
+
+        const float duration = keys.back().timeStamp;
+        std::vector<float> playbackTimes;
+        for (float time = 0.0f; time < duration; time += 0.5f) {
+            playbackTimes.push_back(time);
+        }
+        std::vector<float> seekTimes(playbackTimes.size());
+        std::mt19937 rng{42};
+        std::uniform_real_distribution<float> anyTime{0.0f, duration};
+        std::generate(seekTimes.begin(), seekTimes.end(), [&] { return anyTime(rng); });
+
+        for (const auto& times : {playbackTimes, seekTimes}) {
+            for (const float time : times) {
+                if (bone.getPositionIdx(time) != linearScanIdx(time, keys)) {
+                    fmt::println("key mismatch at time {} with {} keys", time, keyCount);
+                    return;
+                }
+            }
+        }
+
+        const auto perLookup = [&](const std::vector<float>& times, const std::function<int(float)>& lookup) {
+            return timeNs([&] {
+                long checksum = 0;
+                for (const float time : times) {
+                    checksum += lookup(time);
+                }
+                gSink = gSink + checksum;
+            }) / times.size();
+        };
+        const auto scan = [&](float time) { return linearScanIdx(time, keys); };
+        const auto cursor = [&](float time) { return bone.getPositionIdx(time); };
+
+        fmt::println("{:>8} {:>12.1f} {:>12.1f} {:>12.1f} {:>12.1f}", keyCount,
+                     perLookup(playbackTimes, scan), perLookup(playbackTimes, cursor),
+                     perLookup(seekTimes, scan), perLookup(seekTimes, cursor));
+    }
+}
+
+/*** Crowd ***/
+// Characters animated per millisecond, one Animator per character against a CrowdAnimator.
+void benchmarkCrowd(Animation& animation) {
+    constexpr int kFrames = 10;
+    constexpr float kFrameTime = 1.0f / 60.0f;
+
+    // same clip time, same matrices
+    Animator reference{&animation};
+    CrowdAnimator check{&animation};
+    check.addCharacter();
+    JobPool singleThread{1};
+    for (int frame = 0; frame < kFrames; frame++) {
+        reference.updateAnimation(kFrameTime);
+        check.updateAnimation(kFrameTime, singleThread);
+    }
+    for (int bone = 0; bone < check.getBoneCount(); bone++) {
+        const auto& a = reference.getFinalBoneMatrices()[bone];
+        const auto& b = check.getFinalBoneMatrices()[bone];
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 4; row++) {
+                if (std::abs(a[col][row] - b[col][row]) > 1e-5f) {
+                    fmt::println("crowd bone {} differs from Animator", bone);
+                    return;
+                }
+            }
+        }
+    }
+
+    JobPool pool;
+    fmt::println("crowd: characters per ms, {} threads", pool.getThreadCount());
+    fmt::println("{:>10} {:>12} {:>12} {:>12}", "characters", "animators", "crowd/1", "crowd/all");
+    for (const int characterCount : {100, 1000, 5000}) {
+        std::vector<Animator> animators(characterCount, Animator{&animation});
+        CrowdAnimator crowd{&animation};
+        for (int character = 0; character < characterCount; character++) {
+            // spread the characters over the clip
+            animators[character].updateAnimation(character * 0.037f);
+            crowd.addCharacter(character * 0.037f);
+        }
+
+        const auto charactersPerMs = [&](const std::function<void()>& frame) {
+            const double ns = timeNs([&] {
+                for (int i = 0; i < kFrames; i++) {
+                    frame();
+                }
+            });
+            return characterCount * kFrames / (ns * 1e-6);
+        };
+        const double animatorRate = charactersPerMs([&] {
+            for (auto& animator : animators) {
+                animator.updateAnimation(kFrameTime);
+            }
+        });
+        const double singleRate = charactersPerMs([&] { crowd.updateAnimation(kFrameTime, singleThread); });
+        const double poolRate = charactersPerMs([&] { crowd.updateAnimation(kFrameTime, pool); });
+        fmt::println("{:>10} {:>12.1f} {:>12.1f} {:>12.1f}", characterCount, animatorRate, singleRate, poolRate);
+    }
+}
+
+/*** Level of detail ***/
+// A crowd spread out in front of and behind the camera, with and without level of detail.
+void benchmarkLod(Animation& animation) {
+    constexpr int kCharacterCount = 500;
+    constexpr int kFrames = 64;
+    constexpr float kFrameTime = 1.0f / 60.0f;
+
+    // looking down -z from the origin
+    const Camera camera{Camera::ConfigState{glm::vec3{0.0f}, glm::vec3{0.0f, 0.0f, -1.0f}, glm::vec3{0.0f, 1.0f, 0.0f},
+                                            Camera::BoundedData<float>{45.0f, 1.0f, 45.0f},
+                                            Camera::BoundedData<float>{0.0f, -89.0f, 89.0f},
+                                            Camera::BoundedData<float>{-90.0f, std::nullopt, std::nullopt},
+                                            Camera::Sensitivity{1.0f, 1.0f}, glm::vec2{0.0f}, true}};
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+
+    // rows of 25 characters 1 unit apart, every fifth row behind the camera
+    const auto makeCrowd = [&] {
+        CrowdAnimator crowd{&animation};
+        for (int character = 0; character < kCharacterCount; character++) {
+            crowd.addCharacter(character * 0.037f);
+            const int row = character / 25;
+            const float z = row % 5 == 4 ? 5.0f + row : -2.0f - row * 6.0f;
+            crowd.setCharacterBounds(character, glm::vec3{(character % 25 - 12) * 1.0f, 0.0f, z}, 1.0f);
+        }
+        return crowd;
+    };
+
+    JobPool pool;
+    const auto msPerFrame = [&](const std::function<void()>& frame) {
+        return timeNs([&] {
+            for (int i = 0; i < kFrames; i++) {
+                frame();
+            }
+        }) / kFrames * 1e-6;
+    };
+
+    auto full = makeCrowd();
+    const double fullMs = msPerFrame([&] { full.updateAnimation(kFrameTime, pool); });
+
+    fmt::println("level of detail: {} characters, ms per frame, {} at full detail", kCharacterCount, fullMs);
+    fmt::println("{:>26} {:>10} {:>10} {:>12} {:>12} {:>10}", "", "ms/frame", "cap", "evaluated", "interpolated",
+                 "deferred");
+    const auto run = [&](const char* name, float budgetMs, int farNodeDepth) {
+        auto crowd = makeCrowd();
+        auto settings = crowd.getLodSettings();
+        settings.frameBudgetMs = budgetMs;
+        settings.levels.back().maxNodeDepth = farNodeDepth;
+        settings.offscreenMaxNodeDepth = farNodeDepth;
+        crowd.setLodSettings(settings);
+        // the first frame evaluates everyone once
+        crowd.updateAnimation(kFrameTime, camera, projection, pool);
+
+        long evaluated = 0;
+        long interpolated = 0;
+        long deferred = 0;
+        const double ms = msPerFrame([&] {
+            crowd.updateAnimation(kFrameTime, camera, projection, pool);
+            evaluated += crowd.getLodStats().evaluated;
+            interpolated += crowd.getLodStats().interpolated;
+            deferred += crowd.getLodStats().deferred;
+        });
+        const long frames = static_cast<long>(kFrames) * kRepeat;
+        // the whole update against the cap, not only the evaluations it limits
+        const std::string cap = budgetMs > 0.0f ? fmt::format("{:.3f}{}", budgetMs, ms > budgetMs ? " over" : "") : "-";
+        fmt::println("{:>26} {:>10.3f} {:>10} {:>12.1f} {:>12.1f} {:>10.1f}", name, ms, cap,
+                     static_cast<double>(evaluated) / frames, static_cast<double>(interpolated) / frames,
+                     static_cast<double>(deferred) / frames);
+    };
+    run("lod", 0.0f, -1);
+    run("lod, far depth 4", 0.0f, 4);
+    run("lod, 0.5 ms budget", 0.5f, -1);
+}
+
+/*** Blending ***/
+// Cost of a cross-fade and a masked layer against playing a single clip. The target for a
+// cross-fade is under 1.5x a single clip through BlendAnimator.
+void benchmarkBlending(Animation& animation) {
+    constexpr int kFrames = 1000;
+    constexpr float kFrameTime = 1.0f / 60.0f;
+
+    // a single clip through the pose path gives the Animator's matrices
+    Animator reference{&animation};
+    BlendAnimator single{&animation};
+    for (int frame = 0; frame < 10; frame++) {
+        reference.updateAnimation(kFrameTime);
+        single.updateAnimation(kFrameTime);
+    }
+    float maxDifference = 0.0f;
+    for (std::size_t bone = 0; bone < reference.getFinalBoneMatrices().size(); bone++) {
+        const auto& a = reference.getFinalBoneMatrices()[bone];
+        const auto& b = single.getFinalBoneMatrices()[bone];
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 4; row++) {
+                maxDifference = std::max(maxDifference, std::abs(a[col][row] - b[col][row]));
+            }
+        }
+    }
+
+    // the same clip half a second apart, fading for longer than the benchmark runs
+    BlendAnimator fading{&animation};
+    fading.updateAnimation(0.5f);
+    fading.crossFade(&animation, 1e6f);
+    BlendAnimator layered{&animation};
+    layered.addLayer(&animation, 0.5f, animation.getSkeleton().names[animation.getSkeleton().getNodeCount() / 2]);
+
+    const auto usPerUpdate = [&](const std::function<void()>& update) {
+        return timeNs([&] {
+            for (int frame = 0; frame < kFrames; frame++) {
+                update();
+            }
+        }) / kFrames * 1e-3;
+    };
+    const double animatorUs = usPerUpdate([&] { reference.updateAnimation(kFrameTime); });
+    const double singleUs = usPerUpdate([&] { single.updateAnimation(kFrameTime); });
+    const double fadeUs = usPerUpdate([&] { fading.updateAnimation(kFrameTime); });
+    const double layerUs = usPerUpdate([&] { layered.updateAnimation(kFrameTime); });
+    gSink = gSink + static_cast<long>(single.getFinalBoneMatrices()[0][3][0] + fading.getFinalBoneMatrices()[0][3][0]);
+
+    fmt::println("blending: us per update, single clip through BlendAnimator differs from Animator by {:.2e}", maxDifference);
+    fmt::println("{:>10} {:>10} {:>10} {:>10} {:>12}", "Animator", "single", "fade", "layer", "fade/single");
+    fmt::println("{:>10.2f} {:>10.2f} {:>10.2f} {:>10.2f} {:>12.2f} {}", animatorUs, singleUs, fadeUs, layerUs,
+                 fadeUs / singleUs, fadeUs / singleUs < 1.5 ? "under the 1.5x target" : "over the 1.5x target");
+}
+
+/*** CPU skinning ***/
+// The SIMD kernel against the scalar reference, on the model's meshes in one animated pose.
+void benchmarkSkinning(const Model& model, Animation& animation) {
+    Animator animator{&animation};
+    animator.updateAnimation(0.5f);
+    const auto& boneMatrices = animator.getFinalBoneMatrices();
+
+    int vertexCount = 0;
+    for (const auto& mesh : model.getMeshes()) {
+        vertexCount += static_cast<int>(mesh.getVertices().size());
+    }
+    if (vertexCount == 0) {
+        fmt::println("cpu skinning: the model has no vertices, skipped");
+        return;
+    }
+
+    const CpuSkinner scalar{CpuSkinner::Kernel::Scalar};
+    const CpuSkinner fastest;
+    JobPool singleThread{1};
+    JobPool pool;
+    std::vector<CpuSkinner::SkinnedMesh> reference;
+    std::vector<CpuSkinner::SkinnedMesh> skinned;
+    scalar.skin(model, boneMatrices, singleThread, reference);
+    fastest.skin(model, boneMatrices, singleThread, skinned);
+
+    float maxPositionError = 0.0f;
+    float maxNormalError = 0.0f;
+    for (std::size_t mesh = 0; mesh < reference.size(); mesh++) {
+        for (std::size_t vertex = 0; vertex < reference[mesh].positions.size(); vertex++) {
+            maxPositionError = std::max(maxPositionError,
+                                        glm::length(reference[mesh].positions[vertex] - skinned[mesh].positions[vertex]));
+            maxNormalError = std::max(maxNormalError,
+                                      glm::length(reference[mesh].normals[vertex] - skinned[mesh].normals[vertex]));
+        }
+    }
+
+    const auto verticesPerMs = [&](const CpuSkinner& skinner, JobPool& jobPool) {
+        const double ns = timeNs([&] { skinner.skin(model, boneMatrices, jobPool, skinned); });
+        return vertexCount / (ns * 1e-6);
+    };
+    const double scalarRate = verticesPerMs(scalar, singleThread);
+    const double fastestRate = verticesPerMs(fastest, singleThread);
+    const double poolRate = verticesPerMs(fastest, pool);
+
+    fmt::println("cpu skinning: {} vertices in {} meshes, {} kernel, max difference to scalar: position {:.2e}, normal {:.2e}",
+                 vertexCount, model.getMeshes().size(), CpuSkinner::getKernelName(fastest.getKernel()),
+                 maxPositionError, maxNormalError);
+    fmt::println("{:>12} {:>12} {:>12}  vertices per ms, {} threads", "scalar", "simd/1", "simd/all", pool.getThreadCount());
+    fmt::println("{:>12.0f} {:>12.0f} {:>12.0f}", scalarRate, fastestRate, poolRate);
+}
+
+/*** Baked animation ***/
+// Size and accuracy of baking the clip for instanced drawing, blended between frames like
+// baked_instanced.vert does.
+void benchmarkBakedAnimation(const Animation& animation) {
+    const auto& skeleton = animation.getSkeleton();
+    std::vector<Bone::KeyCursor> cursors(animation.getBoneChannelCount());
+    std::vector<glm::mat4> localTransforms(skeleton.getNodeCount());
+    std::vector<glm::mat4> globalTransforms(skeleton.getNodeCount());
+
+    fmt::println("baked animation: max difference of a skinning matrix element to the clip, blended between frames");
+    fmt::println("{:>6} {:>8} {:>12} {:>10} {:>12}", "fps", "frames", "bytes", "bake ms", "max error");
+    for (const float framesPerSecond : {15.0f, 30.0f, 60.0f}) {
+        std::unique_ptr<BakedAnimation> baked;
+        const double bakeMs = timeNs([&] {
+            baked = std::make_unique<BakedAnimation>(std::vector<const Animation*>{&animation}, framesPerSecond);
+        }) * 1e-6;
+        const int boneCount = baked->getBoneCount();
+        std::vector<glm::mat4> reference(boneCount, glm::mat4{1.0f});
+        const auto& clip = baked->getClips()[0];
+
+        // the last frame blends back into the first, where the clip itself jumps unless it loops seamlessly
+        const float lastFrameSeconds = clip.duration * (clip.frameCount - 1) / clip.frameCount;
+        float maxError = 0.0f;
+        for (float seconds = 0.0f; seconds < lastFrameSeconds; seconds += 1.0f / 240.0f) {
+            const float ticks = seconds * animation.getTicksPerSecond();
+            for (int node = 0; node < skeleton.getNodeCount(); node++) {
+                const int boneIdx = skeleton.boneIdxs[node];
+                localTransforms[node] = boneIdx >= 0 ? animation.getBone(boneIdx).sampleLocalTransform(ticks, cursors[boneIdx])
+                                                     : skeleton.bindTransforms[node];
+            }
+            skeleton.computeBoneMatrices(localTransforms.data(), globalTransforms.data(), reference.data());
+
+            const float frame = seconds / clip.duration * clip.frameCount;
+            const int frame0 = std::min(static_cast<int>(frame), clip.frameCount - 1);
+            const int frame1 = (frame0 + 1) % clip.frameCount;
+            const float blend = frame - frame0;
+            for (int bone = 0; bone < boneCount; bone++) {
+                const glm::mat4 a = baked->getBoneMatrix(clip.firstFrame + frame0, bone);
+                const glm::mat4 b = baked->getBoneMatrix(clip.firstFrame + frame1, bone);
+                for (int col = 0; col < 4; col++) {
+                    for (int row = 0; row < 3; row++) {
+                        const float value = a[col][row] + (b[col][row] - a[col][row]) * blend;
+                        maxError = std::max(maxError, std::abs(value - reference[bone][col][row]));
+                    }
+                }
+            }
+        }
+        fmt::println("{:>6.0f} {:>8} {:>12} {:>10.2f} {:>12.6f}", framesPerSecond, baked->getFrameCount(),
+                     baked->getTexels().size() * sizeof(glm::vec4), bakeMs, maxError);
+    }
+}
+
+/*** Compressed clip ***/
+// Key memory, accuracy and sampling cost of a CompressedClip against the Animation it was built from,
+// then a clip saved, loaded and played by an Animator like a runtime without assimp would.
+void benchmarkCompressedClip(Animation& animation) {
+    const auto& skeleton = animation.getSkeleton();
+    const int nodeCount = skeleton.getNodeCount();
+
+    std::size_t animationBytes = 0;
+    for (int bone = 0; bone < animation.getBoneChannelCount(); bone++) {
+        animationBytes += animation.getBone(bone).getPositionKeys().size() * sizeof(KeyPosition) +
+                          animation.getBone(bone).getRotationKeys().size() * sizeof(KeyRotation) +
+                          animation.getBone(bone).getScaleKeys().size() * sizeof(KeyScale);
+    }
+
+    // every 1/240 s over the whole clip
+    std::vector<float> times;
+    for (float time = 0.0f; time < animation.getDuration(); time += animation.getTicksPerSecond() / 240.0f) {
+        times.push_back(time);
+    }
+
+    std::vector<Bone::KeyCursor> animationCursors(animation.getBoneChannelCount());
+    std::vector<glm::mat4> reference(nodeCount);
+    const auto sampleAnimation = [&](float time) {
+        for (int node = 0; node < nodeCount; node++) {
+            const int boneIdx = skeleton.boneIdxs[node];
+            reference[node] = boneIdx >= 0 ? animation.getBone(boneIdx).sampleLocalTransform(time, animationCursors[boneIdx])
+                                           : skeleton.bindTransforms[node];
+        }
+    };
+
+    fmt::println("compressed clip: {} bytes of keys in the Animation, {} poses compared", animationBytes, times.size());
+    fmt::println("{:>10} {:>10} {:>8} {:>14} {:>14} {:>12} {:>12}", "tolerance", "bytes", "ratio",
+                 "max transl.", "max rot. rad", "ns/pose", "ns/pose clip");
+    for (const float tolerance : {1e-4f, 1e-3f, 1e-2f}) {
+        const auto clip = CompressedClip::compress(animation, CompressedClip::Settings{tolerance, tolerance, tolerance});
+        std::vector<Bone::KeyCursor> clipCursors(clip.getChannelCount());
+        std::vector<glm::mat4> decoded(nodeCount);
+
+        float maxTranslationError = 0.0f;
+        float maxRotationError = 0.0f;
+        for (const float time : times) {
+            sampleAnimation(time);
+            clip.sampleLocalTransforms(time, clipCursors.data(), decoded.data());
+            for (int node = 0; node < nodeCount; node++) {
+                maxTranslationError = std::max(maxTranslationError, glm::length(glm::vec3{reference[node][3]} - glm::vec3{decoded[node][3]}));
+                const auto rotation = [](const glm::mat4& m) {
+                    return glm::quat_cast(glm::mat3{glm::normalize(glm::vec3{m[0]}), glm::normalize(glm::vec3{m[1]}), glm::normalize(glm::vec3{m[2]})});
+                };
+                const glm::quat difference = glm::conjugate(rotation(reference[node])) * rotation(decoded[node]);
+                const float angle = 2.0f * std::atan2(glm::length(glm::vec3{difference.x, difference.y, difference.z}), std::abs(difference.w));
+                maxRotationError = std::max(maxRotationError, angle);
+            }
+        }
+
+        const double animationNs = timeNs([&] {
+            for (const float time : times) {
+                sampleAnimation(time);
+            }
+        }) / times.size();
+        const double clipNs = timeNs([&] {
+            for (const float time : times) {
+                clip.sampleLocalTransforms(time, clipCursors.data(), decoded.data());
+            }
+        }) / times.size();
+        gSink = gSink + static_cast<long>(reference[0][3][0] + decoded[0][3][0]);
+
+        fmt::println("{:>10} {:>10} {:>8.1f} {:>14.6f} {:>14.6f} {:>12.1f} {:>12.1f}", tolerance, clip.getKeyMemoryUsage(),
+                     static_cast<double>(animationBytes) / clip.getKeyMemoryUsage(), maxTranslationError, maxRotationError,
+                     animationNs, clipNs);
+    }
+
+    const auto clip = CompressedClip::compress(animation, CompressedClip::Settings{});
+    const auto path = (std::filesystem::temp_directory_path() / "skeletal-animation-benchmark.clip").string();
+    if (!clip.save(path)) {
+        fmt::println("cannot write {}", path);
+        return;
+    }
+    const auto fileBytes = std::filesystem::file_size(path);
+    const auto loaded = CompressedClip::load(path);
+    std::filesystem::remove(path);
+    if (loaded.isEmpty()) {
+        fmt::println("cannot load {}", path);
+        return;
+    }
+
+    // two seconds at 60 frames per second
+    Animator fromFile{&loaded};
+    Animator fromMemory{&clip};
+    Animator fromAnimation{&animation};
+    float maxDifference = 0.0f;
+    bool identical = true;
+    for (int frame = 0; frame < 120; frame++) {
+        fromFile.updateAnimation(1.0f / 60.0f);
+        fromMemory.updateAnimation(1.0f / 60.0f);
+        fromAnimation.updateAnimation(1.0f / 60.0f);
+        for (std::size_t bone = 0; bone < fromAnimation.getFinalBoneMatrices().size(); bone++) {
+            const auto& a = fromAnimation.getFinalBoneMatrices()[bone];
+            const auto& b = fromFile.getFinalBoneMatrices()[bone];
+            for (int col = 0; col < 4; col++) {
+                for (int row = 0; row < 4; row++) {
+                    maxDifference = std::max(maxDifference, std::abs(a[col][row] - b[col][row]));
+                }
+            }
+            identical = identical && b == fromMemory.getFinalBoneMatrices()[bone];
+        }
+    }
+    fmt::println("clip file: {} bytes, loaded clip {} the saved one, played by an Animator it differs from the "
+                 "Animation by {:.6f} per bone matrix element", fileBytes, identical ? "samples the same as" : "DIFFERS from",
+                 maxDifference);
+}
+
+int main(int argc, char** argv) {
+    fmt::println("{}", APP_NAME);
+    benchmarkKeyLookup();
+
+    std::unique_ptr<Model> model;
+    std::unique_ptr<Animation> animation;
+    if (argc > 1) {
+        if (!std::ifstream{argv[1]}.good()) {
+            fmt::println("{} not found", argv[1]);
+            return 1;
+        }
+        model = std::make_unique<Model>(argv[1], Model::LoadOptions{false});
+        animation = std::make_unique<Animation>(argv[1], *model);
+    } else {
+        model = std::make_unique<Model>(makeSyntheticMeshes(kSyntheticBoneCount));
+        const auto scene = makeSyntheticScene(kSyntheticBoneCount, kSyntheticKeyCount, *model);
+        animation = std::make_unique<Animation>(scene.get(), *model);
+        fmt::println("synthetic character: {} bones, {} keys per channel", kSyntheticBoneCount, kSyntheticKeyCount);
+    }
+    benchmarkCrowd(*animation);
+    benchmarkLod(*animation);
+    benchmarkBlending(*animation);
+    benchmarkSkinning(*model, *animation);
+    benchmarkBakedAnimation(*animation);
+    benchmarkCompressedClip(*animation);
+    return 0;
+}
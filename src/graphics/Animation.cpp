@@ -5,35 +5,55 @@
 
 Animation::Animation(const std::string &animationFilePath, Model &model) {
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(animationFilePath, aiProcess_Triangulate);
+    readScene(importer.ReadFile(animationFilePath, aiProcess_Triangulate), model);
+}
+
+Animation::Animation(const aiScene *scene, Model &model) {
+    readScene(scene, model);
+}
+
+void Animation::readScene(const aiScene *scene, Model &model) {
     assert(scene != nullptr && scene->mRootNode != nullptr);
     auto animation = scene->mAnimations[0];
     m_duration = animation->mDuration;
     m_ticksPerSecond = animation->mTicksPerSecond;
-    readHeirarchyData(m_rootNode, scene->mRootNode);
+    readHeirarchyData(scene->mRootNode, -1);
     readMissingBones(animation, model);
+    resolveNodeChannels();
 }
 
-std::optional<Bone> Animation::findBone(const std::string &name) {
+Bone* Animation::findBone(const std::string &name) {
     auto boneIt = std::find_if(m_bones.begin(), m_bones.end(), [&name](const auto& b){
         return b.getBoneName() == name;
     });
     if (boneIt != m_bones.end()) {
-        return *boneIt;
+        return &*boneIt;
     }
-    return std::nullopt;
+    return nullptr;
 }
 
-float Animation::getTicksPerSecond() {
+Bone &Animation::getBone(int boneIdx) {
+    return m_bones[boneIdx];
+}
+
+const Bone &Animation::getBone(int boneIdx) const {
+    return m_bones[boneIdx];
+}
+
+int Animation::getBoneChannelCount() const {
+    return static_cast<int>(m_bones.size());
+}
+
+float Animation::getTicksPerSecond() const {
     return m_ticksPerSecond;
 }
 
-float Animation::getDuration() {
+float Animation::getDuration() const {
     return m_duration;
 }
 
-const AssimpNodeData &Animation::getRootNode() {
-    return m_rootNode;
+const Skeleton &Animation::getSkeleton() const {
+    return m_skeleton;
 }
 
 const std::unordered_map<std::string, Model::BoneInfo> &Animation::getBoneIdMap() {
@@ -59,11 +79,10 @@ void Animation::readMissingBones(const aiAnimation *animation, Model &model) {
     m_boneInfoMap = boneInfoMap;
 }
 
-void Animation::readHeirarchyData(AssimpNodeData &dest, const aiNode *src) {
+void Animation::readHeirarchyData(const aiNode *src, int parent) {
     assert(src != nullptr);
 
-    dest.name = src->mName.C_Str();
-    dest.transform = [from = src->mTransformation]{
+    const glm::mat4 transform = [from = src->mTransformation]{
         glm::mat4 to;
         //the a,b,c,d in assimp is the row ; the 1,2,3,4 is the column
         to[0][0] = from.a1; to[1][0] = from.a2; to[2][0] = from.a3; to[3][0] = from.a4;
@@ -72,11 +91,29 @@ void Animation::readHeirarchyData(AssimpNodeData &dest, const aiNode *src) {
         to[0][3] = from.d1; to[1][3] = from.d2; to[2][3] = from.d3; to[3][3] = from.d4;
         return to;
     }();
-    dest.childrenCount = src->mNumChildren;
+    // depth first, a node is added before any of its children
+    const int node = m_skeleton.addNode(src->mName.C_Str(), parent, transform);
 
     for (auto i = 0; i < src->mNumChildren; i++) {
-        AssimpNodeData newData{};
-        readHeirarchyData(newData, src->mChildren[i]);
-        dest.children.push_back(newData);
+        readHeirarchyData(src->mChildren[i], node);
+    }
+}
+
+void Animation::resolveNodeChannels() {
+    for (int node = 0; node < m_skeleton.getNodeCount(); node++) {
+        const auto& name = m_skeleton.names[node];
+
+        const auto boneIt = std::find_if(m_bones.begin(), m_bones.end(), [&name](const auto& b){
+            return b.getBoneName() == name;
+        });
+        if (boneIt != m_bones.end()) {
+            m_skeleton.boneIdxs[node] = static_cast<int>(boneIt - m_bones.begin());
+        }
+
+        const auto boneInfoIt = m_boneInfoMap.find(name);
+        if (boneInfoIt != m_boneInfoMap.end()) {
+            m_skeleton.boneIds[node] = boneInfoIt->second.id;
+            m_skeleton.offsetMatrices[node] = boneInfoIt->second.offsetMatrix;
+        }
     }
 }
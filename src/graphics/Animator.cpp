@@ -2,14 +2,14 @@
 
 #include "Animation.hpp"
 #include "Bone.hpp"
+#include "CompressedClip.hpp"
 
 Animator::Animator(Animation *animation) {
-    m_currentAnimation = animation;
-    m_finalBoneMatrices.reserve(100);
+    playAnimation(animation);
+}
 
-    for (auto i = 0; i < 100; i++) {
-        m_finalBoneMatrices.emplace_back(glm::mat4{1.0f});
-    }
+Animator::Animator(const CompressedClip *clip) {
+    playClip(clip);
 }
 
 void Animator::updateAnimation(float dt) {
@@ -17,40 +17,77 @@ void Animator::updateAnimation(float dt) {
     if (m_currentAnimation != nullptr) {
         m_currentTime += m_currentAnimation->getTicksPerSecond() * dt;
         m_currentTime = fmod(m_currentTime, m_currentAnimation->getDuration());
-        calculateBoneTransform(&m_currentAnimation->getRootNode(), glm::mat4{1.0f});
+        calculateBoneTransforms();
+    } else if (m_currentClip != nullptr) {
+        m_currentTime += m_currentClip->getTicksPerSecond() * dt;
+        m_currentTime = fmod(m_currentTime, m_currentClip->getDuration());
+        calculateBoneTransforms();
     }
 }
 
 void Animator::playAnimation(Animation *animation) {
     m_currentAnimation = animation;
+    m_currentClip = nullptr;
     m_currentTime = 0.0f;
+    resizeBuffers();
 }
 
-void Animator::calculateBoneTransform(const AssimpNodeData *node, glm::mat4 parentTransform) {
-    const auto nodeName = node->name;
-    glm::mat4 nodeTransform = node->transform;
+void Animator::playClip(const CompressedClip *clip) {
+    m_currentAnimation = nullptr;
+    m_currentClip = clip;
+    m_currentTime = 0.0f;
+    if (m_currentClip != nullptr) {
+        m_clipCursors.assign(m_currentClip->getChannelCount(), Bone::KeyCursor{});
+    }
+    resizeBuffers();
+}
 
-    auto bone = m_currentAnimation->findBone(nodeName);
-    if (bone.has_value()) {
-        bone->update(m_currentTime);
-        nodeTransform = bone->getLocalTransform();
+void Animator::calculateBoneTransforms() {
+    if (m_currentClip != nullptr) {
+        const auto& skeleton = m_currentClip->getSkeleton();
+        m_currentClip->sampleLocalTransforms(m_currentTime, m_clipCursors.data(), m_localTransforms.data());
+        skeleton.computeBoneMatrices(m_localTransforms.data(), m_globalTransforms.data(), m_finalBoneMatrices.data());
+        return;
     }
 
-    const glm::mat4 globalTransformation = parentTransform * nodeTransform;
+    const auto& skeleton = m_currentAnimation->getSkeleton();
 
-    auto boneInfoMap = m_currentAnimation->getBoneIdMap();
-    if (boneInfoMap.find(nodeName) != boneInfoMap.end())
-    {
-        const int index = boneInfoMap[nodeName].id;
-        const glm::mat4 offset = boneInfoMap[nodeName].offsetMatrix;
-        m_finalBoneMatrices[index] = globalTransformation * offset;
+    for (int node = 0; node < skeleton.getNodeCount(); node++) {
+        const int boneIdx = skeleton.boneIdxs[node];
+        if (boneIdx >= 0) {
+            auto& bone = m_currentAnimation->getBone(boneIdx);
+            bone.update(m_currentTime);
+            m_localTransforms[node] = bone.getLocalTransform();
+        } else {
+            m_localTransforms[node] = skeleton.bindTransforms[node];
+        }
     }
 
-    for (int i = 0; i < node->childrenCount; i++) {
-        calculateBoneTransform(&node->children[i], globalTransformation);
-    }
+    skeleton.computeBoneMatrices(m_localTransforms.data(), m_globalTransforms.data(), m_finalBoneMatrices.data());
 }
 
-std::vector<glm::mat4> Animator::getFinalBoneMatrices() {
+const std::vector<glm::mat4> &Animator::getFinalBoneMatrices() const {
     return m_finalBoneMatrices;
 }
+
+const Skeleton *Animator::getCurrentSkeleton() const {
+    if (m_currentAnimation != nullptr) {
+        return &m_currentAnimation->getSkeleton();
+    }
+    return m_currentClip != nullptr ? &m_currentClip->getSkeleton() : nullptr;
+}
+
+void Animator::resizeBuffers() {
+    const Skeleton* skeleton = getCurrentSkeleton();
+    if (skeleton == nullptr) {
+        return;
+    }
+    const auto nodeCount = skeleton->getNodeCount();
+    m_localTransforms.resize(nodeCount);
+    m_globalTransforms.resize(nodeCount);
+    // only grows, bones the new clip doesn't drive keep their last matrix
+    const auto boneCount = static_cast<std::size_t>(skeleton->getBoneCount());
+    if (m_finalBoneMatrices.size() < boneCount) {
+        m_finalBoneMatrices.resize(boneCount, glm::mat4{1.0f});
+    }
+}
@@ -0,0 +1,143 @@
+#include "BakedAnimation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include <glad/glad.h>
+
+#include "Animation.hpp"
+#include "Shader.hpp"
+
+BakedAnimation::BakedAnimation(const std::vector<const Animation *> &animations, float framesPerSecond) {
+    if (animations.size() > kMaxClips) {
+        std::cerr << "BakedAnimation: " << animations.size() << " clips given, only the first " << kMaxClips
+                  << " are baked\n";
+    }
+    for (const auto* animation : animations) {
+        m_boneCount = std::max(m_boneCount, animation->getSkeleton().getBoneCount());
+    }
+
+    std::vector<glm::mat4> localTransforms;
+    std::vector<glm::mat4> globalTransforms;
+    std::vector<glm::mat4> boneMatrices;
+    for (std::size_t clipIdx = 0; clipIdx < animations.size() && clipIdx < kMaxClips; clipIdx++) {
+        const Animation& animation = *animations[clipIdx];
+        const Skeleton& skeleton = animation.getSkeleton();
+        const float durationSeconds = animation.getDuration() / animation.getTicksPerSecond();
+        // a whole number of frames per loop, so the blend from the last frame back to the first
+        // is as long as any other
+        const int frameCount = std::max(1, static_cast<int>(std::lround(durationSeconds * framesPerSecond)));
+        m_clips.push_back({m_frameCount, frameCount, durationSeconds});
+
+        localTransforms.resize(skeleton.getNodeCount());
+        globalTransforms.resize(skeleton.getNodeCount());
+        boneMatrices.assign(m_boneCount, glm::mat4{1.0f});
+        std::vector<Bone::KeyCursor> cursors(animation.getBoneChannelCount());
+        for (int frame = 0; frame < frameCount; frame++) {
+            const float time = animation.getDuration() * static_cast<float>(frame) / static_cast<float>(frameCount);
+            for (int node = 0; node < skeleton.getNodeCount(); node++) {
+                const int boneIdx = skeleton.boneIdxs[node];
+                localTransforms[node] = boneIdx >= 0 ? animation.getBone(boneIdx).sampleLocalTransform(time, cursors[boneIdx])
+                                                     : skeleton.bindTransforms[node];
+            }
+            skeleton.computeBoneMatrices(localTransforms.data(), globalTransforms.data(), boneMatrices.data());
+
+            for (const auto& matrix : boneMatrices) {
+                for (int row = 0; row < 3; row++) {
+                    m_texels.emplace_back(matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]);
+                }
+            }
+        }
+        m_frameCount += frameCount;
+    }
+}
+
+BakedAnimation::~BakedAnimation() {
+    if (m_texture != 0) {
+        glDeleteTextures(1, &m_texture);
+    }
+}
+
+int BakedAnimation::getBoneCount() const {
+    return m_boneCount;
+}
+
+int BakedAnimation::getFrameCount() const {
+    return m_frameCount;
+}
+
+const std::vector<BakedAnimation::Clip> &BakedAnimation::getClips() const {
+    return m_clips;
+}
+
+const std::vector<glm::vec4> &BakedAnimation::getTexels() const {
+    return m_texels;
+}
+
+glm::mat4 BakedAnimation::getBoneMatrix(int frame, int bone) const {
+    const glm::vec4* rows = m_texels.data() + (static_cast<std::size_t>(frame) * m_boneCount + bone) * 3;
+    glm::mat4 matrix{1.0f};
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 3; row++) {
+            matrix[col][row] = rows[row][col];
+        }
+    }
+    return matrix;
+}
+
+void BakedAnimation::createTexture() {
+    if (m_texture != 0 || m_texels.empty()) {
+        return;
+    }
+
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    // frames that don't fit one column of rows fold into further bands of columns
+    const int bandWidth = m_boneCount * 3;
+    m_frameRows = std::min(m_frameCount, static_cast<int>(maxSize));
+    const int bandCount = (m_frameCount + m_frameRows - 1) / m_frameRows;
+    if (bandWidth > maxSize / bandCount) {
+        std::cerr << "BakedAnimation: " << m_boneCount << " bones over " << m_frameCount
+                  << " frames exceed the texture size limit of " << maxSize << ", the bake is not uploaded\n";
+        return;
+    }
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    // read with texelFetch only, no filtering or mipmaps
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, bandWidth * bandCount, m_frameRows, 0, GL_RGBA, GL_FLOAT, nullptr);
+    if (glGetError() == GL_OUT_OF_MEMORY) {
+        std::cerr << "BakedAnimation: out of memory for " << m_frameCount << " frames, the bake is not uploaded\n";
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDeleteTextures(1, &m_texture);
+        m_texture = 0;
+        return;
+    }
+    // the frames of a band are consecutive in m_texels
+    for (int band = 0; band < bandCount; band++) {
+        const int firstFrame = band * m_frameRows;
+        const int rows = std::min(m_frameRows, m_frameCount - firstFrame);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, band * bandWidth, 0, bandWidth, rows, GL_RGBA, GL_FLOAT,
+                        m_texels.data() + static_cast<std::size_t>(firstFrame) * bandWidth);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void BakedAnimation::bind(Shader &shader, int textureUnit) const {
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    shader.setInt("bakedBones", textureUnit);
+    shader.setInt("bakedBoneCount", m_boneCount);
+    shader.setInt("bakedFrameRows", m_frameRows);
+    for (std::size_t clip = 0; clip < m_clips.size(); clip++) {
+        const std::string idx = "[" + std::to_string(clip) + "]";
+        shader.setInt("bakedClipFirstFrame" + idx, m_clips[clip].firstFrame);
+        shader.setInt("bakedClipFrameCount" + idx, m_clips[clip].frameCount);
+        shader.setFloat("bakedClipDuration" + idx, m_clips[clip].duration);
+    }
+}
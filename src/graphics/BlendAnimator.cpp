@@ -0,0 +1,251 @@
+#include "BlendAnimator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Animation.hpp"
+
+namespace {
+template<typename T>
+inline float keyFactor(const std::vector<T>& keys, int idx, float time) {
+    const float span = keys[idx + 1].timeStamp - keys[idx].timeStamp;
+    return span > 0.0f ? std::clamp((time - keys[idx].timeStamp) / span, 0.0f, 1.0f) : 0.0f;
+}
+
+inline glm::vec3 keyValue(const KeyPosition& key) {
+    return key.position;
+}
+
+inline glm::quat keyValue(const KeyRotation& key) {
+    return key.orientation;
+}
+
+inline glm::vec3 keyValue(const KeyScale& key) {
+    return key.scale;
+}
+
+inline glm::vec3 lerpKeys(const std::vector<KeyPosition>& keys, int idx, float factor) {
+    return glm::mix(keys[idx].position, keys[idx + 1].position, factor);
+}
+
+inline glm::vec3 lerpKeys(const std::vector<KeyScale>& keys, int idx, float factor) {
+    return glm::mix(keys[idx].scale, keys[idx + 1].scale, factor);
+}
+
+// Neighbouring keys are a small angle apart and on the same hemisphere (see Bone), normalized
+// lerp between them is indistinguishable from slerp and needs no trig. The pose normalizes.
+inline glm::quat lerpKeys(const std::vector<KeyRotation>& keys, int idx, float factor) {
+    const glm::quat& a = keys[idx].orientation;
+    const glm::quat& b = keys[idx + 1].orientation;
+    return glm::quat{a.w + (b.w - a.w) * factor, a.x + (b.x - a.x) * factor, a.y + (b.y - a.y) * factor,
+                     a.z + (b.z - a.z) * factor};
+}
+
+template<typename T>
+inline auto sampleKeys(const std::vector<T>& keys, float time, int& cursor) {
+    if (keys.size() == 1) {
+        return keyValue(keys[0]);
+    }
+    const int idx = Bone::findKeyIdx(time, keys, cursor);
+    return lerpKeys(keys, idx, keyFactor(keys, idx, time));
+}
+
+// Single key tracks are constant and need no search, the other tracks must share the key times.
+template<typename T, typename U>
+bool sameKeyTimes(const std::vector<T>& keys, const std::vector<U>& others) {
+    if (others.size() == 1) {
+        return true;
+    }
+    return keys.size() == others.size() &&
+           std::equal(keys.begin(), keys.end(), others.begin(), [](const T& key, const U& other) {
+               return key.timeStamp == other.timeStamp;
+           });
+}
+}
+
+BlendAnimator::BlendAnimator(Animation *animation) : m_skeleton{&animation->getSkeleton()} {
+    const int nodeCount = m_skeleton->getNodeCount();
+    m_bindPose.resize(nodeCount);
+    for (int node = 0; node < nodeCount; node++) {
+        Pose::decompose(m_skeleton->bindTransforms[node], m_bindPose.translations[node], m_bindPose.rotations[node],
+                        m_bindPose.scales[node]);
+    }
+    m_pose.resize(nodeCount);
+    m_scratchPose.resize(nodeCount);
+    m_localTransforms.resize(nodeCount);
+    m_globalTransforms.resize(nodeCount);
+
+    m_finalBoneMatrices.resize(m_skeleton->getBoneCount(), glm::mat4{1.0f});
+
+    playAnimation(animation);
+}
+
+void BlendAnimator::updateAnimation(float dt) {
+    if (m_current.animation == nullptr) {
+        return;
+    }
+
+    advance(m_current, dt);
+    if (m_fading) {
+        m_fadeTime += dt;
+        if (!m_fadeFromFrozen) {
+            advance(m_previous, dt);
+        }
+    }
+    for (auto& layer : m_layers) {
+        advance(layer.clip, dt);
+    }
+
+    sampleBasePose(m_pose);
+    if (m_fading && m_fadeTime >= m_fadeDuration) {
+        m_fading = false;
+        m_previous = ClipState{};
+    }
+
+    for (auto& layer : m_layers) {
+        if (layer.weight <= 0.0f) {
+            continue;
+        }
+        sample(layer.clip, m_scratchPose);
+        m_pose.blend(m_scratchPose, layer.nodeWeights.data());
+    }
+
+    m_pose.toMatrices(m_localTransforms.data());
+    m_skeleton->computeBoneMatrices(m_localTransforms.data(), m_globalTransforms.data(), m_finalBoneMatrices.data());
+}
+
+void BlendAnimator::playAnimation(Animation *animation) {
+    m_current = makeClipState(animation);
+    m_previous = ClipState{};
+    m_fading = false;
+}
+
+void BlendAnimator::crossFade(Animation *animation, float duration) {
+    if (duration <= 0.0f || m_current.animation == nullptr) {
+        playAnimation(animation);
+        return;
+    }
+
+    if (m_fading) {
+        // the clips of the interrupted fade stop, fade out of where they were
+        sampleBasePose(m_frozenPose);
+        m_fadeFromFrozen = true;
+        m_previous = ClipState{};
+    } else {
+        m_previous = std::move(m_current);
+        m_fadeFromFrozen = false;
+    }
+    m_current = makeClipState(animation);
+    m_fading = true;
+    m_fadeTime = 0.0f;
+    m_fadeDuration = duration;
+}
+
+int BlendAnimator::addLayer(Animation *animation, float weight, const std::string &maskRoot) {
+    const int nodeCount = m_skeleton->getNodeCount();
+    Layer layer{makeClipState(animation), weight, std::vector<float>(nodeCount, maskRoot.empty() ? 1.0f : 0.0f), {}};
+
+    const int root = maskRoot.empty() ? -1 : m_skeleton->findNode(maskRoot);
+    if (root >= 0) {
+        // parents come before their children, one pass marks the whole subtree
+        layer.mask[root] = 1.0f;
+        for (int node = root + 1; node < nodeCount; node++) {
+            const int parent = m_skeleton->parents[node];
+            if (parent >= 0) {
+                layer.mask[node] = layer.mask[parent];
+            }
+        }
+    }
+
+    m_layers.push_back(std::move(layer));
+    setLayerWeight(static_cast<int>(m_layers.size()) - 1, weight);
+    return static_cast<int>(m_layers.size()) - 1;
+}
+
+void BlendAnimator::setLayerWeight(int layerIdx, float weight) {
+    auto& layer = m_layers[layerIdx];
+    layer.weight = std::clamp(weight, 0.0f, 1.0f);
+    layer.nodeWeights.resize(layer.mask.size());
+    for (std::size_t node = 0; node < layer.mask.size(); node++) {
+        layer.nodeWeights[node] = layer.mask[node] * layer.weight;
+    }
+}
+
+const std::vector<glm::mat4> &BlendAnimator::getFinalBoneMatrices() const {
+    return m_finalBoneMatrices;
+}
+
+BlendAnimator::ClipState BlendAnimator::makeClipState(Animation *animation) const {
+    ClipState clip;
+    clip.animation = animation;
+    if (animation == nullptr) {
+        return clip;
+    }
+
+    const Skeleton& clipSkeleton = animation->getSkeleton();
+    const int nodeCount = m_skeleton->getNodeCount();
+    clip.nodeKeys.resize(nodeCount);
+    for (int node = 0; node < nodeCount; node++) {
+        // same file or same exporter usually means same node order, skip the search then
+        const bool sameNode = node < clipSkeleton.getNodeCount() && clipSkeleton.names[node] == m_skeleton->names[node];
+        const int clipNode = sameNode ? node : clipSkeleton.findNode(m_skeleton->names[node]);
+        if (clipNode >= 0 && clipSkeleton.boneIdxs[clipNode] >= 0) {
+            const Bone& bone = animation->getBone(clipSkeleton.boneIdxs[clipNode]);
+            const auto& positions = bone.getPositionKeys();
+            const auto& rotations = bone.getRotationKeys();
+            const auto& scales = bone.getScaleKeys();
+            const bool sharedKeyTimes =
+                positions.size() > 1 && sameKeyTimes(positions, rotations) && sameKeyTimes(positions, scales);
+            clip.nodeKeys[node] = NodeKeys{&positions, &rotations, &scales, sharedKeyTimes};
+        }
+    }
+    clip.cursors.resize(nodeCount);
+    return clip;
+}
+
+void BlendAnimator::advance(ClipState &clip, float dt) {
+    clip.time += clip.animation->getTicksPerSecond() * dt;
+    clip.time = std::fmod(clip.time, clip.animation->getDuration());
+}
+
+void BlendAnimator::sample(ClipState &clip, Pose &pose) const {
+    const int nodeCount = m_skeleton->getNodeCount();
+    for (int node = 0; node < nodeCount; node++) {
+        const NodeKeys& keys = clip.nodeKeys[node];
+        if (keys.positions == nullptr) {
+            pose.translations[node] = m_bindPose.translations[node];
+            pose.rotations[node] = m_bindPose.rotations[node];
+            pose.scales[node] = m_bindPose.scales[node];
+            continue;
+        }
+        Bone::KeyCursor& cursor = clip.cursors[node];
+        if (keys.sharedKeyTimes) {
+            const int idx = Bone::findKeyIdx(clip.time, *keys.positions, cursor.position);
+            const float factor = keyFactor(*keys.positions, idx, clip.time);
+            pose.translations[node] = lerpKeys(*keys.positions, idx, factor);
+            const auto& rotations = *keys.rotations;
+            const auto& scales = *keys.scales;
+            pose.rotations[node] = rotations.size() == 1 ? keyValue(rotations[0]) : lerpKeys(rotations, idx, factor);
+            pose.scales[node] = scales.size() == 1 ? keyValue(scales[0]) : lerpKeys(scales, idx, factor);
+            continue;
+        }
+        pose.translations[node] = sampleKeys(*keys.positions, clip.time, cursor.position);
+        pose.rotations[node] = sampleKeys(*keys.rotations, clip.time, cursor.rotation);
+        pose.scales[node] = sampleKeys(*keys.scales, clip.time, cursor.scale);
+    }
+}
+
+void BlendAnimator::sampleBasePose(Pose &pose) {
+    if (!m_fading) {
+        sample(m_current, pose);
+        return;
+    }
+
+    if (m_fadeFromFrozen) {
+        pose = m_frozenPose;
+    } else {
+        sample(m_previous, pose);
+    }
+    sample(m_current, m_scratchPose);
+    pose.blend(m_scratchPose, std::min(m_fadeTime / m_fadeDuration, 1.0f));
+}
@@ -1,5 +1,8 @@
 #include "Bone.hpp"
 
+#include <algorithm>
+#include <cassert>
+
 #include <assimp/anim.h>
 #include <glm/gtx/quaternion.hpp>
 
@@ -23,6 +26,11 @@ Bone::Bone(std::string name, int id, const aiNodeAnim *channel)
         const auto& rotationKey = channel->mRotationKeys[idx];
         KeyRotation data{};
         data.orientation = glm::quat{rotationKey.mValue.w, rotationKey.mValue.x, rotationKey.mValue.y, rotationKey.mValue.z};
+        // q and -q are the same rotation, neighbouring keys are kept on one hemisphere so a plain
+        // lerp between them takes the shorter arc
+        if (!m_rotations.empty() && glm::dot(m_rotations.back().orientation, data.orientation) < 0.0f) {
+            data.orientation = -data.orientation;
+        }
         data.timeStamp = rotationKey.mTime;
         m_rotations.push_back(data);
     }
@@ -38,10 +46,14 @@ Bone::Bone(std::string name, int id, const aiNodeAnim *channel)
 }
 
 void Bone::update(float animationTime) {
-    const auto translation = interpolatePosition(animationTime);
-    const auto rotation = interpolateRotation(animationTime);
-    const auto scale = interpolateScale(animationTime);
-    m_localTransform = translation * rotation * scale;
+    m_localTransform = sampleLocalTransform(animationTime, m_cursor);
+}
+
+glm::mat4 Bone::sampleLocalTransform(float animationTime, KeyCursor &cursor) const {
+    const auto translation = interpolatePosition(animationTime, cursor.position);
+    const auto rotation = interpolateRotation(animationTime, cursor.rotation);
+    const auto scale = interpolateScale(animationTime, cursor.scale);
+    return translation * rotation * scale;
 }
 
 glm::mat4 Bone::getLocalTransform() {
@@ -56,69 +68,79 @@ int Bone::getBoneId() {
     return m_Id;
 }
 
-template<typename T>
-int getImpl(float animationTime, const std::vector<T>& container) {
-    for (auto idx = 0; idx < container.size() - 1; ++idx) {
-        if (animationTime < container[idx + 1].timeStamp) {
-            return idx;
-        }
-    }
-    assert(false);
-}
-
 int Bone::getPositionIdx(float animationTime) {
-    return getImpl(animationTime, m_positions);
+    return findKeyIdx(animationTime, m_positions, m_cursor.position);
 }
 
 int Bone::getRotationIdx(float animationTime) {
-    return getImpl(animationTime, m_rotations);
+    return findKeyIdx(animationTime, m_rotations, m_cursor.rotation);
 }
 
 int Bone::getScaleIdx(float animationTime) {
-    return getImpl(animationTime, m_scales);
+    return findKeyIdx(animationTime, m_scales, m_cursor.scale);
+}
+
+const std::vector<KeyPosition> &Bone::getPositionKeys() const {
+    return m_positions;
 }
 
-float Bone::getScaleFactor(float lastTimestamp, float nextTimestamp, float animationTime) {
+const std::vector<KeyRotation> &Bone::getRotationKeys() const {
+    return m_rotations;
+}
+
+const std::vector<KeyScale> &Bone::getScaleKeys() const {
+    return m_scales;
+}
+
+float Bone::getScaleFactor(float lastTimestamp, float nextTimestamp, float animationTime) const {
     const auto midwayLength = animationTime - lastTimestamp;
     const auto framesDiff = nextTimestamp - lastTimestamp;
-    const float scaleFactor = midwayLength / framesDiff;
-    return scaleFactor;
+    // findKeyIdx clamps the key, before the first and after the last key the pose holds
+    return framesDiff > 0.0f ? std::clamp(midwayLength / framesDiff, 0.0f, 1.0f) : 0.0f;
 }
 
-glm::mat4 Bone::interpolatePosition(float animationTime) {
+glm::vec3 Bone::samplePosition(float animationTime, int &cursor) const {
     if (m_positions.size() == 1) {
-        return glm::translate(IDENTITY_MATRIX, m_positions[0].position);
+        return m_positions[0].position;
     }
 
-    const auto p0Idx = getPositionIdx(animationTime);
+    const auto p0Idx = findKeyIdx(animationTime, m_positions, cursor);
     const auto p1Idx = p0Idx + 1;
     const auto scaleFactor = getScaleFactor(m_positions[p0Idx].timeStamp, m_positions[p1Idx].timeStamp, animationTime);
-    const auto finalPosition = glm::mix(m_positions[p0Idx].position, m_positions[p1Idx].position, scaleFactor);
-    return glm::translate(IDENTITY_MATRIX, finalPosition);
+    return glm::mix(m_positions[p0Idx].position, m_positions[p1Idx].position, scaleFactor);
 }
 
-glm::mat4 Bone::interpolateRotation(float animationTime) {
+glm::quat Bone::sampleRotation(float animationTime, int &cursor) const {
     if (m_rotations.size() == 1) {
-        const auto rotation = glm::normalize(m_rotations[0].orientation);
-        return glm::toMat4(rotation);
+        return glm::normalize(m_rotations[0].orientation);
     }
 
-    const auto p0Idx = getRotationIdx(animationTime);
+    const auto p0Idx = findKeyIdx(animationTime, m_rotations, cursor);
     const auto p1Idx = p0Idx + 1;
     const auto scaleFactor = getScaleFactor(m_rotations[p0Idx].timeStamp, m_rotations[p1Idx].timeStamp, animationTime);
-    glm::quat finalRotation = glm::slerp(m_rotations[p0Idx].orientation, m_rotations[p1Idx].orientation, scaleFactor);
-    finalRotation = glm::normalize(finalRotation);
-    return glm::toMat4(finalRotation);
+    const glm::quat finalRotation = glm::slerp(m_rotations[p0Idx].orientation, m_rotations[p1Idx].orientation, scaleFactor);
+    return glm::normalize(finalRotation);
 }
 
-glm::mat4 Bone::interpolateScale(float animationTime) {
+glm::vec3 Bone::sampleScale(float animationTime, int &cursor) const {
     if (m_scales.size() == 1) {
-        return glm::scale(IDENTITY_MATRIX, m_scales[0].scale);
+        return m_scales[0].scale;
     }
 
-    const auto p0Idx = getScaleIdx(animationTime);
+    const auto p0Idx = findKeyIdx(animationTime, m_scales, cursor);
     const auto p1Idx = p0Idx + 1;
     const auto scaleFactor = getScaleFactor(m_scales[p0Idx].timeStamp, m_scales[p1Idx].timeStamp, animationTime);
-    const auto finalScale = glm::mix(m_scales[p0Idx].scale, m_scales[p1Idx].scale, scaleFactor);
-    return glm::scale(IDENTITY_MATRIX, finalScale);
+    return glm::mix(m_scales[p0Idx].scale, m_scales[p1Idx].scale, scaleFactor);
+}
+
+glm::mat4 Bone::interpolatePosition(float animationTime, int &cursor) const {
+    return glm::translate(IDENTITY_MATRIX, samplePosition(animationTime, cursor));
+}
+
+glm::mat4 Bone::interpolateRotation(float animationTime, int &cursor) const {
+    return glm::toMat4(sampleRotation(animationTime, cursor));
+}
+
+glm::mat4 Bone::interpolateScale(float animationTime, int &cursor) const {
+    return glm::scale(IDENTITY_MATRIX, sampleScale(animationTime, cursor));
 }
@@ -0,0 +1,53 @@
+#include "BonePalette.hpp"
+
+#include <algorithm>
+
+#include <glad/glad.h>
+
+#include "Shader.hpp"
+
+BonePalette::BonePalette(int boneCount) : m_boneCount{std::max(boneCount, 1)} {
+    // an empty buffer texture is incomplete, keep at least one matrix
+    const std::vector<glm::mat4> identities(m_boneCount, glm::mat4{1.0f});
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(identities.size() * sizeof(glm::mat4)), identities.data(),
+                 GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+BonePalette::~BonePalette() {
+    glDeleteTextures(1, &m_texture);
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void BonePalette::upload(const std::vector<glm::mat4> &boneMatrices) {
+    const auto bytes = static_cast<GLsizeiptr>(boneMatrices.size() * sizeof(glm::mat4));
+    glBindBuffer(GL_TEXTURE_BUFFER, m_buffer);
+    if (boneMatrices.size() > static_cast<std::size_t>(m_boneCount)) {
+        glBufferData(GL_TEXTURE_BUFFER, bytes, boneMatrices.data(), GL_DYNAMIC_DRAW);
+        m_boneCount = static_cast<int>(boneMatrices.size());
+        // attach the new storage, the texture size is the bone count
+        glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    } else {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, boneMatrices.data());
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void BonePalette::bind(Shader &shader, int textureUnit) const {
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+    shader.setInt("finalBonesMatrices", textureUnit);
+}
+
+int BonePalette::getBoneCount() const {
+    return m_boneCount;
+}
@@ -0,0 +1,457 @@
+#include "CompressedClip.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <glm/gtx/quaternion.hpp>
+
+#include "Animation.hpp"
+
+namespace {
+constexpr char kMagic[8] = {'A', 'N', 'I', 'M', 'C', 'L', 'P', '1'};
+constexpr float kQuantizedMax = 65535.0f;
+// smallest three components of a unit quaternion lie within +-1/sqrt(2)
+constexpr float kSqrt2 = 1.41421356f;
+constexpr float kComponentMax = 32767.0f;
+// far beyond any rig, keeps a corrupt bone id from sizing the bone matrices of an Animator
+constexpr int kMaxBoneId = 65535;
+
+std::uint16_t quantize(float value, float rangeMin, float rangeExtent) {
+    if (rangeExtent <= 0.0f) {
+        return 0;
+    }
+    const float normalized = std::clamp((value - rangeMin) / rangeExtent, 0.0f, 1.0f);
+    return static_cast<std::uint16_t>(std::lround(normalized * kQuantizedMax));
+}
+
+// Writes the three smallest components of `q`, the index of the largest one goes into the top
+// bits of the first two. The largest component is made positive, q and -q are the same rotation.
+void encodeRotation(glm::quat q, std::uint16_t* out) {
+    q = glm::normalize(q);
+    const float components[4] = {q.x, q.y, q.z, q.w};
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (std::abs(components[i]) > std::abs(components[largest])) {
+            largest = i;
+        }
+    }
+    const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+    int k = 0;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest) {
+            continue;
+        }
+        const float normalized = std::clamp(components[i] * sign * kSqrt2 * 0.5f + 0.5f, 0.0f, 1.0f);
+        out[k++] = static_cast<std::uint16_t>(std::lround(normalized * kComponentMax));
+    }
+    out[0] |= static_cast<std::uint16_t>((largest & 1) << 15);
+    out[1] |= static_cast<std::uint16_t>((largest >> 1) << 15);
+}
+
+glm::quat decodeRotation(const std::uint16_t* in) {
+    // slot of x, y, z, w in {smallest three..., largest} for every index of the largest component,
+    // a lookup instead of a branch per component that depends on the key
+    static constexpr int kSlots[4][4] = {{3, 0, 1, 2}, {0, 3, 1, 2}, {0, 1, 3, 2}, {0, 1, 2, 3}};
+    const int largest = (in[0] >> 15) | ((in[1] >> 15) << 1);
+    float values[4];
+    for (int k = 0; k < 3; k++) {
+        values[k] = static_cast<float>(in[k] & 0x7fff) * (kSqrt2 / kComponentMax) - 1.0f / kSqrt2;
+    }
+    values[3] = std::sqrt(std::max(0.0f, 1.0f - values[0] * values[0] - values[1] * values[1] - values[2] * values[2]));
+    const int* slots = kSlots[largest];
+    return glm::quat{values[slots[3]], values[slots[0]], values[slots[1]], values[slots[2]]};
+}
+
+// Normalized linear interpolation along the shorter arc. Keys are dense enough that it stays
+// within the compression tolerance of slerp, at a fraction of the cost.
+glm::quat nlerp(const glm::quat& a, glm::quat b, float factor) {
+    if (glm::dot(a, b) < 0.0f) {
+        b = -b;
+    }
+    return glm::normalize(a * (1.0f - factor) + b * factor);
+}
+
+// Angle of the rotation between a and b. Unlike acos of their dot product it stays accurate for
+// the tiny angles the tolerances are about.
+float rotationError(const glm::quat& a, const glm::quat& b) {
+    const glm::quat difference = glm::conjugate(glm::normalize(a)) * glm::normalize(b);
+    return 2.0f * std::atan2(glm::length(glm::vec3{difference.x, difference.y, difference.z}), std::abs(difference.w));
+}
+
+// Indices of the keys to keep: dropped keys are within `tolerance` of the interpolation of the
+// kept keys around them. Tracks that stay within `tolerance` of their first key keep only that.
+template<typename T, typename Interpolate, typename Error>
+std::vector<int> reduceKeys(const std::vector<float>& times, const std::vector<T>& values, float tolerance,
+                            Interpolate interpolate, Error error) {
+    const int keyCount = static_cast<int>(values.size());
+    const bool constant = std::all_of(values.begin(), values.end(), [&](const T& value) {
+        return error(values[0], value) <= tolerance;
+    });
+    if (constant) {
+        return {0};
+    }
+
+    std::vector<int> kept{0};
+    int start = 0;
+    for (int end = 2; end < keyCount; end++) {
+        // could the segment from `start` reach `end` without the keys in between?
+        for (int key = start + 1; key < end; key++) {
+            const float span = times[end] - times[start];
+            const float factor = span > 0.0f ? (times[key] - times[start]) / span : 0.0f;
+            if (error(interpolate(values[start], values[end], factor), values[key]) > tolerance) {
+                start = end - 1;
+                kept.push_back(start);
+                break;
+            }
+        }
+    }
+    kept.push_back(keyCount - 1);
+    return kept;
+}
+
+// Index of the last key at or before `time`, clamped to [0, keyCount - 2], same cursor scheme as Bone.
+int findKey(const std::uint16_t* times, int keyCount, float time, int& cursor) {
+    const int lastIdx = keyCount - 2;
+    int idx = std::min(cursor, lastIdx);
+    if (time >= times[idx]) {
+        for (int step = 0; step < 4 && idx < lastIdx && time >= times[idx + 1]; step++) {
+            idx++;
+        }
+        if (idx == lastIdx || time < times[idx + 1]) {
+            cursor = idx;
+            return idx;
+        }
+    }
+    const auto next = std::upper_bound(times + 1, times + keyCount - 1, time, [](float t, std::uint16_t key) {
+        return t < key;
+    });
+    cursor = static_cast<int>(next - times) - 1;
+    return cursor;
+}
+
+float keyFactor(const std::uint16_t* times, int key, float time) {
+    const float span = static_cast<float>(times[key + 1]) - times[key];
+    return span > 0.0f ? std::clamp((time - times[key]) / span, 0.0f, 1.0f) : 0.0f;
+}
+
+template<typename T>
+void writeValue(std::ofstream& file, const T& value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+void writeVector(std::ofstream& file, const std::vector<T>& values) {
+    writeValue(file, static_cast<std::uint32_t>(values.size()));
+    file.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+template<typename T>
+void readValue(std::ifstream& file, T& value) {
+    file.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+std::uint64_t bytesLeft(std::ifstream& file, std::uint64_t fileSize) {
+    const auto position = file.tellg();
+    if (position < 0 || static_cast<std::uint64_t>(position) > fileSize) {
+        return 0;
+    }
+    return fileSize - static_cast<std::uint64_t>(position);
+}
+
+// Sizes come from the file, one larger than the bytes left fails the stream instead of allocating.
+template<typename T>
+void readVector(std::ifstream& file, std::uint64_t fileSize, std::vector<T>& values) {
+    std::uint32_t size = 0;
+    readValue(file, size);
+    if (!file) {
+        return;
+    }
+    if (size > bytesLeft(file, fileSize) / sizeof(T)) {
+        file.setstate(std::ios_base::failbit);
+        return;
+    }
+    values.resize(size);
+    file.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(size * sizeof(T)));
+}
+}
+
+CompressedClip CompressedClip::compress(const Animation &animation, const Settings &settings) {
+    CompressedClip clip;
+    clip.m_duration = animation.getDuration();
+    clip.m_ticksPerSecond = animation.getTicksPerSecond();
+    clip.m_skeleton = animation.getSkeleton();
+
+    const auto quantizeTime = [duration = clip.m_duration](float time) {
+        return duration > 0.0f ? quantize(time, 0.0f, duration) : std::uint16_t{0};
+    };
+    const auto lerp = [](const glm::vec3& a, const glm::vec3& b, float factor) { return glm::mix(a, b, factor); };
+    const auto distance = [](const glm::vec3& a, const glm::vec3& b) { return glm::length(a - b); };
+
+    const auto addVectorTrack = [&](const std::vector<float>& times, const std::vector<glm::vec3>& values, float tolerance,
+                                    std::vector<std::uint16_t>& trackTimes, std::vector<std::uint16_t>& trackValues) {
+        const auto kept = reduceKeys(times, values, tolerance, lerp, distance);
+        Track track{static_cast<std::uint32_t>(trackTimes.size()), static_cast<std::uint32_t>(kept.size()),
+                    values[kept[0]], glm::vec3{0.0f}};
+        glm::vec3 rangeMax = track.rangeMin;
+        for (const int key : kept) {
+            track.rangeMin = glm::min(track.rangeMin, values[key]);
+            rangeMax = glm::max(rangeMax, values[key]);
+        }
+        track.rangeExtent = rangeMax - track.rangeMin;
+        for (const int key : kept) {
+            trackTimes.push_back(quantizeTime(times[key]));
+            for (int c = 0; c < 3; c++) {
+                trackValues.push_back(quantize(values[key][c], track.rangeMin[c], track.rangeExtent[c]));
+            }
+        }
+        return track;
+    };
+
+    for (int node = 0; node < clip.m_skeleton.getNodeCount(); node++) {
+        const int boneIdx = clip.m_skeleton.boneIdxs[node];
+        if (boneIdx < 0) {
+            continue;
+        }
+        const Bone& bone = animation.getBone(boneIdx);
+        // the clip's bone indices are its channels
+        clip.m_skeleton.boneIdxs[node] = static_cast<int>(clip.m_channels.size());
+        clip.m_channelNodes.push_back(node);
+
+        Channel channel{};
+        std::vector<float> times;
+        std::vector<glm::vec3> vectors;
+
+        for (const auto& key : bone.getPositionKeys()) {
+            times.push_back(key.timeStamp);
+            vectors.push_back(key.position);
+        }
+        channel.translation = addVectorTrack(times, vectors, settings.translationTolerance,
+                                             clip.m_translationTimes, clip.m_translations);
+
+        times.clear();
+        vectors.clear();
+        for (const auto& key : bone.getScaleKeys()) {
+            times.push_back(key.timeStamp);
+            vectors.push_back(key.scale);
+        }
+        channel.scale = addVectorTrack(times, vectors, settings.scaleTolerance, clip.m_scaleTimes, clip.m_scales);
+
+        times.clear();
+        std::vector<glm::quat> rotations;
+        for (const auto& key : bone.getRotationKeys()) {
+            times.push_back(key.timeStamp);
+            rotations.push_back(glm::normalize(key.orientation));
+        }
+        const auto kept = reduceKeys(times, rotations, settings.rotationTolerance, nlerp, rotationError);
+        channel.rotation = Track{static_cast<std::uint32_t>(clip.m_rotationTimes.size()),
+                                 static_cast<std::uint32_t>(kept.size()), glm::vec3{0.0f}, glm::vec3{0.0f}};
+        for (const int key : kept) {
+            clip.m_rotationTimes.push_back(quantizeTime(times[key]));
+            std::uint16_t encoded[3];
+            encodeRotation(rotations[key], encoded);
+            clip.m_rotations.insert(clip.m_rotations.end(), encoded, encoded + 3);
+        }
+
+        clip.m_channels.push_back(channel);
+    }
+    return clip;
+}
+
+CompressedClip CompressedClip::load(const std::string &path) {
+    CompressedClip clip;
+    std::ifstream file{path, std::ios_base::binary | std::ios_base::ate};
+    const auto fileSize = static_cast<std::uint64_t>(std::max<std::streamoff>(0, file.tellg()));
+    file.seekg(0);
+    char magic[sizeof(kMagic)] = {};
+    file.read(magic, sizeof(magic));
+    if (!file || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        std::cerr << path << ": not an animation clip\n";
+        return {};
+    }
+
+    readValue(file, clip.m_duration);
+    readValue(file, clip.m_ticksPerSecond);
+
+    std::uint32_t nodeCount = 0;
+    readValue(file, nodeCount);
+    for (std::uint32_t node = 0; file && node < nodeCount; node++) {
+        std::string name;
+        std::uint32_t nameLength = 0;
+        readValue(file, nameLength);
+        if (!file || nameLength > bytesLeft(file, fileSize)) {
+            break;
+        }
+        name.resize(nameLength);
+        file.read(name.data(), nameLength);
+        std::int32_t parent = -1;
+        glm::mat4 bindTransform{1.0f};
+        readValue(file, parent);
+        readValue(file, bindTransform);
+        clip.m_skeleton.addNode(std::move(name), parent, bindTransform);
+        readValue(file, clip.m_skeleton.boneIdxs[node]);
+        readValue(file, clip.m_skeleton.boneIds[node]);
+        readValue(file, clip.m_skeleton.offsetMatrices[node]);
+    }
+
+    readVector(file, fileSize, clip.m_channelNodes);
+    readVector(file, fileSize, clip.m_channels);
+    readVector(file, fileSize, clip.m_translationTimes);
+    readVector(file, fileSize, clip.m_translations);
+    readVector(file, fileSize, clip.m_rotationTimes);
+    readVector(file, fileSize, clip.m_rotations);
+    readVector(file, fileSize, clip.m_scaleTimes);
+    readVector(file, fileSize, clip.m_scales);
+    if (!file || static_cast<std::uint32_t>(clip.m_skeleton.getNodeCount()) != nodeCount) {
+        std::cerr << path << ": truncated animation clip\n";
+        return {};
+    }
+    if (!clip.isConsistent()) {
+        std::cerr << path << ": corrupt animation clip\n";
+        return {};
+    }
+    return clip;
+}
+
+bool CompressedClip::save(const std::string &path) const {
+    std::ofstream file{path, std::ios_base::binary | std::ios_base::trunc};
+    file.write(kMagic, sizeof(kMagic));
+    writeValue(file, m_duration);
+    writeValue(file, m_ticksPerSecond);
+
+    writeValue(file, static_cast<std::uint32_t>(m_skeleton.getNodeCount()));
+    for (int node = 0; node < m_skeleton.getNodeCount(); node++) {
+        const auto& name = m_skeleton.names[node];
+        writeValue(file, static_cast<std::uint32_t>(name.size()));
+        file.write(name.data(), static_cast<std::streamsize>(name.size()));
+        writeValue(file, static_cast<std::int32_t>(m_skeleton.parents[node]));
+        writeValue(file, m_skeleton.bindTransforms[node]);
+        writeValue(file, static_cast<std::int32_t>(m_skeleton.boneIdxs[node]));
+        writeValue(file, static_cast<std::int32_t>(m_skeleton.boneIds[node]));
+        writeValue(file, m_skeleton.offsetMatrices[node]);
+    }
+
+    writeVector(file, m_channelNodes);
+    writeVector(file, m_channels);
+    writeVector(file, m_translationTimes);
+    writeVector(file, m_translations);
+    writeVector(file, m_rotationTimes);
+    writeVector(file, m_rotations);
+    writeVector(file, m_scaleTimes);
+    writeVector(file, m_scales);
+    return static_cast<bool>(file.flush());
+}
+
+bool CompressedClip::isConsistent() const {
+    if (!std::isfinite(m_duration) || m_duration < 0.0f || !std::isfinite(m_ticksPerSecond) || m_ticksPerSecond <= 0.0f ||
+        m_channelNodes.size() != m_channels.size()) {
+        return false;
+    }
+
+    const int nodeCount = m_skeleton.getNodeCount();
+    const int channelCount = getChannelCount();
+    for (int node = 0; node < nodeCount; node++) {
+        const int channelIdx = m_skeleton.boneIdxs[node];
+        if (m_skeleton.parents[node] < -1 || m_skeleton.parents[node] >= node ||
+            m_skeleton.boneIds[node] < -1 || m_skeleton.boneIds[node] > kMaxBoneId ||
+            channelIdx < -1 || channelIdx >= channelCount) {
+            return false;
+        }
+    }
+
+    const auto inside = [](const Track& track, const std::vector<std::uint16_t>& times, const std::vector<std::uint16_t>& values) {
+        return track.keyCount > 0 && track.firstKey <= times.size() && track.keyCount <= times.size() - track.firstKey &&
+               values.size() == times.size() * 3;
+    };
+    for (int channelIdx = 0; channelIdx < channelCount; channelIdx++) {
+        const int node = m_channelNodes[channelIdx];
+        const Channel& channel = m_channels[channelIdx];
+        if (node < 0 || node >= nodeCount || m_skeleton.boneIdxs[node] != channelIdx ||
+            !inside(channel.translation, m_translationTimes, m_translations) ||
+            !inside(channel.rotation, m_rotationTimes, m_rotations) ||
+            !inside(channel.scale, m_scaleTimes, m_scales)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CompressedClip::isEmpty() const {
+    return m_skeleton.getNodeCount() == 0;
+}
+
+float CompressedClip::getTicksPerSecond() const {
+    return m_ticksPerSecond;
+}
+
+float CompressedClip::getDuration() const {
+    return m_duration;
+}
+
+const Skeleton &CompressedClip::getSkeleton() const {
+    return m_skeleton;
+}
+
+int CompressedClip::getChannelCount() const {
+    return static_cast<int>(m_channels.size());
+}
+
+std::size_t CompressedClip::getKeyMemoryUsage() const {
+    const std::size_t keys = m_translationTimes.size() + m_translations.size() + m_rotationTimes.size() +
+                             m_rotations.size() + m_scaleTimes.size() + m_scales.size();
+    return keys * sizeof(std::uint16_t) + m_channels.size() * sizeof(Channel) +
+           m_channelNodes.size() * sizeof(std::int32_t);
+}
+
+void CompressedClip::sampleLocalTransforms(float animationTime, Bone::KeyCursor *cursors, glm::mat4 *localTransforms) const {
+    const float quantizedTime = m_duration > 0.0f ? animationTime / m_duration * kQuantizedMax : 0.0f;
+
+    for (int node = 0; node < m_skeleton.getNodeCount(); node++) {
+        const int channelIdx = m_skeleton.boneIdxs[node];
+        if (channelIdx < 0) {
+            localTransforms[node] = m_skeleton.bindTransforms[node];
+            continue;
+        }
+        const Channel& channel = m_channels[channelIdx];
+        auto& cursor = cursors[channelIdx];
+
+        const glm::vec3 translation = sampleVector(channel.translation, m_translationTimes, m_translations, quantizedTime, cursor.position);
+        const glm::quat rotation = sampleRotation(channel.rotation, quantizedTime, cursor.rotation);
+        const glm::vec3 scale = sampleVector(channel.scale, m_scaleTimes, m_scales, quantizedTime, cursor.scale);
+
+        // translation * rotation * scale, like Bone::update
+        glm::mat4 transform = glm::toMat4(rotation);
+        transform[0] *= scale.x;
+        transform[1] *= scale.y;
+        transform[2] *= scale.z;
+        transform[3] = glm::vec4{translation, 1.0f};
+        localTransforms[node] = transform;
+    }
+}
+
+glm::vec3 CompressedClip::sampleVector(const Track &track, const std::vector<std::uint16_t> &times,
+                                       const std::vector<std::uint16_t> &values, float quantizedTime, int &cursor) {
+    const auto decode = [&](std::uint32_t key) {
+        const std::uint16_t* quantized = values.data() + static_cast<std::size_t>(track.firstKey + key) * 3;
+        return track.rangeMin + track.rangeExtent * (glm::vec3(quantized[0], quantized[1], quantized[2]) * (1.0f / kQuantizedMax));
+    };
+    if (track.keyCount == 1) {
+        return decode(0);
+    }
+    const std::uint16_t* trackTimes = times.data() + track.firstKey;
+    const int key = findKey(trackTimes, static_cast<int>(track.keyCount), quantizedTime, cursor);
+    return glm::mix(decode(key), decode(key + 1), keyFactor(trackTimes, key, quantizedTime));
+}
+
+glm::quat CompressedClip::sampleRotation(const Track &track, float quantizedTime, int &cursor) const {
+    const std::uint16_t* encoded = m_rotations.data() + static_cast<std::size_t>(track.firstKey) * 3;
+    if (track.keyCount == 1) {
+        return decodeRotation(encoded);
+    }
+    const std::uint16_t* trackTimes = m_rotationTimes.data() + track.firstKey;
+    const int key = findKey(trackTimes, static_cast<int>(track.keyCount), quantizedTime, cursor);
+    return nlerp(decodeRotation(encoded + key * 3), decodeRotation(encoded + (key + 1) * 3),
+                 keyFactor(trackTimes, key, quantizedTime));
+}
@@ -0,0 +1,182 @@
+#include "CpuSkinner.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GRAPHICS_HAS_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define GRAPHICS_HAS_X86_SIMD 0
+#endif
+
+#include "JobPool.hpp"
+#include "Model.hpp"
+
+namespace {
+// vertices per job, a few thousand keep the job overhead negligible and still balance a model
+// with one large and several small meshes
+constexpr int kVerticesPerJob = 4096;
+
+// True if the vertex refers to a bone past the matrices or to no bone at all.
+bool keepsBindPose(const Mesh::Vertex& vertex, int boneCount) {
+    bool hasBone = false;
+    for (int i = 0; i < MAX_BONE_INFLUENCE; i++) {
+        if (vertex.boneIds[i] >= boneCount) {
+            return true;
+        }
+        hasBone = hasBone || vertex.boneIds[i] >= 0;
+    }
+    return !hasBone;
+}
+
+void skinScalar(const Mesh::Vertex* vertices, int begin, int end, const glm::mat4* boneMatrices, int boneCount,
+                glm::vec3* positions, glm::vec3* normals) {
+    for (int idx = begin; idx < end; idx++) {
+        const auto& vertex = vertices[idx];
+        if (keepsBindPose(vertex, boneCount)) {
+            positions[idx] = vertex.position;
+            normals[idx] = vertex.normal;
+            continue;
+        }
+
+        glm::mat4 blended{0.0f};
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++) {
+            if (vertex.boneIds[i] >= 0) {
+                blended += boneMatrices[vertex.boneIds[i]] * vertex.boneWeights[i];
+            }
+        }
+        positions[idx] = glm::vec3{blended * glm::vec4{vertex.position, 1.0f}};
+        const glm::vec3 normal = glm::mat3{blended} * vertex.normal;
+        const float length = glm::length(normal);
+        normals[idx] = length > 0.0f ? normal / length : normal;
+    }
+}
+
+#if GRAPHICS_HAS_X86_SIMD
+// Columns 0-1 and 2-3 of the blended matrix are one register each, a vertex is transformed by
+// multiplying them with (x, y) and (z, 1) broadcast per column and adding the two halves.
+__attribute__((target("avx2,fma")))
+void skinAvx2(const Mesh::Vertex* vertices, int begin, int end, const glm::mat4* boneMatrices, int boneCount,
+              glm::vec3* positions, glm::vec3* normals) {
+    alignas(16) float lanes[4];
+    for (int idx = begin; idx < end; idx++) {
+        const auto& vertex = vertices[idx];
+        if (keepsBindPose(vertex, boneCount)) {
+            positions[idx] = vertex.position;
+            normals[idx] = vertex.normal;
+            continue;
+        }
+
+        __m256 columns01 = _mm256_setzero_ps();
+        __m256 columns23 = _mm256_setzero_ps();
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++) {
+            if (vertex.boneIds[i] < 0) {
+                continue;
+            }
+            const float* matrix = &boneMatrices[vertex.boneIds[i]][0][0];
+            const __m256 weight = _mm256_set1_ps(vertex.boneWeights[i]);
+            columns01 = _mm256_fmadd_ps(_mm256_loadu_ps(matrix), weight, columns01);
+            columns23 = _mm256_fmadd_ps(_mm256_loadu_ps(matrix + 8), weight, columns23);
+        }
+
+        const glm::vec3& p = vertex.position;
+        const __m256 pxy = _mm256_set_m128(_mm_set1_ps(p.y), _mm_set1_ps(p.x));
+        const __m256 pz1 = _mm256_set_m128(_mm_set1_ps(1.0f), _mm_set1_ps(p.z));
+        const __m256 position = _mm256_fmadd_ps(columns23, pz1, _mm256_mul_ps(columns01, pxy));
+        _mm_store_ps(lanes, _mm_add_ps(_mm256_castps256_ps128(position), _mm256_extractf128_ps(position, 1)));
+        positions[idx] = glm::vec3{lanes[0], lanes[1], lanes[2]};
+
+        const glm::vec3& n = vertex.normal;
+        const __m256 nxy = _mm256_set_m128(_mm_set1_ps(n.y), _mm_set1_ps(n.x));
+        const __m256 nz0 = _mm256_set_m128(_mm_setzero_ps(), _mm_set1_ps(n.z));
+        const __m256 normal8 = _mm256_fmadd_ps(columns23, nz0, _mm256_mul_ps(columns01, nxy));
+        __m128 normal = _mm_add_ps(_mm256_castps256_ps128(normal8), _mm256_extractf128_ps(normal8, 1));
+        // the w lane is 0 for affine bone matrices, but it mustn't count into the length
+        const __m128 length = _mm_sqrt_ps(_mm_dp_ps(normal, normal, 0x7F));
+        normal = _mm_blendv_ps(normal, _mm_div_ps(normal, length), _mm_cmpgt_ps(length, _mm_setzero_ps()));
+        _mm_store_ps(lanes, normal);
+        normals[idx] = glm::vec3{lanes[0], lanes[1], lanes[2]};
+    }
+}
+#endif
+}
+
+CpuSkinner::Kernel CpuSkinner::detectKernel() {
+#if GRAPHICS_HAS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return Kernel::Avx2;
+    }
+#endif
+    return Kernel::Scalar;
+}
+
+const char *CpuSkinner::getKernelName(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Avx2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+CpuSkinner::CpuSkinner(Kernel kernel) : m_kernel{kernel} {
+#if !GRAPHICS_HAS_X86_SIMD
+    m_kernel = Kernel::Scalar;
+#endif
+}
+
+CpuSkinner::Kernel CpuSkinner::getKernel() const {
+    return m_kernel;
+}
+
+void CpuSkinner::skin(const Mesh &mesh, const std::vector<glm::mat4> &finalBoneMatrices, SkinnedMesh &out) const {
+    const auto& vertices = mesh.getVertices();
+    out.positions.resize(vertices.size());
+    out.normals.resize(vertices.size());
+    skinRange(vertices.data(), 0, static_cast<int>(vertices.size()), finalBoneMatrices, out.positions.data(),
+              out.normals.data());
+}
+
+void CpuSkinner::skin(const Model &model, const std::vector<glm::mat4> &finalBoneMatrices, JobPool &pool,
+                      std::vector<SkinnedMesh> &out) const {
+    struct Job {
+        int mesh;
+        int begin;
+        int end;
+    };
+
+    const auto& meshes = model.getMeshes();
+    out.resize(meshes.size());
+    std::vector<Job> jobs;
+    for (int mesh = 0; mesh < static_cast<int>(meshes.size()); mesh++) {
+        const int vertexCount = static_cast<int>(meshes[mesh].getVertices().size());
+        out[mesh].positions.resize(vertexCount);
+        out[mesh].normals.resize(vertexCount);
+        for (int begin = 0; begin < vertexCount; begin += kVerticesPerJob) {
+            jobs.push_back({mesh, begin, std::min(begin + kVerticesPerJob, vertexCount)});
+        }
+    }
+
+    pool.parallelFor(static_cast<int>(jobs.size()), 1, [&](int begin, int end) {
+        for (int idx = begin; idx < end; idx++) {
+            const auto& job = jobs[idx];
+            skinRange(meshes[job.mesh].getVertices().data(), job.begin, job.end, finalBoneMatrices,
+                      out[job.mesh].positions.data(), out[job.mesh].normals.data());
+        }
+    });
+}
+
+void CpuSkinner::skinRange(const Mesh::Vertex *vertices, int begin, int end,
+                           const std::vector<glm::mat4> &finalBoneMatrices, glm::vec3 *positions,
+                           glm::vec3 *normals) const {
+    const int boneCount = static_cast<int>(finalBoneMatrices.size());
+#if GRAPHICS_HAS_X86_SIMD
+    if (m_kernel == Kernel::Avx2) {
+        skinAvx2(vertices, begin, end, finalBoneMatrices.data(), boneCount, positions, normals);
+        return;
+    }
+#endif
+    skinScalar(vertices, begin, end, finalBoneMatrices.data(), boneCount, positions, normals);
+}
@@ -0,0 +1,286 @@
+#include "CrowdAnimator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "Animation.hpp"
+#include "Camera.hpp"
+#include "JobPool.hpp"
+
+namespace {
+// characters per job, large enough that handing out a job costs nothing next to animating it
+constexpr int kCharactersPerJob = 16;
+
+// Frustum planes (xyz normal pointing inwards, w distance) of a view projection matrix, after
+// Gribb and Hartmann. The normals aren't normalized, the sphere test scales the radius instead.
+void extractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4* planes) {
+    const glm::vec4 row0{viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]};
+    const glm::vec4 row1{viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]};
+    const glm::vec4 row2{viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]};
+    const glm::vec4 row3{viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]};
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row3 + row2;
+    planes[5] = row3 - row2;
+}
+
+bool isSphereVisible(const glm::vec4* planes, const glm::vec3& center, float radius) {
+    for (int i = 0; i < 6; i++) {
+        const glm::vec3 normal{planes[i]};
+        if (glm::dot(normal, center) + planes[i].w < -radius * glm::length(normal)) {
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+CrowdAnimator::CrowdAnimator(Animation *animation)
+    : m_animation{animation},
+      m_lodSettings{{{10.0f, 1, -1}, {30.0f, 2, -1}, {60.0f, 4, -1}, {std::numeric_limits<float>::max(), 8, -1}},
+                    16, -1, 0.0f} {
+    const auto& skeleton = m_animation->getSkeleton();
+    m_boneCount = skeleton.getBoneCount();
+
+    m_nodeDepths.resize(skeleton.getNodeCount());
+    for (int node = 0; node < skeleton.getNodeCount(); node++) {
+        const int parent = skeleton.parents[node];
+        m_nodeDepths[node] = parent < 0 ? 0 : m_nodeDepths[parent] + 1;
+    }
+}
+
+int CrowdAnimator::addCharacter(float startTime, float speed) {
+    const float time = std::fmod(startTime * m_animation->getTicksPerSecond(), m_animation->getDuration());
+    m_characters.push_back({time, speed});
+    m_cursors.resize(m_characters.size() * m_animation->getBoneChannelCount());
+    m_finalBoneMatrices.resize(m_characters.size() * m_boneCount, glm::mat4{1.0f});
+    return getCharacterCount() - 1;
+}
+
+int CrowdAnimator::getCharacterCount() const {
+    return static_cast<int>(m_characters.size());
+}
+
+int CrowdAnimator::getBoneCount() const {
+    return m_boneCount;
+}
+
+void CrowdAnimator::setCharacterBounds(int character, const glm::vec3 &center, float radius) {
+    m_characters[character].center = center;
+    m_characters[character].radius = radius;
+}
+
+void CrowdAnimator::setLodSettings(const LodSettings &settings) {
+    m_lodSettings = settings;
+}
+
+const CrowdAnimator::LodSettings &CrowdAnimator::getLodSettings() const {
+    return m_lodSettings;
+}
+
+void CrowdAnimator::updateAnimation(float dt, JobPool &pool) {
+    const float ticks = m_animation->getTicksPerSecond() * dt;
+    const float duration = m_animation->getDuration();
+    for (auto& character : m_characters) {
+        character.time = std::fmod(character.time + ticks * character.speed, duration);
+    }
+
+    pool.parallelFor(getCharacterCount(), kCharactersPerJob, [this](int begin, int end) {
+        for (int character = begin; character < end; character++) {
+            animateCharacter(character, m_characters[character].time, -1,
+                             m_finalBoneMatrices.data() + static_cast<size_t>(character) * m_boneCount);
+        }
+    });
+    // the poses a later LOD update blends from are stale now
+    for (auto& character : m_characters) {
+        character.evaluated = false;
+    }
+}
+
+void CrowdAnimator::updateAnimation(float dt, const Camera &camera, const glm::mat4 &projection, JobPool &pool) {
+    if (m_previousBoneMatrices.size() != m_finalBoneMatrices.size()) {
+        m_previousBoneMatrices.resize(m_finalBoneMatrices.size(), glm::mat4{1.0f});
+        m_nextBoneMatrices.resize(m_finalBoneMatrices.size(), glm::mat4{1.0f});
+    }
+
+    const auto frameStart = std::chrono::steady_clock::now();
+    glm::vec4 frustumPlanes[6];
+    extractFrustumPlanes(projection * camera.getViewMatrix(), frustumPlanes);
+    const glm::vec3 eye = camera.getPosition();
+    const auto& levels = m_lodSettings.levels;
+    const float ticks = m_animation->getTicksPerSecond() * dt;
+    const float duration = m_animation->getDuration();
+
+    m_lodStats = LodStats{};
+    m_dueCharacters.clear();
+    for (int idx = 0; idx < getCharacterCount(); idx++) {
+        auto& character = m_characters[idx];
+        character.time = std::fmod(character.time + ticks * character.speed, duration);
+        character.ticksSinceEvaluation += ticks * character.speed;
+        character.framesSinceEvaluation++;
+
+        if (!isSphereVisible(frustumPlanes, character.center, character.radius)) {
+            character.updateInterval = m_lodSettings.offscreenUpdateInterval;
+            character.maxNodeDepth = m_lodSettings.offscreenMaxNodeDepth;
+            m_lodStats.offscreen++;
+        } else if (!levels.empty()) {
+            const float distance = std::max(0.0f, glm::length(character.center - eye) - character.radius);
+            const auto level = std::find_if(levels.begin(), levels.end() - 1,
+                                            [distance](const LodLevel& l) { return distance <= l.maxDistance; });
+            character.updateInterval = level->updateInterval;
+            character.maxNodeDepth = level->maxNodeDepth;
+        } else {
+            character.updateInterval = 1;
+            character.maxNodeDepth = -1;
+        }
+        character.updateInterval = std::max(1, character.updateInterval);
+
+        if (!character.evaluated || character.framesSinceEvaluation >= character.updateInterval) {
+            m_dueCharacters.push_back(idx);
+        }
+    }
+
+    // without a measurement yet everything due is evaluated, that gives the first one
+    if (m_lodSettings.frameBudgetMs > 0.0f && m_evaluationMs > 0.0) {
+        // evaluations get what is left after this frame's work so far and the interpolation
+        // after them, assumed to take as long as in the last frames
+        const double elapsedMs =
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+        const double evaluationBudgetMs = m_lodSettings.frameBudgetMs - elapsedMs - m_interpolationMs;
+        const auto maxEvaluations = static_cast<std::size_t>(std::max(1.0, evaluationBudgetMs / m_evaluationMs));
+        if (m_dueCharacters.size() > maxEvaluations) {
+            // characters never evaluated first, then the most overdue relative to their interval
+            const auto priority = [this](int idx) {
+                const auto& character = m_characters[idx];
+                return character.evaluated
+                        ? static_cast<float>(character.framesSinceEvaluation) / character.updateInterval
+                        : std::numeric_limits<float>::max();
+            };
+            std::partial_sort(m_dueCharacters.begin(), m_dueCharacters.begin() + maxEvaluations, m_dueCharacters.end(),
+                              [&priority](int a, int b) { return priority(a) > priority(b); });
+            m_lodStats.deferred = static_cast<int>(m_dueCharacters.size() - maxEvaluations);
+            m_dueCharacters.resize(maxEvaluations);
+        }
+    }
+    m_lodStats.evaluated = static_cast<int>(m_dueCharacters.size());
+
+    const auto start = std::chrono::steady_clock::now();
+    pool.parallelFor(static_cast<int>(m_dueCharacters.size()), kCharactersPerJob, [this, ticks](int begin, int end) {
+        for (int due = begin; due < end; due++) {
+            const int idx = m_dueCharacters[due];
+            const auto& character = m_characters[idx];
+            evaluateCharacter(idx, character.updateInterval > 1 ? ticks * character.speed * character.updateInterval : 0.0f);
+        }
+    });
+    if (!m_dueCharacters.empty()) {
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() /
+                          m_dueCharacters.size();
+        // follow cost changes within a few frames without jumping on a single slow one
+        m_evaluationMs = m_evaluationMs > 0.0 ? 0.75 * m_evaluationMs + 0.25 * ms : ms;
+    }
+
+    const auto interpolationStart = std::chrono::steady_clock::now();
+    std::atomic<int> interpolated{0};
+    pool.parallelFor(getCharacterCount(), kCharactersPerJob * 4, [this, &interpolated](int begin, int end) {
+        int count = 0;
+        for (int character = begin; character < end; character++) {
+            if (m_characters[character].evaluated && !m_characters[character].poseHeld) {
+                interpolateCharacter(character);
+                count++;
+            }
+        }
+        interpolated += count;
+    });
+    m_lodStats.interpolated = interpolated;
+    const double interpolationMs =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - interpolationStart).count();
+    m_interpolationMs = 0.75 * m_interpolationMs + 0.25 * interpolationMs;
+}
+
+const CrowdAnimator::LodStats &CrowdAnimator::getLodStats() const {
+    return m_lodStats;
+}
+
+const std::vector<glm::mat4> &CrowdAnimator::getFinalBoneMatrices() const {
+    return m_finalBoneMatrices;
+}
+
+void CrowdAnimator::animateCharacter(int character, float time, int maxNodeDepth, glm::mat4 *finalBoneMatrices) {
+    const auto& skeleton = m_animation->getSkeleton();
+    const int nodeCount = skeleton.getNodeCount();
+
+    // per thread scratch, only grows on the first frames
+    thread_local std::vector<glm::mat4> localTransforms;
+    thread_local std::vector<glm::mat4> globalTransforms;
+    localTransforms.resize(nodeCount);
+    globalTransforms.resize(nodeCount);
+
+    Bone::KeyCursor* cursors = m_cursors.data() + static_cast<size_t>(character) * m_animation->getBoneChannelCount();
+    for (int node = 0; node < nodeCount; node++) {
+        const int boneIdx = maxNodeDepth < 0 || m_nodeDepths[node] <= maxNodeDepth ? skeleton.boneIdxs[node] : -1;
+        localTransforms[node] = boneIdx >= 0
+                ? m_animation->getBone(boneIdx).sampleLocalTransform(time, cursors[boneIdx])
+                : skeleton.bindTransforms[node];
+    }
+
+    skeleton.computeBoneMatrices(localTransforms.data(), globalTransforms.data(), finalBoneMatrices);
+}
+
+void CrowdAnimator::evaluateCharacter(int idx, float aheadTicks) {
+    auto& character = m_characters[idx];
+    const auto offset = static_cast<size_t>(idx) * m_boneCount;
+    glm::mat4* previous = m_previousBoneMatrices.data() + offset;
+    glm::mat4* next = m_nextBoneMatrices.data() + offset;
+    glm::mat4* finalMatrices = m_finalBoneMatrices.data() + offset;
+    const float time = std::fmod(character.time + aheadTicks, m_animation->getDuration());
+
+    if (aheadTicks <= 0.0f) {
+        // nothing to blend towards, the pose is shown as it is
+        animateCharacter(idx, time, character.maxNodeDepth, finalMatrices);
+        character.poseHeld = true;
+    } else {
+        // blend from where the character is now: the pose it was heading to once it got there,
+        // the interpolated one if its level changed on the way
+        if (character.evaluated) {
+            const bool reachedNext = character.ticksSinceEvaluation >= character.ticksBetweenPoses;
+            const glm::mat4* current = reachedNext && !character.poseHeld ? next : finalMatrices;
+            std::copy(current, current + m_boneCount, previous);
+        }
+
+        animateCharacter(idx, time, character.maxNodeDepth, next);
+        if (!character.evaluated) {
+            std::copy(next, next + m_boneCount, previous);
+        }
+        character.poseHeld = false;
+    }
+
+    character.evaluated = true;
+    character.framesSinceEvaluation = 0;
+    character.ticksSinceEvaluation = 0.0f;
+    character.ticksBetweenPoses = aheadTicks;
+}
+
+void CrowdAnimator::interpolateCharacter(int idx) {
+    auto& character = m_characters[idx];
+    const float factor = character.ticksBetweenPoses > 0.0f
+            ? std::min(character.ticksSinceEvaluation / character.ticksBetweenPoses, 1.0f)
+            : 1.0f;
+    const auto offset = static_cast<size_t>(idx) * m_boneCount;
+    const glm::mat4* previous = m_previousBoneMatrices.data() + offset;
+    const glm::mat4* next = m_nextBoneMatrices.data() + offset;
+    glm::mat4* finalMatrices = m_finalBoneMatrices.data() + offset;
+    // a component wise blend of the skinning matrices, the slight shrinking in between two
+    // poses a few frames apart doesn't show at the distances this is used for
+    for (int bone = 0; bone < m_boneCount; bone++) {
+        for (int col = 0; col < 4; col++) {
+            finalMatrices[bone][col] = previous[bone][col] + (next[bone][col] - previous[bone][col]) * factor;
+        }
+    }
+    // arrived at the next pose, it stays until the next evaluation
+    character.poseHeld = factor >= 1.0f;
+}
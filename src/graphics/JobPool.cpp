@@ -0,0 +1,88 @@
+#include "JobPool.hpp"
+
+#include <algorithm>
+
+JobPool::JobPool(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 1; i < threadCount; i++) {
+        m_threads.emplace_back([this] { workerLoop(); });
+    }
+}
+
+JobPool::~JobPool() {
+    {
+        std::lock_guard lock{m_mutex};
+        m_stop = true;
+    }
+    m_jobReady.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+unsigned JobPool::getThreadCount() const {
+    return static_cast<unsigned>(m_threads.size()) + 1;
+}
+
+void JobPool::parallelFor(int count, int grainSize, const std::function<void(int begin, int end)>& job) {
+    if (count <= 0) {
+        return;
+    }
+    {
+        std::lock_guard lock{m_mutex};
+        m_job = &job;
+        m_count = count;
+        m_grainSize = std::max(1, grainSize);
+        m_nextBegin = 0;
+        m_busyWorkers = static_cast<unsigned>(m_threads.size());
+        m_generation++;
+    }
+    m_jobReady.notify_all();
+
+    runRanges();
+
+    std::unique_lock lock{m_mutex};
+    m_jobDone.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_job = nullptr;
+}
+
+void JobPool::workerLoop() {
+    std::uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock lock{m_mutex};
+            m_jobReady.wait(lock, [&] { return m_stop || m_generation != seenGeneration; });
+            if (m_stop) {
+                return;
+            }
+            seenGeneration = m_generation;
+        }
+
+        runRanges();
+
+        std::lock_guard lock{m_mutex};
+        if (--m_busyWorkers == 0) {
+            m_jobDone.notify_one();
+        }
+    }
+}
+
+void JobPool::runRanges() {
+    while (true) {
+        int begin;
+        int end;
+        {
+            // ranges are coarse, a lock per range costs nothing next to the work in it
+            std::lock_guard lock{m_mutex};
+            if (m_nextBegin >= m_count) {
+                return;
+            }
+            begin = m_nextBegin;
+            end = std::min(m_count, begin + m_grainSize);
+            m_nextBegin = end;
+        }
+        (*m_job)(begin, end);
+    }
+}
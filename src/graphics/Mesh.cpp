@@ -3,10 +3,13 @@
 
 #include <glad/glad.h>
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures,
+           bool createGpuResources)
     : m_vertices{std::move(vertices)}, m_indices{std::move(indices)}, m_textures{std::move(textures)}
 {
-    setupMesh();
+    if (createGpuResources) {
+        setupMesh();
+    }
 }
 
 void Mesh::draw(Shader &shader) {
@@ -54,6 +57,37 @@ void Mesh::setInstancedModelMatrices(const std::vector<glm::mat4>& modelMatrices
     glBindVertexArray(0);
 }
 
+void Mesh::setInstancedAnimations(const std::vector<AnimatedInstance>& instances) {
+    m_instanceCount = instances.size();
+
+    glBindVertexArray(m_VAO);
+
+    // a mat4 attribute takes 4 locations, one per column
+    constexpr std::size_t vec4Size = sizeof(glm::vec4);
+    for (int column = 0; column < 4; column++) {
+        glEnableVertexAttribArray(5 + column);
+        glVertexAttribPointer(5 + column, 4, GL_FLOAT, GL_FALSE, sizeof(AnimatedInstance),
+                              (void*)(offsetof(AnimatedInstance, modelMatrix) + column * vec4Size));
+        glVertexAttribDivisor(5 + column, 1);
+    }
+    glEnableVertexAttribArray(9);
+    glVertexAttribIPointer(9, 1, GL_INT, sizeof(AnimatedInstance), (void*)offsetof(AnimatedInstance, clip));
+    glVertexAttribDivisor(9, 1);
+    glEnableVertexAttribArray(10);
+    glVertexAttribPointer(10, 1, GL_FLOAT, GL_FALSE, sizeof(AnimatedInstance), (void*)offsetof(AnimatedInstance, timeOffset));
+    glVertexAttribDivisor(10, 1);
+
+    glBindVertexArray(0);
+}
+
+const std::vector<Mesh::Vertex> &Mesh::getVertices() const {
+    return m_vertices;
+}
+
+const std::vector<unsigned int> &Mesh::getIndices() const {
+    return m_indices;
+}
+
 void Mesh::setupMesh() {
     glGenVertexArrays(1, &m_VAO);
     glGenBuffers(1, &m_VBO);
@@ -1,5 +1,6 @@
 #include "Model.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <utility>
@@ -12,6 +13,50 @@
 #include <utils/Utils.hpp>
 #include <utils/ScopedTimer.hpp>
 
+namespace {
+constexpr unsigned int kImportFlags = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals;
+
+void extractIndices(const aiMesh *mesh, std::vector<unsigned int> &indices) {
+    indices.reserve(indices.size() + mesh->mNumFaces * 3);
+    for (auto idx = 0; idx < mesh->mNumFaces; idx++) {
+        const aiFace& face = mesh->mFaces[idx];
+        for (auto j = 0; j < face.mNumIndices; j++) {
+            indices.emplace_back(face.mIndices[j]);
+        }
+    }
+}
+
+// aiProcess_Triangulate leaves point and line faces untouched, a mesh may mix them with triangles
+void extractTriangles(const aiMesh *mesh, std::vector<unsigned int> &indices) {
+    indices.reserve(indices.size() + mesh->mNumFaces * 3);
+    for (unsigned int idx = 0; idx < mesh->mNumFaces; idx++) {
+        const aiFace& face = mesh->mFaces[idx];
+        if (face.mNumIndices != 3)
+            continue;
+        indices.insert(indices.end(), face.mIndices, face.mIndices + 3);
+    }
+}
+
+// same traversal order as Model::Impl::processNode
+void collectGeometry(const aiNode *node, const aiScene *scene, std::vector<Model::MeshGeometry> &meshes) {
+    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+        const aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
+        Model::MeshGeometry geometry;
+        geometry.positions.reserve(mesh->mNumVertices);
+        geometry.normals.reserve(mesh->mNumVertices);
+        for (unsigned int v = 0; v < mesh->mNumVertices; v++) {
+            geometry.positions.emplace_back(mesh->mVertices[v].x, mesh->mVertices[v].y, mesh->mVertices[v].z);
+            geometry.normals.emplace_back(mesh->mNormals[v].x, mesh->mNormals[v].y, mesh->mNormals[v].z);
+        }
+        extractTriangles(mesh, geometry.indices);
+        meshes.push_back(std::move(geometry));
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        collectGeometry(node->mChildren[i], scene, meshes);
+    }
+}
+}
+
 struct Model::Impl {
     // model data
     std::vector<Mesh> m_meshes;
@@ -19,6 +64,10 @@ struct Model::Impl {
     std::vector<Mesh::Texture> m_loadedTextures;
     std::unordered_map<std::string, BoneInfo> m_boneInfoMap;
     int m_boneCounter{0};
+    LoadOptions m_options{};
+    BoneWeightPruning m_boneWeightPruning{};
+    // per instance data of setInstancedAnimations, reused by later calls
+    unsigned int m_animatedInstanceBuffer{0};
 
     void loadModel(std::string path);
     void processNode(aiNode *node, const aiScene *scene);
@@ -27,14 +76,22 @@ struct Model::Impl {
                                                     std::string typeName);
 
     void setVertexBoneDataToDefault(Mesh::Vertex& vertex);
-    void setVertexBoneData(Mesh::Vertex& vertex, int boneId, float weight);
+    // Returns the weight that didn't make it into the vertex, 0 if it had room.
+    float setVertexBoneData(Mesh::Vertex& vertex, int boneId, float weight);
     void extractBoneWeightForVertices(std::vector<Mesh::Vertex> &vertices, aiMesh *mesh);
 };
 
-Model::Model(const char *path) : m_impl{std::make_unique<Impl>()} {
+Model::Model(const char *path) : Model(path, LoadOptions{}) {}
+
+Model::Model(const char *path, LoadOptions options) : m_impl{std::make_unique<Impl>()} {
+    m_impl->m_options = options;
     m_impl->loadModel(path);
 }
 
+Model::Model(std::vector<Mesh> meshes) : m_impl{std::make_unique<Impl>()} {
+    m_impl->m_meshes = std::move(meshes);
+}
+
 void Model::draw(Shader &shader) {
     for (auto idx = 0; idx < m_impl->m_meshes.size(); idx++) {
         m_impl->m_meshes[idx].draw(shader);
@@ -60,10 +117,24 @@ void Model::setInstancedModelMatrices(const std::vector<glm::mat4>& modelMatrice
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+void Model::setInstancedAnimations(const std::vector<Mesh::AnimatedInstance>& instances) {
+    if (m_impl->m_animatedInstanceBuffer == 0) {
+        glGenBuffers(1, &m_impl->m_animatedInstanceBuffer);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_impl->m_animatedInstanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Mesh::AnimatedInstance), instances.data(), GL_STATIC_DRAW);
+
+    for (auto& mesh : m_impl->m_meshes) {
+        mesh.setInstancedAnimations(instances);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 void Model::Impl::loadModel(std::string path) {
     ScopedTimer timer{std::string{"loadModel - "} + path};
     Assimp::Importer import;
-    const aiScene *scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals);
+    const aiScene *scene = import.ReadFile(path, kImportFlags);
 
     if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
     {
@@ -75,6 +146,12 @@ void Model::Impl::loadModel(std::string path) {
     std::cout << "Root node meshes: " << scene->mRootNode->mNumMeshes << " children: " << scene->mRootNode->mNumChildren << std::endl;
 
     processNode(scene->mRootNode, scene);
+
+    if (m_boneWeightPruning.prunedVertexCount > 0) {
+        std::cout << "pruned bone weights of " << m_boneWeightPruning.prunedVertexCount << " vertices to "
+                  << MAX_BONE_INFLUENCE << " influences, dropped weight max: " << m_boneWeightPruning.maxDroppedWeight
+                  << " mean: " << m_boneWeightPruning.meanDroppedWeight << "\n";
+    }
 }
 
 void Model::Impl::processNode(aiNode *node, const aiScene *scene) {
@@ -117,15 +194,10 @@ Mesh Model::Impl::processMesh(aiMesh *mesh, const aiScene *scene) {
     }
 
     // process indices
-    for (auto idx = 0; idx < mesh->mNumFaces; idx++) {
-        const aiFace& face = mesh->mFaces[idx];
-        for (auto j = 0; j < face.mNumIndices; j++) {
-            indices.emplace_back(face.mIndices[j]);
-        }
-    }
+    extractIndices(mesh, indices);
 
     // process material
-    if(mesh->mMaterialIndex >= 0)
+    if(m_options.createGpuResources && mesh->mMaterialIndex >= 0)
     {
         aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
         std::vector<Mesh::Texture> diffuseMaps = loadMaterialTextures(material,
@@ -138,7 +210,7 @@ Mesh Model::Impl::processMesh(aiMesh *mesh, const aiScene *scene) {
 
     extractBoneWeightForVertices(vertices, mesh);
 
-    return Mesh{vertices, indices, textures};
+    return Mesh{vertices, indices, textures, m_options.createGpuResources};
 }
 
 std::vector<Mesh::Texture> Model::Impl::loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName) {
@@ -180,17 +252,36 @@ void Model::Impl::setVertexBoneDataToDefault(Mesh::Vertex& vertex) {
     }
 }
 
-void Model::Impl::setVertexBoneData(Mesh::Vertex& vertex, int boneId, float weight) {
+float Model::Impl::setVertexBoneData(Mesh::Vertex& vertex, int boneId, float weight) {
+    // a free slot, or else the weakest influence if the new one is stronger
+    int slot = 0;
     for (int i = 0; i < MAX_BONE_INFLUENCE; ++i) {
         if (vertex.boneIds[i] < 0) {
-            vertex.boneWeights[i] = weight;
-            vertex.boneIds[i] = boneId;
+            slot = i;
             break;
         }
+        if (vertex.boneWeights[i] < vertex.boneWeights[slot]) {
+            slot = i;
+        }
+    }
+
+    if (vertex.boneIds[slot] < 0) {
+        vertex.boneWeights[slot] = weight;
+        vertex.boneIds[slot] = boneId;
+        return 0.0f;
+    }
+    if (weight <= vertex.boneWeights[slot]) {
+        return weight;
     }
+    const float dropped = vertex.boneWeights[slot];
+    vertex.boneWeights[slot] = weight;
+    vertex.boneIds[slot] = boneId;
+    return dropped;
 }
 
 void Model::Impl::extractBoneWeightForVertices(std::vector<Mesh::Vertex> &vertices, aiMesh *mesh) {
+    std::vector<float> droppedWeights(vertices.size(), 0.0f);
+
     // find which vertices each bone affects
     for (int boneIdx = 0; boneIdx < mesh->mNumBones; ++boneIdx) {
         // find boneId of given boneName
@@ -227,9 +318,54 @@ void Model::Impl::extractBoneWeightForVertices(std::vector<Mesh::Vertex> &vertic
             const int vertexId = weights[weightIdx].mVertexId;
             const float weight = weights[weightIdx].mWeight;
             assert(vertexId <= vertices.size());
-            setVertexBoneData(vertices[vertexId], boneId, weight);
+            droppedWeights[vertexId] += setVertexBoneData(vertices[vertexId], boneId, weight);
+        }
+    }
+
+    // renormalize what is left of vertices that lost influences
+    auto& pruning = m_boneWeightPruning;
+    float droppedSum = pruning.meanDroppedWeight * pruning.prunedVertexCount;
+    for (std::size_t vertexId = 0; vertexId < vertices.size(); vertexId++) {
+        if (droppedWeights[vertexId] <= 0.0f) {
+            continue;
+        }
+        auto& vertex = vertices[vertexId];
+        float kept = 0.0f;
+        for (int i = 0; i < MAX_BONE_INFLUENCE; ++i) {
+            kept += vertex.boneWeights[i];
         }
+        for (int i = 0; i < MAX_BONE_INFLUENCE; ++i) {
+            vertex.boneWeights[i] /= kept;
+        }
+
+        const float dropped = droppedWeights[vertexId] / (kept + droppedWeights[vertexId]);
+        pruning.prunedVertexCount++;
+        pruning.maxDroppedWeight = std::max(pruning.maxDroppedWeight, dropped);
+        droppedSum += dropped;
     }
+    if (pruning.prunedVertexCount > 0) {
+        pruning.meanDroppedWeight = droppedSum / pruning.prunedVertexCount;
+    }
+}
+
+std::vector<Model::MeshGeometry> Model::loadGeometry(const char *path) {
+    ScopedTimer timer{std::string{"loadGeometry - "} + path};
+    Assimp::Importer import;
+    const aiScene *scene = import.ReadFile(path, kImportFlags);
+
+    std::vector<MeshGeometry> meshes;
+    if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    {
+        std::cout << "ERROR::ASSIMP::" << import.GetErrorString() << std::endl;
+        return meshes;
+    }
+
+    collectGeometry(scene->mRootNode, scene, meshes);
+    return meshes;
+}
+
+const std::vector<Mesh> &Model::getMeshes() const {
+    return m_impl->m_meshes;
 }
 
 std::unordered_map<std::string, Model::BoneInfo> &Model::getBoneInfoMap() {
@@ -240,11 +376,21 @@ int & Model::getBoneCount() {
     return m_impl->m_boneCounter;
 }
 
+const Model::BoneWeightPruning &Model::getBoneWeightPruning() const {
+    return m_impl->m_boneWeightPruning;
+}
+
 Model::Model(Model &&other) noexcept {
     m_impl = std::move(other.m_impl);
 }
 
-Model::~Model() {}
+Model::~Model() {
+    // moved from models have no Impl, models that never drew instances have no buffer and may
+    // not even have an OpenGL context
+    if (m_impl && m_impl->m_animatedInstanceBuffer != 0) {
+        glDeleteBuffers(1, &m_impl->m_animatedInstanceBuffer);
+    }
+}
 
 
 Transform::Transform(glm::vec3 positionIn, glm::vec3 rotationIn, glm::vec3 scaleIn)
@@ -0,0 +1,69 @@
+#include "Pose.hpp"
+
+#include <cmath>
+
+namespace {
+glm::quat lerpRotation(const glm::quat& a, const glm::quat& b, float weight) {
+    // q and -q are the same rotation, flip b onto a's hemisphere to take the shorter arc
+    const float wa = 1.0f - weight;
+    const float wb = glm::dot(a, b) < 0.0f ? -weight : weight;
+    return glm::quat{wa * a.w + wb * b.w, wa * a.x + wb * b.x, wa * a.y + wb * b.y, wa * a.z + wb * b.z};
+}
+}
+
+int Pose::getNodeCount() const {
+    return static_cast<int>(translations.size());
+}
+
+void Pose::resize(int nodeCount) {
+    translations.resize(nodeCount, glm::vec3{0.0f});
+    rotations.resize(nodeCount, glm::quat{1.0f, 0.0f, 0.0f, 0.0f});
+    scales.resize(nodeCount, glm::vec3{1.0f});
+}
+
+void Pose::blend(const Pose &other, float weight) {
+    const int nodeCount = getNodeCount();
+    // rotations in a loop of their own keep both loops simple enough for the vectorizer
+    for (int node = 0; node < nodeCount; node++) {
+        translations[node] += (other.translations[node] - translations[node]) * weight;
+        scales[node] += (other.scales[node] - scales[node]) * weight;
+    }
+    for (int node = 0; node < nodeCount; node++) {
+        rotations[node] = lerpRotation(rotations[node], other.rotations[node], weight);
+    }
+}
+
+void Pose::blend(const Pose &other, const float *nodeWeights) {
+    const int nodeCount = getNodeCount();
+    for (int node = 0; node < nodeCount; node++) {
+        const float weight = nodeWeights[node];
+        translations[node] += (other.translations[node] - translations[node]) * weight;
+        scales[node] += (other.scales[node] - scales[node]) * weight;
+        // a blended base pose can be well below unit length, the layer's weight is relative to
+        // the rotations, not to their lengths
+        rotations[node] = lerpRotation(glm::normalize(rotations[node]), glm::normalize(other.rotations[node]), weight);
+    }
+}
+
+void Pose::toMatrices(glm::mat4 *localTransforms) const {
+    const int nodeCount = getNodeCount();
+    for (int node = 0; node < nodeCount; node++) {
+        // translate * toMat4(rotation) * scale without the two matrix products
+        const glm::mat3 rotation = glm::mat3_cast(glm::normalize(rotations[node]));
+        const glm::vec3& scale = scales[node];
+        glm::mat4& local = localTransforms[node];
+        local[0] = glm::vec4{rotation[0] * scale.x, 0.0f};
+        local[1] = glm::vec4{rotation[1] * scale.y, 0.0f};
+        local[2] = glm::vec4{rotation[2] * scale.z, 0.0f};
+        local[3] = glm::vec4{translations[node], 1.0f};
+    }
+}
+
+void Pose::decompose(const glm::mat4 &transform, glm::vec3 &translation, glm::quat &rotation, glm::vec3 &scale) {
+    translation = glm::vec3{transform[3]};
+    scale = glm::vec3{glm::length(glm::vec3{transform[0]}), glm::length(glm::vec3{transform[1]}),
+                      glm::length(glm::vec3{transform[2]})};
+    const glm::mat3 rotationMatrix{glm::vec3{transform[0]} / scale.x, glm::vec3{transform[1]} / scale.y,
+                                   glm::vec3{transform[2]} / scale.z};
+    rotation = glm::normalize(glm::quat_cast(rotationMatrix));
+}
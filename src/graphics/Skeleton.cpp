@@ -0,0 +1,41 @@
+#include "Skeleton.hpp"
+
+#include <algorithm>
+
+int Skeleton::getNodeCount() const {
+    return static_cast<int>(parents.size());
+}
+
+int Skeleton::getBoneCount() const {
+    return boneIds.empty() ? 0 : *std::max_element(boneIds.begin(), boneIds.end()) + 1;
+}
+
+int Skeleton::findNode(const std::string &name) const {
+    const auto nameIt = std::find(names.begin(), names.end(), name);
+    return nameIt != names.end() ? static_cast<int>(nameIt - names.begin()) : -1;
+}
+
+int Skeleton::addNode(std::string name, int parent, const glm::mat4 &bindTransform) {
+    names.push_back(std::move(name));
+    parents.push_back(parent);
+    bindTransforms.push_back(bindTransform);
+    boneIdxs.push_back(-1);
+    boneIds.push_back(-1);
+    offsetMatrices.emplace_back(1.0f);
+    return getNodeCount() - 1;
+}
+
+void Skeleton::computeBoneMatrices(const glm::mat4 *localTransforms, glm::mat4 *globalTransforms,
+                                   glm::mat4 *finalBoneMatrices) const {
+    const int nodeCount = getNodeCount();
+    for (int node = 0; node < nodeCount; node++) {
+        const int parent = parents[node];
+        globalTransforms[node] = parent < 0 ? localTransforms[node] : globalTransforms[parent] * localTransforms[node];
+    }
+    for (int node = 0; node < nodeCount; node++) {
+        const int boneId = boneIds[node];
+        if (boneId >= 0) {
+            finalBoneMatrices[boneId] = globalTransforms[node] * offsetMatrices[node];
+        }
+    }
+}
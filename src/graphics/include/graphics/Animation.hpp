@@ -2,7 +2,6 @@
 
 #include <string>
 #include <vector>
-#include <optional>
 #include <unordered_map>
 
 #include <glm/mat4x4.hpp>
@@ -12,36 +11,44 @@
 
 #include "Model.hpp"
 #include "Bone.hpp"
-
-struct AssimpNodeData {
-    glm::mat4 transform;
-    std::string name;
-    int childrenCount;
-    std::vector<AssimpNodeData> children;
-};
+#include "Skeleton.hpp"
 
 class Animation {
 public:
     Animation(const std::string& animationFilePath, Model& model);
 
-    std::optional<Bone> findBone(const std::string& name);
+    // From a scene that is already imported or built in code, reads its first animation.
+    Animation(const aiScene* scene, Model& model);
+
+    Bone* findBone(const std::string& name);
+
+    Bone& getBone(int boneIdx);
 
-    float getTicksPerSecond();
+    [[nodiscard]] const Bone& getBone(int boneIdx) const;
 
-    float getDuration();
+    // number of animated nodes, valid bone indices are [0, getBoneChannelCount())
+    [[nodiscard]] int getBoneChannelCount() const;
 
-    const AssimpNodeData& getRootNode();
+    float getTicksPerSecond() const;
+
+    float getDuration() const;
+
+    const Skeleton& getSkeleton() const;
 
     const std::unordered_map<std::string, Model::BoneInfo>& getBoneIdMap();
 
 private:
+    void readScene(const aiScene* scene, Model& model);
+
     void readMissingBones(const aiAnimation* animation, Model& model);
 
-    void readHeirarchyData(AssimpNodeData& dest, const aiNode* src);
+    void readHeirarchyData(const aiNode* src, int parent);
+
+    void resolveNodeChannels();
 
     double m_duration;
     double m_ticksPerSecond;
     std::vector<Bone> m_bones;
-    AssimpNodeData m_rootNode;
+    Skeleton m_skeleton;
     std::unordered_map<std::string, Model::BoneInfo> m_boneInfoMap;
 };
@@ -4,24 +4,44 @@
 
 #include <glm/mat4x4.hpp>
 
+#include "Bone.hpp"
+
 class Animation;
-struct AssimpNodeData;
+class CompressedClip;
+struct Skeleton;
 
 class Animator {
 public:
     Animator(Animation *animation);
 
+    // Plays a clip loaded with CompressedClip::load, needs neither the model nor its animation file.
+    explicit Animator(const CompressedClip *clip);
+
     void updateAnimation(float dt);
 
     void playAnimation(Animation *animation);
 
-    void calculateBoneTransform(const AssimpNodeData* node, glm::mat4 parentTransform);
+    void playClip(const CompressedClip *clip);
+
+    // Samples every animated node at the current time and updates the final bone matrices.
+    void calculateBoneTransforms();
 
-    std::vector<glm::mat4> getFinalBoneMatrices();
+    const std::vector<glm::mat4>& getFinalBoneMatrices() const;
 
 private:
-    Animation* m_currentAnimation;
+    // skeleton of whichever is playing, nullptr if nothing is
+    const Skeleton* getCurrentSkeleton() const;
+
+    void resizeBuffers();
+
+    // at most one of the two is set
+    Animation* m_currentAnimation{nullptr};
+    const CompressedClip* m_currentClip{nullptr};
+    std::vector<Bone::KeyCursor> m_clipCursors{};
     float m_currentTime{0.0};
     float m_deltaTime{0.0};
     std::vector<glm::mat4> m_finalBoneMatrices{};
+    // per node of the current animation's skeleton, kept between frames to avoid reallocating
+    std::vector<glm::mat4> m_localTransforms{};
+    std::vector<glm::mat4> m_globalTransforms{};
 };
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class Animation;
+class Shader;
+
+/*!
+ * Skinning matrices of one or more clips sampled at a fixed frame rate, for drawing crowds
+ * with a single instanced draw call: every instance only carries a clip id and a time offset
+ * (see Mesh::AnimatedInstance), the vertex shader
+ * resources/shader/skeletal_animation/baked_instanced.vert reads the bone matrices of its two
+ * nearest frames from a texture and blends them.
+ *
+ * The texture is RGBA32F, one row per frame with the clips' frames one after the other. A bone
+ * takes three texels, the first three rows of its matrix, the last row of a skinning matrix is
+ * always (0, 0, 0, 1). Frames past GL_MAX_TEXTURE_SIZE rows continue at the top of a second
+ * band of columns right of the first, and so on.
+ *
+ * Baking needs no OpenGL context, only `createTexture` and `bind` do.
+ */
+class BakedAnimation {
+public:
+    struct Clip {
+        int firstFrame;
+        int frameCount;
+        // seconds, frames are spread evenly over it and the last one blends into the first
+        float duration;
+    };
+
+    // Most clips one bake can hold, the size of the clip uniform arrays of the shader.
+    static constexpr int kMaxClips = 16;
+
+    // Samples every animation, all of the same model, about `framesPerSecond` times per second.
+    // Clips past `kMaxClips` are left out, with an error on stderr.
+    BakedAnimation(const std::vector<const Animation*>& animations, float framesPerSecond);
+    ~BakedAnimation();
+
+    BakedAnimation(const BakedAnimation&) = delete;
+    BakedAnimation& operator=(const BakedAnimation&) = delete;
+
+    [[nodiscard]] int getBoneCount() const;
+    [[nodiscard]] int getFrameCount() const;
+    [[nodiscard]] const std::vector<Clip>& getClips() const;
+
+    // Three texels per bone and frame, row by row as they are uploaded.
+    [[nodiscard]] const std::vector<glm::vec4>& getTexels() const;
+
+    // Skinning matrix of `bone` at `frame`, counted over all clips.
+    [[nodiscard]] glm::mat4 getBoneMatrix(int frame, int bone) const;
+
+    // Uploads the texels, once, needs the OpenGL context. A bake too large for the texture size
+    // limit is not uploaded, with an error on stderr.
+    void createTexture();
+
+    // Binds the texture to `textureUnit` and sets the bake's uniforms of `shader`, which has to
+    // be in use. Units below it are left to the mesh textures.
+    void bind(Shader& shader, int textureUnit) const;
+
+private:
+    int m_boneCount{0};
+    int m_frameCount{0};
+    std::vector<Clip> m_clips{};
+    std::vector<glm::vec4> m_texels{};
+    unsigned int m_texture{0};
+    // frames per band of columns, see createTexture
+    int m_frameRows{0};
+};
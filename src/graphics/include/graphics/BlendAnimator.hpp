@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+
+#include "Bone.hpp"
+#include "Pose.hpp"
+#include "Skeleton.hpp"
+
+class Animation;
+
+/*!
+ * Animator that mixes several clips. Every active clip is sampled into a Pose, poses are
+ * blended node by node and only the final pose is turned into matrices, so adding a clip costs
+ * its key sampling plus a blend, not another round of matrix products. Keys are lerped,
+ * rotations included, and a node whose tracks share key times searches them once, which keeps a
+ * cross-fade of two clips at about 1.4x one.
+ *
+ * The base clip is replaced either at once (`playAnimation`) or by cross-fading from the
+ * current one (`crossFade`). Layers are blended over the base in the order they were added,
+ * each with a weight and optionally limited to the subtree of one node, e.g. an upper body
+ * action over a walk cycle.
+ *
+ * All clips have to animate the same rig, they are matched to the skeleton of the first clip
+ * by node name. Nodes a clip doesn't animate use that skeleton's bind transform.
+ */
+class BlendAnimator {
+public:
+    explicit BlendAnimator(Animation* animation);
+
+    void updateAnimation(float dt);
+
+    void playAnimation(Animation* animation);
+
+    // Fades from the current base clip to `animation` over `duration` seconds, both keep playing
+    // meanwhile. A cross-fade started during another one fades out of the blended pose.
+    void crossFade(Animation* animation, float duration);
+
+    // Blends `animation` over the base pose below the node called `maskRoot`, over all nodes if
+    // it is empty. Returns the index of the layer.
+    int addLayer(Animation* animation, float weight, const std::string& maskRoot = {});
+
+    void setLayerWeight(int layerIdx, float weight);
+
+    [[nodiscard]] const std::vector<glm::mat4>& getFinalBoneMatrices() const;
+
+private:
+    // Keys of the bone animating a node, looked up once per clip instead of per sample.
+    struct NodeKeys {
+        // null keeps the bind transform
+        const std::vector<KeyPosition>* positions{nullptr};
+        const std::vector<KeyRotation>* rotations{nullptr};
+        const std::vector<KeyScale>* scales{nullptr};
+        // every animated track is keyed at the same times, as exporters that resample clips write
+        // them, one key search and one factor serve the whole node
+        bool sharedKeyTimes{false};
+    };
+
+    // A clip with its own playback time, matched to the skeleton.
+    struct ClipState {
+        Animation* animation{nullptr};
+        float time{0.0f};
+        // per skeleton node
+        std::vector<NodeKeys> nodeKeys{};
+        std::vector<Bone::KeyCursor> cursors{};
+    };
+
+    struct Layer {
+        ClipState clip;
+        float weight;
+        // per skeleton node, 1 inside the mask, 0 outside
+        std::vector<float> mask;
+        // mask scaled by weight, rebuilt when the weight changes
+        std::vector<float> nodeWeights;
+    };
+
+    [[nodiscard]] ClipState makeClipState(Animation* animation) const;
+
+    static void advance(ClipState& clip, float dt);
+
+    void sample(ClipState& clip, Pose& pose) const;
+
+    // Base clip, or the cross-fade in progress, without the layers.
+    void sampleBasePose(Pose& pose);
+
+    const Skeleton* m_skeleton;
+    Pose m_bindPose{};
+    ClipState m_current{};
+    ClipState m_previous{};
+    // pose the cross-fade starts from when it replaced another cross-fade
+    Pose m_frozenPose{};
+    bool m_fading{false};
+    bool m_fadeFromFrozen{false};
+    float m_fadeTime{0.0f};
+    float m_fadeDuration{0.0f};
+    std::vector<Layer> m_layers{};
+
+    Pose m_pose{};
+    Pose m_scratchPose{};
+    std::vector<glm::mat4> m_localTransforms{};
+    std::vector<glm::mat4> m_globalTransforms{};
+    std::vector<glm::mat4> m_finalBoneMatrices{};
+};
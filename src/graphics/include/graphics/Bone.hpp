@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <string>
 #include <vector>
 
@@ -25,10 +27,22 @@ struct KeyScale {
 
 class Bone {
 public:
+    // Key of every channel found by the previous lookup. Playback advances by a fraction of a key
+    // interval per frame, so the next lookup nearly always starts at the same or the following key.
+    struct KeyCursor {
+        int position{0};
+        int rotation{0};
+        int scale{0};
+    };
+
     Bone(std::string name, int id, const aiNodeAnim* channel);
 
     void update(float animationTime);
 
+    // Same as `update`, but leaves the bone untouched and keeps the lookup state in `cursor`, so
+    // one bone can be sampled for many characters at once, from any number of threads.
+    [[nodiscard]] glm::mat4 sampleLocalTransform(float animationTime, KeyCursor& cursor) const;
+
     glm::mat4 getLocalTransform();
     [[nodiscard]] std::string getBoneName() const;
     int getBoneId();
@@ -36,11 +50,28 @@ public:
     int getRotationIdx(float animationTime);
     int getScaleIdx(float animationTime);
 
+    [[nodiscard]] const std::vector<KeyPosition>& getPositionKeys() const;
+    // Neighbouring keys lie on the same hemisphere, a lerp between them takes the shorter arc.
+    [[nodiscard]] const std::vector<KeyRotation>& getRotationKeys() const;
+    [[nodiscard]] const std::vector<KeyScale>& getScaleKeys() const;
+
+    // Index of the key starting the interval that contains `animationTime`, i.e. the last key at or
+    // before it, clamped to [0, size - 2]. Playing forward only moves `cursor` by a key or two; seeks
+    // and loops back to the start do a binary search. In the header, it runs for every track sample.
+    template<typename T>
+    static int findKeyIdx(float animationTime, const std::vector<T>& keys, int& cursor);
+
 private:
-    float getScaleFactor(float lastTimestamp, float nextTimestamp, float animationTime);
-    glm::mat4 interpolatePosition(float animationTime);
-    glm::mat4 interpolateRotation(float animationTime);
-    glm::mat4 interpolateScale(float animationTime);
+    // steps the cursor may move forward before a lookup falls back to binary search
+    static constexpr int kMaxCursorSteps = 4;
+
+    float getScaleFactor(float lastTimestamp, float nextTimestamp, float animationTime) const;
+    glm::vec3 samplePosition(float animationTime, int& cursor) const;
+    glm::quat sampleRotation(float animationTime, int& cursor) const;
+    glm::vec3 sampleScale(float animationTime, int& cursor) const;
+    glm::mat4 interpolatePosition(float animationTime, int& cursor) const;
+    glm::mat4 interpolateRotation(float animationTime, int& cursor) const;
+    glm::mat4 interpolateScale(float animationTime, int& cursor) const;
 
     std::vector<KeyPosition> m_positions;
     std::vector<KeyRotation> m_rotations;
@@ -49,5 +80,30 @@ private:
     std::string m_name;
     int m_Id;
 
+    KeyCursor m_cursor{};
+
     glm::mat4 m_localTransform{1.0f};
-};
\ No newline at end of file
+};
+
+template<typename T>
+inline int Bone::findKeyIdx(float animationTime, const std::vector<T>& keys, int& cursor) {
+    assert(keys.size() >= 2);
+    const int lastIdx = static_cast<int>(keys.size()) - 2;
+
+    int idx = cursor;
+    if (animationTime >= keys[idx].timeStamp) {
+        for (int step = 0; step < kMaxCursorSteps && idx < lastIdx && animationTime >= keys[idx + 1].timeStamp; ++step) {
+            ++idx;
+        }
+        if (idx == lastIdx || animationTime < keys[idx + 1].timeStamp) {
+            cursor = idx;
+            return idx;
+        }
+    }
+
+    const auto next = std::upper_bound(keys.begin() + 1, keys.end() - 1, animationTime, [](float time, const T& key) {
+        return time < key.timeStamp;
+    });
+    cursor = static_cast<int>(next - keys.begin()) - 1;
+    return cursor;
+}
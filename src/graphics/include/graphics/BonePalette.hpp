@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+
+class Shader;
+
+/*!
+ * Buffer texture with the final bone matrices of a skinned draw, read by
+ * skeletal_animation.vert as `finalBonesMatrices`, four RGBA32F texels (the columns) per bone.
+ * Unlike a uniform array it has no fixed bone limit, it is sized to the model's bones and grows
+ * to whatever is uploaded, e.g. all characters of a CrowdAnimator at once. Replaces setting one
+ * uniform per bone. A buffer texture instead of a storage buffer keeps it within OpenGL 3.3.
+ */
+class BonePalette {
+public:
+    // Room for `boneCount` matrices, e.g. Model::getBoneCount(), all identity until the first
+    // upload. Needs the OpenGL context.
+    explicit BonePalette(int boneCount);
+    ~BonePalette();
+
+    BonePalette(const BonePalette&) = delete;
+    BonePalette& operator=(const BonePalette&) = delete;
+
+    // Replaces the first matrices, the palette grows when there are more. Bones past the
+    // uploaded ones keep their matrix, e.g. the identity for bones no clip drives.
+    void upload(const std::vector<glm::mat4>& boneMatrices);
+
+    // Binds the texture to `textureUnit` and points the sampler of `shader`, which has to be in
+    // use, at it. Units below it are left to the mesh textures.
+    void bind(Shader& shader, int textureUnit) const;
+
+    [[nodiscard]] int getBoneCount() const;
+
+private:
+    unsigned int m_buffer{0};
+    unsigned int m_texture{0};
+    // matrices in the buffer, the shader takes the bone count from the texture size
+    int m_boneCount{0};
+};
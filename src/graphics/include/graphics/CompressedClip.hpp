@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Bone.hpp"
+#include "Skeleton.hpp"
+
+class Animation;
+
+/*!
+ * Animation clip in a compact form, built offline from an Animation and sampled directly from
+ * its quantized keys:
+ *
+ *  - translations and scales are quantized to 16 bits per component within the range of their
+ *    track,
+ *  - rotations are stored as their three smallest components at 15 bits each, the largest one
+ *    follows from the unit length and its index goes into the spare top bits,
+ *  - key times are 16 bit fractions of the clip duration,
+ *  - keys that linear interpolation between their neighbours reproduces within the tolerance
+ *    are dropped, tracks that don't move at all keep a single key.
+ *
+ * The file also holds the skeleton with the bone ids and offsets of the model, so playing a
+ * clip needs neither assimp nor the model's bone info. Values are written in their in-memory
+ * layout, clips are meant to be built on and for little endian machines.
+ */
+class CompressedClip {
+public:
+    struct Settings {
+        // model units
+        float translationTolerance{1e-3f};
+        // radians
+        float rotationTolerance{1e-3f};
+        float scaleTolerance{1e-3f};
+    };
+
+    static CompressedClip compress(const Animation& animation, const Settings& settings);
+
+    // Empty clip if the file can't be read, isn't a clip or is truncated or corrupt. Every size and
+    // index in the file is checked, sampling a loaded clip never reads outside of it.
+    static CompressedClip load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    [[nodiscard]] bool isEmpty() const;
+    [[nodiscard]] float getTicksPerSecond() const;
+    [[nodiscard]] float getDuration() const;
+    [[nodiscard]] const Skeleton& getSkeleton() const;
+
+    // Local transform of every skeleton node at `animationTime`, in ticks like Bone::update.
+    // `cursors` keeps the lookup state between calls, one per animated node, see `getChannelCount`.
+    void sampleLocalTransforms(float animationTime, Bone::KeyCursor* cursors, glm::mat4* localTransforms) const;
+
+    [[nodiscard]] int getChannelCount() const;
+
+    // Bytes of keys and track headers, without the skeleton.
+    [[nodiscard]] std::size_t getKeyMemoryUsage() const;
+
+private:
+    struct Track {
+        std::uint32_t firstKey;
+        std::uint32_t keyCount;
+        // decoded value = rangeMin + rangeExtent * quantized / 65535, unused by rotation tracks
+        glm::vec3 rangeMin;
+        glm::vec3 rangeExtent;
+    };
+
+    struct Channel {
+        Track translation;
+        Track rotation;
+        Track scale;
+    };
+
+    // Parents come before their children, channel and node indices are in range and every track's
+    // keys lie inside the key arrays.
+    [[nodiscard]] bool isConsistent() const;
+
+    static glm::vec3 sampleVector(const Track& track, const std::vector<std::uint16_t>& times,
+                                  const std::vector<std::uint16_t>& values, float quantizedTime, int& cursor);
+    glm::quat sampleRotation(const Track& track, float quantizedTime, int& cursor) const;
+
+    float m_duration{0.0f};
+    float m_ticksPerSecond{0.0f};
+    Skeleton m_skeleton;
+    // node of every channel
+    std::vector<std::int32_t> m_channelNodes;
+    std::vector<Channel> m_channels;
+
+    // keys of all tracks, a track's keys are consecutive
+    std::vector<std::uint16_t> m_translationTimes;
+    std::vector<std::uint16_t> m_translations; // 3 per key
+    std::vector<std::uint16_t> m_rotationTimes;
+    std::vector<std::uint16_t> m_rotations;    // 3 per key
+    std::vector<std::uint16_t> m_scaleTimes;
+    std::vector<std::uint16_t> m_scales;       // 3 per key
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+
+class Model;
+class JobPool;
+
+/*!
+ * Linear blend skinning on the CPU, the same as skeletal_animation.vert does on the GPU, for
+ * physics, picking or rendering without a GPU. Vertices are blended with up to
+ * MAX_BONE_INFLUENCE bone matrices by their weights, normals with the rotation part of the
+ * blended matrix and normalized.
+ *
+ * A vertex that refers to a bone past the given matrices keeps its bind pose, like in the
+ * shader. So does a vertex without any bone, where the shader would collapse it to the origin.
+ *
+ * The AVX2 kernel blends the two column pairs of the bone matrices in 256 bit registers and is
+ * picked at runtime if the CPU has it, the scalar kernel is the reference it is checked against.
+ */
+class CpuSkinner {
+public:
+    enum class Kernel {
+        Scalar,
+        Avx2,
+    };
+
+    struct SkinnedMesh {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+    };
+
+    // Fastest kernel the running CPU supports.
+    static Kernel detectKernel();
+
+    static const char* getKernelName(Kernel kernel);
+
+    explicit CpuSkinner(Kernel kernel = detectKernel());
+
+    [[nodiscard]] Kernel getKernel() const;
+
+    // Skins all vertices of `mesh`, `out` is resized to its vertex count.
+    void skin(const Mesh& mesh, const std::vector<glm::mat4>& finalBoneMatrices, SkinnedMesh& out) const;
+
+    // Skins every mesh of `model`, e.g. with an Animator's final bone matrices. Meshes are split
+    // into chunks of vertices that are spread over the pool's threads.
+    void skin(const Model& model, const std::vector<glm::mat4>& finalBoneMatrices, JobPool& pool,
+              std::vector<SkinnedMesh>& out) const;
+
+    // Skins the vertices [begin, end) of `vertices` into `positions` and `normals`, which have
+    // room for all of them.
+    void skinRange(const Mesh::Vertex* vertices, int begin, int end, const std::vector<glm::mat4>& finalBoneMatrices,
+                   glm::vec3* positions, glm::vec3* normals) const;
+
+private:
+    Kernel m_kernel;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+
+#include "Bone.hpp"
+
+class Animation;
+class Camera;
+class JobPool;
+
+/*!
+ * Animates many characters playing the same Animation in one pass. Each character only has
+ * its own playback time, speed and key cursors, the keys and the skeleton are shared.
+ * Characters are split between the threads of a JobPool.
+ *
+ * The bone matrices of all characters end up in one contiguous buffer, character `i` owns
+ * `getBoneCount()` matrices starting at `i * getBoneCount()`, so the whole crowd is uploaded
+ * to a single uniform, storage or texture buffer.
+ *
+ * With a camera, characters get a level of detail: distant and off-screen characters are only
+ * evaluated every few frames, their matrices are interpolated in between, and nodes deep in
+ * the hierarchy (fingers, face) of far characters keep their bind transform. An optional
+ * per-frame budget caps the time spent evaluating, characters that don't fit keep their last
+ * pose and are first in line the next frame.
+ */
+class CrowdAnimator {
+public:
+    struct LodLevel {
+        // characters up to this far from the camera use the level
+        float maxDistance;
+        // frames between evaluations, 1 evaluates every frame
+        int updateInterval;
+        // nodes deeper in the hierarchy than this keep their bind transform, the root has
+        // depth 0, -1 evaluates all nodes
+        int maxNodeDepth;
+    };
+
+    struct LodSettings {
+        // ordered by distance, characters past the last one use the last one
+        std::vector<LodLevel> levels;
+        int offscreenUpdateInterval;
+        int offscreenMaxNodeDepth;
+        // milliseconds a whole update may take, 0 for no limit. Only evaluations are cut to fit
+        // it, the rest of the frame is charged against it first.
+        float frameBudgetMs;
+    };
+
+    struct LodStats {
+        // characters whose pose was evaluated in the last update
+        int evaluated{0};
+        // characters that were due but didn't fit into the budget
+        int deferred{0};
+        // characters blended between two evaluated poses, the others held theirs
+        int interpolated{0};
+        int offscreen{0};
+    };
+
+    explicit CrowdAnimator(Animation* animation);
+
+    // Adds a character `startTime` seconds into the animation, playing at `speed`. Returns its index.
+    int addCharacter(float startTime = 0.0f, float speed = 1.0f);
+
+    [[nodiscard]] int getCharacterCount() const;
+
+    // Matrices per character, the highest bone id of the animation plus one.
+    [[nodiscard]] int getBoneCount() const;
+
+    // World space sphere around the character, for its distance to the camera and visibility.
+    void setCharacterBounds(int character, const glm::vec3& center, float radius);
+
+    void setLodSettings(const LodSettings& settings);
+
+    [[nodiscard]] const LodSettings& getLodSettings() const;
+
+    // Evaluates every character at full detail.
+    void updateAnimation(float dt, JobPool& pool);
+
+    // Evaluates characters by their level of detail as seen from `camera` through `projection`.
+    void updateAnimation(float dt, const Camera& camera, const glm::mat4& projection, JobPool& pool);
+
+    [[nodiscard]] const LodStats& getLodStats() const;
+
+    [[nodiscard]] const std::vector<glm::mat4>& getFinalBoneMatrices() const;
+
+private:
+    struct Character {
+        float time;
+        float speed;
+        glm::vec3 center{0.0f};
+        float radius{1.0f};
+        // level of detail state
+        int updateInterval{1};
+        int maxNodeDepth{-1};
+        int framesSinceEvaluation{0};
+        // ticks played since the last evaluation and between the two poses interpolated
+        float ticksSinceEvaluation{0.0f};
+        float ticksBetweenPoses{0.0f};
+        bool evaluated{false};
+        // the final matrices hold the pose until the next evaluation, nothing to interpolate
+        bool poseHeld{false};
+    };
+
+    void animateCharacter(int character, float time, int maxNodeDepth, glm::mat4* finalBoneMatrices);
+
+    // Evaluates the pose `aheadTicks` into the future, the character blends towards it until the
+    // next evaluation.
+    void evaluateCharacter(int character, float aheadTicks);
+
+    void interpolateCharacter(int character);
+
+    Animation* m_animation;
+    int m_boneCount{0};
+    std::vector<Character> m_characters{};
+    // one per character and bone of the animation
+    std::vector<Bone::KeyCursor> m_cursors{};
+    std::vector<glm::mat4> m_finalBoneMatrices{};
+
+    LodSettings m_lodSettings;
+    LodStats m_lodStats{};
+    // per skeleton node, 0 for roots
+    std::vector<int> m_nodeDepths{};
+    // poses the characters blend between, laid out like `m_finalBoneMatrices`
+    std::vector<glm::mat4> m_previousBoneMatrices{};
+    std::vector<glm::mat4> m_nextBoneMatrices{};
+    // characters due this frame, ordered by priority
+    std::vector<int> m_dueCharacters{};
+    // measured wall time of one evaluation and of all interpolation in a frame, for the budget
+    double m_evaluationMs{0.0};
+    double m_interpolationMs{0.0};
+};
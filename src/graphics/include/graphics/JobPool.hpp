@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * Fixed set of worker threads for data parallel loops, e.g. animating a crowd. The calling
+ * thread works along, `parallelFor` returns once the whole range is done. Calls must not be
+ * nested and only one thread may use a pool at a time.
+ */
+class JobPool {
+public:
+    // `threadCount` includes the calling thread, 0 uses one thread per hardware thread.
+    explicit JobPool(unsigned threadCount = 0);
+    ~JobPool();
+
+    JobPool(const JobPool&) = delete;
+    JobPool& operator=(const JobPool&) = delete;
+
+    [[nodiscard]] unsigned getThreadCount() const;
+
+    // Calls `job(begin, end)` for consecutive ranges of at most `grainSize` items covering [0, count).
+    void parallelFor(int count, int grainSize, const std::function<void(int begin, int end)>& job);
+
+private:
+    void workerLoop();
+    void runRanges();
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_jobReady;
+    std::condition_variable m_jobDone;
+
+    // current loop, written under `m_mutex` before `m_generation` is increased
+    const std::function<void(int, int)>* m_job{nullptr};
+    int m_count{0};
+    int m_grainSize{1};
+    int m_nextBegin{0};
+    std::uint64_t m_generation{0};
+    // workers that haven't finished the current loop yet
+    unsigned m_busyWorkers{0};
+    bool m_stop{false};
+};
@@ -22,13 +22,24 @@ public:
         float boneWeights[MAX_BONE_INFLUENCE];
     };
 
+    // Per instance data of a crowd drawn with a BakedAnimation.
+    struct AnimatedInstance {
+        glm::mat4 modelMatrix;
+        // into the BakedAnimation's clips
+        int clip;
+        // seconds added to the shader's time, so instances playing the same clip don't move in sync
+        float timeOffset;
+    };
+
     struct Texture {
         unsigned int id;
         std::string type;
         std::string path;
     };
 
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
+    // without GPU resources the mesh only keeps its vertices and indices and can't be drawn
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures,
+         bool createGpuResources = true);
 
     void draw(Shader& shader);
 
@@ -36,14 +47,22 @@ public:
 
     void drawInstanced(Shader& shader);
 
+    // Instance attributes for baked_instanced.vert, from the bound array buffer of
+    // `AnimatedInstance`s. They start at location 5, after the bone ids and weights.
+    void setInstancedAnimations(const std::vector<AnimatedInstance>& instances);
+
+    [[nodiscard]] const std::vector<Vertex>& getVertices() const;
+
+    [[nodiscard]] const std::vector<unsigned int>& getIndices() const;
+
 private:
     std::vector<Vertex> m_vertices;
     std::vector<unsigned int> m_indices;
     std::vector<Texture> m_textures;
 
-    unsigned int m_VAO;
-    unsigned int m_VBO;
-    unsigned int m_EBO;
+    unsigned int m_VAO{0};
+    unsigned int m_VBO{0};
+    unsigned int m_EBO{0};
 
     std::optional<int> m_instanceCount;
 
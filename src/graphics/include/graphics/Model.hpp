@@ -19,7 +19,39 @@ public:
         glm::mat4 offsetMatrix;
     };
 
+    // CPU side copy of a mesh, without textures or GL objects
+    struct MeshGeometry {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<unsigned int> indices; // triangle list
+    };
+
+    // Bone influences dropped at load time because a vertex has room for MAX_BONE_INFLUENCE only.
+    // The strongest ones are kept and renormalized, the dropped weight is the skinning error.
+    struct BoneWeightPruning {
+        int prunedVertexCount{0};
+        // share of a vertex's total weight that was dropped
+        float maxDroppedWeight{0.0f};
+        float meanDroppedWeight{0.0f};
+    };
+
+    struct LoadOptions {
+        // Without GPU resources no OpenGL context is needed, but the model can't be drawn. Bones
+        // are still read, e.g. for animating on a headless machine.
+        bool createGpuResources{true};
+    };
+
     explicit Model(const char* path);
+    Model(const char* path, LoadOptions options);
+
+    // Model built in code, e.g. procedural geometry. It has no textures and no bones until they are
+    // added to `getBoneInfoMap`, e.g. by an Animation.
+    explicit Model(std::vector<Mesh> meshes);
+
+    // Extracts the same vertices as the constructor but only the triangle faces, points and lines
+    // are skipped. Creates no buffers or textures, so it works without an OpenGL context, e.g. for
+    // the CPU raytracer.
+    static std::vector<MeshGeometry> loadGeometry(const char* path);
 
     // these two are needed for Pimpl pattern to work with unique_ptr
     Model(Model&& other) noexcept;
@@ -31,10 +63,18 @@ public:
 
     void drawInstanced(Shader &shader);
 
+    // Instances for drawing with a BakedAnimation, see Mesh::setInstancedAnimations. Calling it
+    // again replaces them, in the same buffer.
+    void setInstancedAnimations(const std::vector<Mesh::AnimatedInstance>& instances);
+
+    [[nodiscard]] const std::vector<Mesh>& getMeshes() const;
+
     std::unordered_map<std::string, BoneInfo>& getBoneInfoMap();
 
     int & getBoneCount();
 
+    [[nodiscard]] const BoneWeightPruning& getBoneWeightPruning() const;
+
 private:
     struct Impl;
     std::unique_ptr<Impl> m_impl;
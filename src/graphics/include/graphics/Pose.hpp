@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+/*!
+ * Local transform of every node of a skeleton, kept as separate translation, rotation and
+ * scale arrays. Poses are blended in this form, matrices are only built once the final pose
+ * is known.
+ *
+ * Rotations are lerped without normalizing them, their length only drifts from 1 and
+ * `toMatrices` divides it out once per node instead of after every key interpolation and
+ * every blend.
+ */
+struct Pose {
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+
+    [[nodiscard]] int getNodeCount() const;
+
+    void resize(int nodeCount);
+
+    // Moves every node `weight` of the way towards `other`, rotations by lerp along the shorter
+    // arc. Unlike slerp that is a handful of multiply-adds per node and no trig.
+    void blend(const Pose& other, float weight);
+
+    // Same with a weight per node, nodes with weight 0 keep their transform.
+    void blend(const Pose& other, const float* nodeWeights);
+
+    void toMatrices(glm::mat4* localTransforms) const;
+
+    // Splits a transform without shear or negative scale into translation, rotation and scale.
+    static void decompose(const glm::mat4& transform, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale);
+};
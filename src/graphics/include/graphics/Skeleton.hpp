@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+
+/*!
+ * Node hierarchy of an animation as flat arrays, one entry per node. Parents always come
+ * before their children, so a global pose is a single pass over the nodes in order.
+ */
+struct Skeleton {
+    std::vector<std::string> names;
+    // -1 for the root
+    std::vector<int> parents;
+    // local transform of the node in the file, used where no channel animates it
+    std::vector<glm::mat4> bindTransforms;
+    // into the animation's bones, -1 if the node keeps its bind transform
+    std::vector<int> boneIdxs;
+    // idx in `finalBoneMatrices`, -1 if no vertex is attached to the node
+    std::vector<int> boneIds;
+    // transform matrix from model to bone space
+    std::vector<glm::mat4> offsetMatrices;
+
+    [[nodiscard]] int getNodeCount() const;
+
+    // Matrices `finalBoneMatrices` needs, the highest bone id plus one.
+    [[nodiscard]] int getBoneCount() const;
+
+    // Index of the node called `name`, -1 if there is none.
+    [[nodiscard]] int findNode(const std::string& name) const;
+
+    int addNode(std::string name, int parent, const glm::mat4& bindTransform);
+
+    // Global transform of every node plus the skinning matrix of every node that is a bone, from
+    // the nodes' local transforms. `finalBoneMatrices` needs room for the highest bone id.
+    void computeBoneMatrices(const glm::mat4* localTransforms, glm::mat4* globalTransforms,
+                             glm::mat4* finalBoneMatrices) const;
+};
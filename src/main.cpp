@@ -20,6 +20,8 @@
 #include <graphics/Model.hpp>
 #include <graphics/Animation.hpp>
 #include <graphics/Animator.hpp>
+#include <graphics/BonePalette.hpp>
+#include <graphics/BakedAnimation.hpp>
 
 #include <utils/Utils.hpp>
 
@@ -145,9 +147,23 @@ int main(int argc, char** argv) {
     Model vampireModel{"/home/kelvin.robles/work/repos/personal/opengl-playground/resources/models/vampire/dancing_vampire.dae"};
     Animation danceAnimation{"/home/kelvin.robles/work/repos/personal/opengl-playground/resources/models/vampire/dancing_vampire.dae", vampireModel};
     Animator animator(&danceAnimation);
+    BonePalette bonePalette{vampireModel.getBoneCount()};
     Shader animationShader{"/home/kelvin.robles/work/repos/personal/opengl-playground/resources/shader/skeletal_animation/skeletal_animation.vert", "/home/kelvin.robles/work/repos/personal/opengl-playground/resources/shader/model_loading.frag"};
     animationShader.use();
 
+    // a crowd of the same dance behind the vampire, one instanced draw per mesh
+    BakedAnimation danceBake{{&danceAnimation}, 30.0f};
+    danceBake.createTexture();
+    Shader bakedCrowdShader{"/home/kelvin.robles/work/repos/personal/opengl-playground/resources/shader/skeletal_animation/baked_instanced.vert", "/home/kelvin.robles/work/repos/personal/opengl-playground/resources/shader/model_loading.frag"};
+    std::vector<Mesh::AnimatedInstance> crowdInstances;
+    for (int row = 0; row < 4; row++) {
+        for (int column = 0; column < 8; column++) {
+            glm::mat4 instanceModel = glm::translate(glm::mat4{1.0f}, glm::vec3{(column - 3.5f) * 2.0f, -0.4f, -3.0f - row * 2.0f});
+            crowdInstances.push_back({instanceModel, 0, (row * 8 + column) * 0.37f});
+        }
+    }
+    vampireModel.setInstancedAnimations(crowdInstances);
+
     unsigned cubeWithTexCoordsVAO;
     glGenVertexArrays(1, &cubeWithTexCoordsVAO);
     glBindVertexArray(cubeWithTexCoordsVAO);
@@ -804,10 +820,8 @@ int main(int argc, char** argv) {
         animationShader.setMat4("projection", projection);
         animationShader.setMat4("view", view);
 
-        const auto transforms = animator.getFinalBoneMatrices();
-        for (auto i = 0; i < transforms.size(); i++) {
-            animationShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);
-        }
+        bonePalette.upload(animator.getFinalBoneMatrices());
+        bonePalette.bind(animationShader, 8);
 
         glm::mat4 model = glm::mat4{1.0f};
         model = glm::translate(model, glm::vec3{0.0f, -0.4f, 0.0f});
@@ -815,6 +829,13 @@ int main(int argc, char** argv) {
         animationShader.setMat4("model", model);
         vampireModel.draw(animationShader);
 
+        bakedCrowdShader.use();
+        bakedCrowdShader.setMat4("projection", projection);
+        bakedCrowdShader.setMat4("view", view);
+        bakedCrowdShader.setFloat("time", currentFrame);
+        danceBake.bind(bakedCrowdShader, 8);
+        vampireModel.drawInstanced(bakedCrowdShader);
+
         /*** Scene Graph ***/
         // modelNoLightingShader.use();
         // modelNoLightingShader.setMat4("view", view);